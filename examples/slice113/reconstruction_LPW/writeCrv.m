@@ -15,9 +15,11 @@ rampWindowForMeasuredProjections = @rampWindowForMeasuredProjectionsDefault;
 
 reconstructIteratedProjections = @reconstructIteratedProjectionsDefault;
 % reconstructIteratedProjections = @myReconstructIteratedProjections;
+% reconstructIteratedProjections = @reconstructIteratedProjectionsGridding;
 
 reconstructMeasuredProjections = @reconstructMeasuredProjectionsDefault;
 % reconstructMeasuredProjections = @myReconstructMeasuredProjections;
+% reconstructMeasuredProjections = @reconstructMeasuredProjectionsGridding;
 
 % Set variables
 pSetMaterialData = 1;
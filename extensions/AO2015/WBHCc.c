@@ -1,7 +1,9 @@
 #include <math.h>
 #include "mex.h"
+#include "../../functions/mexInputAccess.h"
 
-static void WBHC(double *rebsimPtr, double *polycrPtr, double *distPtr, int M, int N, int polysize);
+static void WBHC(const double *rebsimPtr, const double *polycrPtr, double *distPtr, int M, int N,
+                 int polysize);
 
 static char rcs_id[] = "$Revision: 1.10 $";
 
@@ -17,10 +19,9 @@ static char rcs_id[] = "$Revision: 1.10 $";
 void 
 mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
 {
-  double *rebsimPtr;          /* pointer to theta values in radians */
-  double *polycrPtr;          /* pointer to projection coordinate array */
-  double *pr1, *pr2;          /* help pointers used in loop */
-  int k, size;                /* loop counter */
+  const double *rebsimPtr;    /* view of the simulated sinogram */
+  const double *polycrPtr;    /* view of the polychromatic correction curve */
+  double *pr1;                /* help pointer */
   int M, N, polysize;         /* input image size */
   
 
@@ -49,27 +50,27 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   pr1 = mxGetPr(N1);
   N = (int) *pr1;
   
-  polysize = mxGetM(POLYCR) * mxGetN(POLYCR);
-  polycrPtr = (double *) mxCalloc(polysize, sizeof(double));
-  pr1 = mxGetPr(POLYCR);
-  pr2 = polycrPtr;
-  for(k=0;k<polysize;++k)
-    *(pr2++) = *(pr1++);
-    
+  if (M < 0 || N < 0 || mxGetNumberOfElements(REBSIM) < (size_t) M * N)
+  {
+    mexErrMsgTxt("REBSIM must have at least M*N elements");
+  }
   
-  size = mxGetM(REBSIM) * mxGetN(REBSIM);
-  rebsimPtr = (double *) mxCalloc(size, sizeof(double));
-  pr1 = mxGetPr(REBSIM);
-  pr2 = rebsimPtr;
-  for(k=0;k<size;++k)
-    *(pr2++) = *(pr1++);
+  /* Both inputs are double, so they are read in place */
+  polysize = mxGetM(POLYCR) * mxGetN(POLYCR);
+  polycrPtr = mexInputDoubles(POLYCR);
+  rebsimPtr = mexInputDoubles(REBSIM);
     
   DIST = mxCreateDoubleMatrix(N, M, mxREAL);
   
   WBHC(rebsimPtr, polycrPtr, mxGetPr(DIST), M, N, polysize);
+
+  mexInputRelease(polycrPtr, POLYCR);
+  mexInputRelease(rebsimPtr, REBSIM);
+  mexInputReport("WBHCc");
 }
 
-static void WBHC(double *rebsimPtr, double *polycrPtr, double *distPtr, int M, int N, int polysize)
+static void WBHC(const double *rebsimPtr, const double *polycrPtr, double *distPtr, int M, int N,
+                 int polysize)
 {
   int i, j, k;
   double value;
@@ -88,6 +88,36 @@ smd.mask = (x.^2 + y.^2) < ((Nr2-1)/2)^2;
 uLow = sum(smd.ELow .* smd.NLow);
 uHigh = sum(smd.EHigh .* smd.NHigh);
 
+% Compress both spectra to a few energy nodes used by the polychromatic
+% projections. The compression preserves uLow and uHigh.
+% -----------------------------------------------------------
+if ~isempty(pmd.spectrumTolerance) && pmd.spectrumTolerance > 0
+  [ELow, NLow, muLow, errLow] = compressSpectrum(smd.ELow, smd.NLow,...
+    pmd.muLow, pmd.spectrumTolerance, Nr2*pixsiz);
+  [EHigh, NHigh, muHigh, errHigh] = compressSpectrum(smd.EHigh, smd.NHigh,...
+    pmd.muHigh, pmd.spectrumTolerance, Nr2*pixsiz);
+  fprintf('Spectra compressed from %d to %d and from %d to %d energies, max error %g\n',...
+    length(smd.ELow), length(ELow), length(smd.EHigh), length(EHigh),...
+    max(errLow, errHigh));
+else
+  ELow = smd.ELow;
+  NLow = smd.NLow;
+  muLow = pmd.muLow;
+  EHigh = smd.EHigh;
+  NHigh = smd.NHigh;
+  muHigh = pmd.muHigh;
+end
+
+% Tabulate the polychromatic projections of both spectra in a basis of
+% a few line integrals
+% -----------------------------------------------------------
+if pmd.polyProjLUT
+  polyLUT = createPolyProjLUT(ELow, EHigh, uLow, uHigh, NLow, NHigh,...
+    muLow, muHigh, Nr2*pixsiz);
+  fprintf('Polychromatic projection table with %d basis functions, residual %g\n',...
+    size(polyLUT.V, 2), polyLUT.residual);
+end
+
 % Filter original projections, WA filter
 pmd.projLow = rampWindowForMeasuredProjections(pmd.projLow, r2Vec);
 pmd.projHigh = rampWindowForMeasuredProjections(pmd.projHigh, r2Vec);
@@ -97,8 +127,12 @@ pmd.projHigh = rampWindowForMeasuredProjections(pmd.projHigh, r2Vec);
 fprintf('\nStarting initial reconstruction...\n')
 
 pmd.curIterIndex = 1;
-phm1 = reconstructMeasuredProjections(pmd.projLowBH, r2Vec, degVec, smd.N1, smd.dt1);
-phm2 = reconstructMeasuredProjections(pmd.projHighBH, r2Vec, degVec, smd.N1, smd.dt1);
+% Both sinograms have the same geometry and are reconstructed together
+phm = reconstructSinograms(reconstructMeasuredProjections, pmd.projLowBH,...
+  pmd.projHighBH, r2Vec, degVec, smd.N1, smd.dt1, pmd.stackedReconstruction);
+phm1 = phm(:, :, 1);
+phm2 = phm(:, :, 2);
+clear('phm');
 
 nSavedIter = length(pmd.savedIter);  % Number of saved iterations
 pmd.recLowSet = cell(nSavedIter, 1);
@@ -132,24 +166,23 @@ disp('Decomposing tissues...')
 AttE1mat = 0.01*phm1;		   % Change 1/m to 1/cm
 AttE2mat = 0.01*phm2;
 
+% All doublets and triplets are decomposed in one call, empty cells skip
+% MD2 or MD3. The tissues are passed as lists of their pixels. The mass
+% densities of the triplets and the volume fractions Vol of all base
+% materials, the images projected in the next iteration, are computed in
+% the same pass. volPixels, the union of the lists, holds the pixels of
+% Vol that may be non-zero, the projection visits only these.
+md2Tissues = {};
+md3Tissues = {};
 if pmd.p2MD
-  dens = cell(nTissueDoublets, 1);
-  Wei2 = cell(nTissueDoublets, 1);
-  for id = 1:nTissueDoublets  % id = doublet index
-    [Wei2{id}, dens{id}] = MD2(AttE1mat, AttE2mat, pmd.Att2{id},...
-      pmd.Dens2{id}, tissue2{id});
-  end
+  md2Tissues = maskIndices(tissue2);
 end
-
 if pmd.p3MD
-  Wei3 = cell(nTissueTriplets, 1);
-  dens3 = cell(nTissueTriplets, 1);
-  for it = 1:nTissueTriplets  % it = triplet index
-    Wei3{it} = MD3(AttE1mat, AttE2mat, pmd.Att3{it},...
-      pmd.Dens3{it}, tissue3{it}, 0);
-    dens3{it} = computeDensityMd3(Wei3{it}, pmd.Dens3{it});
-  end
+  md3Tissues = maskIndices(tissue3);
 end
+[Wei2, dens, Wei3, dens3, Vol] = decomposeTissues(AttE1mat, AttE2mat,...
+  pmd.Att2, pmd.Dens2, md2Tissues, pmd.Att3, pmd.Dens3, md3Tissues, 0);
+[~, volPixels] = maskIndices([md2Tissues(:); md3Tissues(:)]);
 
 pmd.densSet = cell(nSavedIter, 1);
 pmd.Wei2Set = cell(nSavedIter, 1);
@@ -177,6 +210,61 @@ end
 
 %% Iterate
 %
+
+% The geometry of the Joseph projections is the same in all iterations.
+% The plan returns only the central Nr2 detector elements, scaled by the
+% pixel size. The C and OpenMP codes store the line integrals of all base
+% materials of a ray adjacently, p is then [Ntbm x Nd x Np], and the
+% polychromatic projections read them in this layout.
+X = length(r2Vec);
+sinoOpts.window = [1+(X-Nr2)/2, X-(X-Nr2)/2];
+sinoOpts.scale = pixsiz;
+if useCode < 3 % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+  sinoOpts.layout = 'interleaved';
+else
+  sinoOpts.layout = 'bins';
+end
+sinoPlan = sinogramJPlan(size(phm1), degVec, r2Vec, smd.interpolation, sinoOpts);
+
+% Resolution levels of the iterations, level 1 is the full resolution.
+% The coarse levels of pmd.coarseSchedule project and reconstruct images
+% coarsened by the image factor, at every angle-factor-th angle. They
+% run the first iterations, the last iteration always runs at the full
+% resolution. Tissue masks, mass fractions and reconstructed images stay
+% at the full resolution: Vol is coarsened before the projection and the
+% reconstruction is interpolated back, see coarsenGrid and refineImage.
+levels = struct('f', 1, 'degVec', degVec, 'r2Vec', r2Vec, 'pixsiz', pixsiz,...
+  'N', smd.N1, 'projLow', pmd.projLow, 'projHigh', pmd.projHigh, 'plan', sinoPlan);
+iterLevel = ones(1, numbIter);
+iterFirst = 1;
+for il = 1:size(pmd.coarseSchedule, 1)
+  f = pmd.coarseSchedule(il, 1);
+  g = pmd.coarseSchedule(il, 2);
+  iterLast = min(iterFirst + pmd.coarseSchedule(il, 3) - 1, numbIter - 1);
+  if iterLast < iterFirst
+    break;
+  end
+  iterLevel(iterFirst:iterLast) = il + 1;
+
+  levProjLow = coarsenGrid(pmd.projLow(:, 1:g:end), f, 1);
+  levProjHigh = coarsenGrid(pmd.projHigh(:, 1:g:end), f, 1);
+  Nd = size(levProjLow, 1);      % odd, the detector center is kept
+  levR2Vec = (-(Nd-1)/2:1:(Nd-1)/2);
+  levN = size(coarsenGrid(phm1, f, [1 2]), 1);
+  levOpts = sinoOpts;
+  levOpts.window = [1, Nd];
+  levOpts.scale = f*pixsiz;
+  lev = struct('f', f, 'degVec', degVec(1:g:end), 'r2Vec', levR2Vec,...
+    'pixsiz', f*pixsiz, 'N', levN, 'projLow', levProjLow, 'projHigh', levProjHigh,...
+    'plan', []);
+  lev.plan = sinogramJPlan([levN levN], lev.degVec, levR2Vec, smd.interpolation, levOpts);
+  levels(il + 1) = lev;
+  clear('levProjLow', 'levProjHigh');
+  fprintf('Iterations %d to %d on %d x %d pixels and %d angles\n',...
+    iterFirst, iterLast, lev.N, lev.N, length(lev.degVec));
+  iterFirst = iterLast + 1;
+end
+
 iterno = numbIter;
 for iter = 1:numbIter
   % Projection generation with Joseph
@@ -186,6 +274,14 @@ for iter = 1:numbIter
   % polychromatic concatination.
   
   fprintf('\nStarting iteration %d...\n', iter);
+  lev = levels(iterLevel(iter));
+  if lev.f > 1
+    VolLev = coarsenGrid(Vol, lev.f, [1 2]);
+    volPixelsLev = find(any(VolLev ~= 0, 3));
+  else
+    VolLev = Vol;
+    volPixelsLev = volPixels;
+  end
 
   % If the previous iteration is to be saved then increment the iteration index.
   % Otherwise the current iteration will overwrite the data of the previous iteration.
@@ -193,151 +289,102 @@ for iter = 1:numbIter
      pmd.curIterIndex = pmd.curIterIndex + 1;
   end
 
-  % Calculate volume fractions v_i (Vol3) from mass fractions w_i (Wei3):
-  %   v_i(x,y) = w_i(x,y) * rho(x,y) / rho_i
-  %   where rho(x,y) = 1/(w_1(x,y)/rho_1 + w_2(x,y)/rho_2 + w_3(x,y)/rho_3)
-  for it = 1:nTissueTriplets  % it = triplet index
-    for i = 1:3
-      Vol3{it}(:,:,i) = Wei3{it}(:,:,i) .* dens3{it} / pmd.Dens3{it}(i);
-    end
-  end
+  disp('Calculating line integrals...')
 
-  % Calculate volume fractions v_i (Vol2) from mass fractions w_i (Wei2):
+  % Vol, the volume fractions v_i of all base materials from the tissue
+  % decomposition, is an array [Nr x Nr x Ntbm], where Ntbm is the total
+  % number of base materials, i.e. the 2*Nt2 + 3*Nt3, see
+  % PhantomModelData.m:
   %   v_i(x,y) = w_i(x,y) * rho(x,y) / rho_i
-  %   where rho(x,y) is determined from 2MD
-  for id = 1:nTissueDoublets  % id = doublet index
-    for ic = 1:2
-      Vol2{id}(:,:,ic) = Wei2{id}(:, :, ic).*dens{id} / pmd.Dens2{id}(ic);
-    end
-  end
-
-  disp('Calculating line integrals...')
-  
-  if pmd.p2MD
-    % l_i is the line integral of volume fraction of ith component, 
-    % l_i = \int v_i(x,y) ds
-    p2 = cell(nTissueDoublets, 1);
-    for id = 1:nTissueDoublets  % id = doublet index
-      for ic = 1:2  % ic = doublet component index
-        porig2 = sinogramJ(Vol2{id}(:,:,ic), degVec, r2Vec, smd.interpolation)';
-        X = size(porig2, 2);
-        p2{id}(:, :, ic) = porig2(:,1+(X-Nr2)/2:X-(X-Nr2)/2)';
-        p2{id}(:, :, ic) = pixsiz * p2{id}(:, :, ic);
-      end
-    end
-  end
-  
-  if pmd.p3MD
-    % l_i is the line integral of volume fraction of ith component,
-    % l_i = \int v_i(x,y) ds
-    p3 = cell(nTissueTriplets, 1);
-    for it = 1:nTissueTriplets  % it = triplet index
-      for ic = 1:3   % ic = triplet component index
-        porig3 = sinogramJ(Vol3{it}(:, :, ic), degVec, r2Vec, smd.interpolation)';
-        X = size(porig3, 2);
-        p3{it}(:, :, ic) = porig3(:,1+(X-Nr2)/2:X-(X-Nr2)/2)';
-        p3{it}(:, :, ic) = pixsiz * p3{it}(:, :, ic);
-      end
-    end
-  end
-  
-  % Compute monoenergetic projections
-  %----------------------------------
-  disp('Calculating monoenergetic projections...')
+  %   where rho(x,y) is determined from 2MD or, for triplets,
+  %   rho(x,y) = 1/(w_1(x,y)/rho_1 + w_2(x,y)/rho_2 + w_3(x,y)/rho_3)
+  % attLow and attHigh are the corresponding tabulated LACs at E_1 and E_2.
+  attLow = [];
+  attHigh = [];
   if pmd.p2MD
-    % p2Low and p2High are radiological paths through the ith component for
-    % E_1 and E_2, respectively
-    p2Low = cell(nTissueDoublets, 1);
-    p2High = cell(nTissueDoublets, 1);
     for id = 1:nTissueDoublets  % id = doublet index
-      for ic = 1:2  % ic = doublet component index
-        p2Low{id}(:, :, ic)  = p2{id}(:, :, ic) * pmd.Att2{id}(1, ic) * 100;
-        p2High{id}(:, :, ic) = p2{id}(:, :, ic) * pmd.Att2{id}(2, ic) * 100;
-      end
+      attLow = [attLow, pmd.Att2{id}(1, :)];
+      attHigh = [attHigh, pmd.Att2{id}(2, :)];
     end
   end
-  
   if pmd.p3MD
-    % p3Low and p3High are radiological paths through the ith component for
-    % E_1 and E_2, respectively
-    p3Low = cell(nTissueTriplets, 1);
-    p3High = cell(nTissueTriplets, 1);
     for it = 1:nTissueTriplets  % it = triplet index
-      for ic = 1:3  % ic = triplet component index 
-        p3Low{it}(:, :, ic)  = p3{it}(:, :, ic) * pmd.Att3{it}(1, ic) * 100;
-        p3High{it}(:, :, ic) = p3{it}(:, :, ic) * pmd.Att3{it}(2, ic) * 100;
-      end
+      attLow = [attLow, pmd.Att3{it}(1, :)];
+      attHigh = [attHigh, pmd.Att3{it}(2, :)];
     end
   end
-  
-  % Compute the radiological paths through all components by
-  % summing contributions from individual components
-  if pmd.p2MD
-    MLow = sum(sum(cat(4, p2Low{:}), 4), 3);
-    MHigh = sum(sum(cat(4, p2High{:}), 4), 3);
+
+  if pmd.fusedProjection && useCode > 0 && useCode < 3 ...
+      && any(smd.interpolation == [2 6])
+    % Compute the line integrals, monoenergetic and polychromatic
+    % projections in one pass, without storing the line integrals p
+    disp('Calculating line integrals and projections...')
+    [ApLow, ApHigh, MLow, MHigh] = computeFusedPolyProjc(VolLev, lev.degVec,...
+      lev.r2Vec, lev.pixsiz, ELow, EHigh, uLow, uHigh, NLow, NHigh, muLow, muHigh,...
+      attLow, attHigh);
   else
-    MLow = 0;
-    MHigh = 0;
-  end
-  
-  if pmd.p3MD
-    MLow = MLow + sum(sum(cat(4, p3Low{:}), 4), 3);
-    MHigh = MHigh + sum(sum(cat(4, p3High{:}), 4), 3);
-  end
+    % l_i is the line integral of volume fraction of ith component, 
+    % l_i = \int v_i(x,y) ds. All components are projected in one call.
+    % p is an array [Ntbm x Nd x Np] or [Nd x Np x Ntbm], see sinoOpts.layout.
+    p = sinogramJExec(lev.plan, VolLev, volPixelsLev);
+
+    % Compute monoenergetic projections
+    %----------------------------------
+    disp('Calculating monoenergetic projections...')
+
+    % Compute the radiological paths through all components for E_1 and E_2
+    % by summing contributions from individual components
+    if strcmp(sinoOpts.layout, 'interleaved')
+      P = reshape(p, size(p, 1), []);
+      MLow = reshape((100 * attLow) * P, size(p, 2), size(p, 3));
+      MHigh = reshape((100 * attHigh) * P, size(p, 2), size(p, 3));
+      clear('P');
+    else
+      sizeP = size(p);
+      MLow = reshape(reshape(p, [], size(p, 3)) * (100 * attLow'), sizeP(1), sizeP(2));
+      MHigh = reshape(reshape(p, [], size(p, 3)) * (100 * attHigh'), sizeP(1), sizeP(2));
+    end
 
-  % Compute polychromatic projections
-  % ---------------------------------
-  disp('Calculating polychromatic projections...')
+    % Compute polychromatic projections
+    % ---------------------------------
+    disp('Calculating polychromatic projections...')
 
-  % p is an array [Nd x Np x Ntbm], where Ntbm is the total number of base
-  % materials, i.e. the 2*Nt2 + 3*Nt3, see PhantomModelData.m
-  if pmd.p2MD
-    for id = 1:nTissueDoublets  % id = doublet index
-      if id == 1
-        p = p2{id};
-      else
-        p = cat(3, p, p2{id});
-      end
-    end
-  end
-  if pmd.p3MD
-    for it = 1:nTissueTriplets  % it = triplet index
-      if ~exist('p','var')
-        p = p3{it};
-      else
-        p = cat(3, p, p3{it});
-      end
+    if pmd.polyProjLUT && useCode < 3 % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+      [ApLow, ApHigh] = computePolyProjLUT(polyLUT, p, sinoOpts.layout);
+    else
+      [ApLow, ApHigh] = computeDualPolyProj(ELow, EHigh, uLow, uHigh,...
+        NLow, NHigh, p, muLow, muHigh, sinoOpts.layout);
     end
+    clear('p');
   end
 
-  switch (useCode) % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
-    case {0, 1, 2}
-      ApLow = computePolyProj(smd.ELow, uLow, smd.NLow, p, pmd.muLow);
-      ApHigh = computePolyProj(smd.EHigh, uHigh, smd.NHigh, p, pmd.muHigh);
-    case 3
-      [ApLow, ApHigh] = computePolyProjc_opencl(smd.ELow, smd.EHigh, uLow, uHigh,...
-        smd.NLow, smd.NHigh, p, pmd.muLow, pmd.muHigh);
-  end
-  clear('p');
-
   % Select reconstruction algorithm
   if pmd.recAlg == 0
-    ZLow  = pmd.projLow + (MLow - ApLow);
-    ZHigh = pmd.projHigh + (MHigh - ApHigh);
+    ZLow  = lev.projLow + (MLow - ApLow);
+    ZHigh = lev.projHigh + (MHigh - ApHigh);
 
     disp('Reconstruction...')
-    recLow = reconstructIteratedProjections(ZLow, r2Vec, degVec, smd.N1, smd.dt1);
-    recHigh = reconstructIteratedProjections(ZHigh, r2Vec, degVec, smd.N1, smd.dt1);
+    rec = reconstructSinograms(reconstructIteratedProjections, ZLow, ZHigh,...
+      lev.r2Vec, lev.degVec, lev.N, lev.f*smd.dt1, pmd.stackedReconstruction);
+    if lev.f > 1
+      rec = refineImage(rec, smd.N1, lev.f);
+    end
+    recLow = rec(:, :, 1);
+    recHigh = rec(:, :, 2);
   else
-    ZLow  = pmd.projLow - ApLow;
-    ZHigh = pmd.projHigh - ApHigh;
+    ZLow  = lev.projLow - ApLow;
+    ZHigh = lev.projHigh - ApHigh;
 
     disp('Reconstruction...')
-    recLow = pmd.recLowSet{pmd.curIterIndex-1} .* smd.mask ...
-      + reconstructIteratedProjections(ZLow, r2Vec, degVec, smd.N1, smd.dt1);
-    recHigh = pmd.recHighSet{pmd.curIterIndex-1} .* smd.mask ...
-      + reconstructIteratedProjections(ZHigh, r2Vec, degVec, smd.N1, smd.dt1); 
+    rec = reconstructSinograms(reconstructIteratedProjections, ZLow, ZHigh,...
+      lev.r2Vec, lev.degVec, lev.N, lev.f*smd.dt1, pmd.stackedReconstruction);
+    if lev.f > 1
+      rec = refineImage(rec, smd.N1, lev.f);
+    end
+    recLow = pmd.recLowSet{pmd.curIterIndex-1} .* smd.mask + rec(:, :, 1);
+    recHigh = pmd.recHighSet{pmd.curIterIndex-1} .* smd.mask + rec(:, :, 2);
   end
+  clear('rec', 'VolLev');
     
   pmd.recLowSet{pmd.curIterIndex} = recLow;
   pmd.recHighSet{pmd.curIterIndex} = recHigh;
@@ -363,23 +410,17 @@ for iter = 1:numbIter
   AttE1mat = 0.01*recLow;		% Change 1/m to 1/cm
   AttE2mat = 0.01*recHigh;
   
+  md2Tissues = {};
+  md3Tissues = {};
   if pmd.p2MD
-    dens = cell(nTissueDoublets, 1);
-    Wei2 = cell(nTissueDoublets, 1);
-    for id = 1:nTissueDoublets  % id = doublet index
-      [Wei2{id}, dens{id}] = MD2(AttE1mat, AttE2mat, pmd.Att2{id},...
-        pmd.Dens2{id}, tissue2{id});
-    end
+    md2Tissues = maskIndices(tissue2);
   end
-  
   if pmd.p3MD
-    Wei3 = cell(nTissueTriplets, 1);
-    dens3 = cell(nTissueTriplets, 1);
-    for it = 1:nTissueTriplets  % it = triplet index
-      Wei3{it} = MD3(AttE1mat, AttE2mat, pmd.Att3{it}, pmd.Dens3{it}, tissue3{it}, 0);
-      dens3{it} = computeDensityMd3(Wei3{it}, pmd.Dens3{it});
-    end
+    md3Tissues = maskIndices(tissue3);
   end
+  [Wei2, dens, Wei3, dens3, Vol] = decomposeTissues(AttE1mat, AttE2mat,...
+    pmd.Att2, pmd.Dens2, md2Tissues, pmd.Att3, pmd.Dens3, md3Tissues, 0);
+  [~, volPixels] = maskIndices([md2Tissues(:); md3Tissues(:)]);
   
   if pmd.p2MD
     pmd.densSet{pmd.curIterIndex} = dens;
@@ -402,6 +443,11 @@ for iter = 1:numbIter
   end
 end
 
+for il = 1:length(levels)
+  sinogramJDestroy(levels(il).plan);
+end
+clear('levels');
+
 pmd.curIterIndex = -1; % This state variable indicates the end of DIRA.
 
 %% Save results
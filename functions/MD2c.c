@@ -12,10 +12,11 @@
 
 #include <math.h>
 #include "mex.h"
+#include "mexInputAccess.h"
 
 static void 
-MD2(double *Wei2Ptr, double *densPtr, double *atte1matPtr, double *atte2matPtr,
-    double *att2Ptr, double *dens2Ptr, bool *maskPtr, int M,
+MD2(double *Wei2Ptr, double *densPtr, const double *atte1matPtr, const double *atte2matPtr,
+    const double *att2Ptr, const double *dens2Ptr, const mxLogical *maskPtr, int M,
     int N, int image_size);
 
 static char rcs_id[] = "$Revision: 1.10 $";
@@ -39,33 +40,19 @@ static char rcs_id[] = "$Revision: 1.10 $";
 void 
 mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
 {
-  double *atte1matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E1 */
-  double *atte2matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E2 */
-  double *att2Ptr;    /* 2x2 pointer to array of tabled attenuation coefficients*/
-  double *dens2Ptr;     /* 1x2 pointer to mass density of doublet base materials */
-  bool *maskPtr;      /* 511x511 pointer to mask defining the tissue to be decomposed*/
-  
-  /* temp pointers for copying values */
-  double *from_doublePtr;   
-  double *to_doublePtr;   
-  bool *boolPtr1;
-  bool *boolPtr2;
+  const double *atte1matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E1 */
+  const double *atte2matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E2 */
+  const double *att2Ptr;    /* 2x2 pointer to array of tabled attenuation coefficients*/
+  const double *dens2Ptr;     /* 1x2 pointer to mass density of doublet base materials */
+  const mxLogical *maskPtr;      /* 511x511 pointer to mask defining the tissue to be decomposed*/
   
   int N;    /* columns of the image to process */
   int M;     /* rows of the image to process */
   int image_size;     /* Total image size, columns * rows */
   
-  int att2_columns;
-  int att2_rows;
-  int att2_size;
-  
-  int dens2_columns;
-  int dens2_rows;
-  int dens2_size;
-  
   int k;          /* Loop counter */
   int ndim;         /* Number of dimensions for WEI2 output array */
-  int dims[3];      /* Array specifying the dimensions for WEI2 array */
+  mwSize dims[3];   /* Array specifying the dimensions for WEI2 array */
   
   /* Check validity of arguments */
   if (nrhs != 5)
@@ -78,66 +65,33 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
     mexErrMsgTxt("Incorrect number of OUTPUT arguments.");
   }
   
-  if (mxIsSparse(ATTE1MAT) || mxIsSparse(ATTE2MAT) || mxIsSparse(ATT2) || mxIsSparse(DENS2) || mxIsSparse(MASK))
-  {
-    mexErrMsgTxt("Sparse inputs not supported.");
-  }
-  
-  if (!mxIsDouble(ATTE1MAT) || !mxIsDouble(ATTE2MAT) || !mxIsDouble(ATT2) || !mxIsDouble(DENS2) )
+  for (k = 0; k < nrhs; k++)
   {
-    mexErrMsgTxt("Input must be double.");
+    if (mxIsSparse(prhs[k]))
+      mexErrMsgTxt("Sparse inputs not supported.");
+    if (!mxIsNumeric(prhs[k]) && !mxIsLogical(prhs[k]))
+      mexErrMsgTxt("Input must be numeric or logical.");
   }
   
-  if (!mxIsLogical(MASK))
-  {
-    mexErrMsgTxt("MASK must be logical.");
-  }
-  
-  /* Allocate memory for the arrays */
- 
   N = mxGetN(ATTE1MAT);
   M = mxGetM(ATTE1MAT);
   image_size = M* N; 
-  atte1matPtr = (double *) mxCalloc(image_size, sizeof(double));
-  atte2matPtr = (double *) mxCalloc(image_size, sizeof(double));
-  maskPtr = (bool *) mxCalloc(image_size, sizeof(bool));
-  
-  att2_columns = mxGetN(ATT2);
-  att2_rows = mxGetM(ATT2);
-  att2_size = att2_rows * att2_columns;
-  att2Ptr = (double *) mxCalloc(att2_size, sizeof(double));
   
-  dens2_columns = mxGetN(DENS2);
-  dens2_rows = mxGetM(DENS2);
-  dens2_size = dens2_rows* dens2_columns; 
-  dens2Ptr = (double *) mxCalloc(dens2_size, sizeof(double));
-  
-  
-  /* Copy all data */
-  from_doublePtr = mxGetPr(ATTE1MAT);
-  to_doublePtr = atte1matPtr;
-  for (k = 0; k < image_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
-  
-  from_doublePtr = mxGetPr(ATTE2MAT);
-  to_doublePtr = atte2matPtr;
-  for (k = 0; k < image_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
-  
-  from_doublePtr = mxGetPr(ATT2);
-  to_doublePtr = att2Ptr;
-  for (k = 0; k < att2_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
-  
-  from_doublePtr = mxGetPr(DENS2);
-  to_doublePtr = dens2Ptr;
-  for (k = 0; k < dens2_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
+  if (mxGetNumberOfElements(ATTE2MAT) != image_size || mxGetNumberOfElements(MASK) != image_size)
+  {
+    mexErrMsgTxt("AttE1mat, AttE2mat and mask must have the same size.");
+  }
+  if (mxGetNumberOfElements(ATT2) < 4 || mxGetNumberOfElements(DENS2) < 2)
+  {
+    mexErrMsgTxt("Att2 must be 2x2 and Dens2 1x2.");
+  }
   
-  boolPtr1 = mxGetLogicals(MASK);
-  boolPtr2 = maskPtr;
-  for (k = 0; k < image_size; k++)
-  *(boolPtr2++) = *(boolPtr1++);
+  /* Read the inputs in place, double and logical inputs are not copied */
+  atte1matPtr = mexInputDoubles(ATTE1MAT);
+  atte2matPtr = mexInputDoubles(ATTE2MAT);
+  att2Ptr = mexInputDoubles(ATT2);
+  dens2Ptr = mexInputDoubles(DENS2);
+  maskPtr = mexInputLogicals(MASK);
   
   DENS = mxCreateDoubleMatrix(M, N, mxREAL);
   
@@ -149,11 +103,18 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   
   MD2(mxGetPr(WEI2), mxGetPr(DENS), atte1matPtr, atte2matPtr, att2Ptr, dens2Ptr,
       maskPtr,M, N, image_size);
+  
+  mexInputRelease(atte1matPtr, ATTE1MAT);
+  mexInputRelease(atte2matPtr, ATTE2MAT);
+  mexInputRelease(att2Ptr, ATT2);
+  mexInputRelease(dens2Ptr, DENS2);
+  mexInputRelease(maskPtr, MASK);
+  mexInputReport("MD2c");
 }
 
 static void 
-MD2(double *Wei2Ptr, double *densPtr, double *atte1matPtr, double *atte2matPtr,
-    double *att2Ptr, double *dens2Ptr, bool *maskPtr, int M,
+MD2(double *Wei2Ptr, double *densPtr, const double *atte1matPtr, const double *atte2matPtr,
+    const double *att2Ptr, const double *dens2Ptr, const mxLogical *maskPtr, int M,
     int N, int image_size)
 {  
   /* Loop variables */
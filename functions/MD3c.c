@@ -12,10 +12,11 @@
 
 #include <math.h>
 #include "mex.h"
+#include "mexInputAccess.h"
 
 static void 
-MD3(double *Wei3Ptr, double *atte1matPtr, double *atte2matPtr,
-    double *att3Ptr, double *dens3Ptr, bool *maskPtr, int isspecial,
+MD3(double *Wei3Ptr, const double *atte1matPtr, const double *atte2matPtr,
+    const double *att3Ptr, const double *dens3Ptr, const mxLogical *maskPtr, int isspecial,
     int M, int N, int image_size);
 
 static char rcs_id[] = "$Revision: 1.10 $";
@@ -39,39 +40,21 @@ void
 mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
 {
   /* Input pointers */
-  double *atte1matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E1 */
-  double *atte2matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E2 */
-  double *att3Ptr;    /* 2x2 pointer to array of tabled attenuation coefficients*/
-  double *dens3Ptr;     /* 1x2 pointer to mass density of doublet base materials */
-  bool *maskPtr;      /* 511x511 pointer to mask defining the tissue to be decomposed*/
-  
-  
-  /* temp pointers for copying values */
-  double *from_doublePtr;   
-  double *to_doublePtr;   
-  int *intPtr;
-  bool *from_boolPtr;
-  bool *to_boolPtr;
+  const double *atte1matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E1 */
+  const double *atte2matPtr;  /* 511x511 pointer to array of measured attenuation coefficients at energy E2 */
+  const double *att3Ptr;    /* 2x2 pointer to array of tabled attenuation coefficients*/
+  const double *dens3Ptr;     /* 1x2 pointer to mass density of doublet base materials */
+  const mxLogical *maskPtr;      /* 511x511 pointer to mask defining the tissue to be decomposed*/
   
   int N;    /* columns of the image to process */
   int M;     /* rows of the image to process */
   int image_size;     /* Total image size, columns * rows */
   
-  /* Size of the 2x2 attenuation coefficients */
-  int att3_columns;
-  int att3_rows;
-  int att3_size;
-  
-  /* Size of the 2x2 density coefficients */
-  int dens3_columns;
-  int dens3_rows;
-  int dens3_size;
-
   int isspecial;
   
   int k;      /* Loop counter */
   int ndim;     /* Number of dimensions for WEI3 output array */
-  int dims[3];    /* Array specifying the dimensions for WEI3 array */
+  mwSize dims[3]; /* Array specifying the dimensions for WEI3 array */
   
   /* Check validity of arguments */
   if (nrhs != 6)
@@ -84,77 +67,37 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
     mexErrMsgTxt("Incorrect number of OUTPUT arguments.");
   }
   
-  if (mxIsSparse(ATTE1MAT) || mxIsSparse(ATTE2MAT) || mxIsSparse(ATT3) || mxIsSparse(DENS3) || mxIsSparse(MASK))
-  {
-    mexErrMsgTxt("Sparse inputs not supported.");
-  }
-  
-  if (!mxIsDouble(ATTE1MAT) || !mxIsDouble(ATTE2MAT) || !mxIsDouble(ATT3) 
-    || !mxIsDouble(DENS3) || !mxIsDouble(ISSPECIAL))
-  {
-    mexErrMsgTxt("Input must be double.");
-  }
-
-  if (!mxIsLogical(MASK) )
+  for (k = 0; k < nrhs; k++)
   {
-    mexErrMsgTxt("Mask must be logical.");
+    if (mxIsSparse(prhs[k]))
+      mexErrMsgTxt("Sparse inputs not supported.");
+    if (!mxIsNumeric(prhs[k]) && !mxIsLogical(prhs[k]))
+      mexErrMsgTxt("Input must be numeric or logical.");
   }
-
-  
-  /**
-   * Matrix allocation
-   */
   
   /* Get the size of the image */
   N = mxGetN(ATTE1MAT);
   M = mxGetM(ATTE1MAT);
   image_size = M * N; 
   
-  /* Allocate memory */
-  atte1matPtr = (double *) mxCalloc(image_size, sizeof(double));
-  atte2matPtr = (double *) mxCalloc(image_size, sizeof(double));
-  maskPtr = (bool *) mxCalloc(image_size, sizeof(bool));
-  
-  att3_columns = mxGetN(ATT3);
-  att3_rows = mxGetM(ATT3);
-  att3_size = att3_rows * att3_columns;
-  att3Ptr = (double *) mxCalloc(att3_size, sizeof(double));
-  
-  dens3_columns = mxGetN(DENS3);
-  dens3_rows = mxGetM(DENS3);
-  dens3_size = dens3_rows* dens3_columns; 
-  dens3Ptr = (double *) mxCalloc(dens3_size, sizeof(double));
-  
-  
-  /* Copy all data */
-  from_doublePtr = mxGetPr(ATTE1MAT);
-  to_doublePtr = atte1matPtr;
-  for (k = 0; k < image_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
-  
-  from_doublePtr = mxGetPr(ATTE2MAT);
-  to_doublePtr = atte2matPtr;
-  for (k = 0; k < image_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
-  
-  from_doublePtr = mxGetPr(ATT3);
-  to_doublePtr = att3Ptr;
-  for (k = 0; k < att3_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
-  
-  from_doublePtr = mxGetPr(DENS3);
-  to_doublePtr = dens3Ptr;
-  for (k = 0; k < dens3_size; k++)
-  *(to_doublePtr++) = *(from_doublePtr++);
+  if (mxGetNumberOfElements(ATTE2MAT) != image_size || mxGetNumberOfElements(MASK) != image_size)
+  {
+    mexErrMsgTxt("AttE1mat, AttE2mat and mask must have the same size.");
+  }
+  if (mxGetNumberOfElements(ATT3) < 6 || mxGetNumberOfElements(DENS3) < 3)
+  {
+    mexErrMsgTxt("Att3 must be 2x3 and Dens3 1x3.");
+  }
   
-  from_boolPtr = mxGetLogicals(MASK);
-  to_boolPtr = maskPtr;
-  for (k = 0; k < image_size; k++)
-  *(to_boolPtr++) = *(from_boolPtr++);
+  /* Read the inputs in place, double and logical inputs are not copied */
+  atte1matPtr = mexInputDoubles(ATTE1MAT);
+  atte2matPtr = mexInputDoubles(ATTE2MAT);
+  att3Ptr = mexInputDoubles(ATT3);
+  dens3Ptr = mexInputDoubles(DENS3);
+  maskPtr = mexInputLogicals(MASK);
   
   /* isSpecial */
-  from_doublePtr = mxGetPr(ISSPECIAL);
-  isspecial = (int)*from_doublePtr;  
+  isspecial = (int) mxGetScalar(ISSPECIAL);
   
   ndim = 3;
   dims[0] = M;
@@ -164,11 +107,18 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   
   MD3(mxGetPr(WEI3), atte1matPtr, atte2matPtr, att3Ptr, dens3Ptr,
       maskPtr, isspecial, M, N, image_size);
+  
+  mexInputRelease(atte1matPtr, ATTE1MAT);
+  mexInputRelease(atte2matPtr, ATTE2MAT);
+  mexInputRelease(att3Ptr, ATT3);
+  mexInputRelease(dens3Ptr, DENS3);
+  mexInputRelease(maskPtr, MASK);
+  mexInputReport("MD3c");
 }
 
 static void 
-MD3(double *Wei3Ptr, double *atte1matPtr, double *atte2matPtr,
-    double *att3Ptr, double *dens3Ptr, bool *maskPtr, int isspecial,
+MD3(double *Wei3Ptr, const double *atte1matPtr, const double *atte2matPtr,
+    const double *att3Ptr, const double *dens3Ptr, const mxLogical *maskPtr, int isspecial,
     int M, int N, int image_size)
 {  
   /* Loop variables */
@@ -45,6 +45,15 @@ classdef PhantomModelData < handle
     muLow         % [Ncl x (Nt2+Nt3) double] LACs of doublets and triplets at spectrum energies
     muHigh        % [Nch x (Nt2+Nt3) double] LACs of doublets and triplets at spectrum energies
     isPlotting    % Boolean. If set to false, some functions will not plot figures.
+    fusedProjection = false % Boolean. If set to true, DIRA computes projections in one pass (C, OpenMP).
+    spectrumTolerance = [] % Maximum error of Ap allowed by spectral compression, [] = no compression.
+    polyProjLUT = false % Boolean. If set to true, DIRA computes polychromatic projections by table lookup.
+    coarseSchedule = [] % [L x 3 double] rows [image factor, angle factor, iterations]. DIRA runs the first
+                        % iterations on coarser images and angle sets, e.g. [2 4 2] runs 2 iterations on
+                        % 255 px and 180 angles for Nr = 511 and 720 angles. [] = full resolution only.
+    stackedReconstruction = false % Boolean. If set to true, user supplied reconstruction functions are passed
+                                  % the low and high energy sinograms as one stack [len x numAngles x 2],
+                                  % see reconstructSinograms. The functions shipped with DIRA always are.
   end
 
   methods
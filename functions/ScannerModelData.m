@@ -23,6 +23,16 @@ classdef ScannerModelData < handle
   end
 
   methods
+    function [betaVec, gammaVec, Lp] = FanGeometry(smd, pixsiz)
+      % Source angles (degrees), fan angles (rad) and source distance (pixels)
+      % of the native fan-beam projections, see sinogramFanJ and fanFBP.
+      % Reverse gammaVec if the detector elements are numbered in the
+      % opposite direction (fb = 1 in rebinning.m).
+      betaVec = (0:smd.M0-1) * smd.dfi0;
+      gammaVec = ((0:smd.N0-1) - (smd.N0-1)/2) * smd.dt0;
+      Lp = smd.L / pixsiz;
+    end
+
     function PlotSpectra(smd, varargin)
       % Plot energy spectra
       plot(smd.EHigh, smd.NHigh, '.-', smd.ELow, smd.NLow, '.-', varargin{:})
@@ -0,0 +1,167 @@
+/*-------------------------------------------------------------------*/
+/* Fan-beam backprojection for equiangular detectors, the adjoint    */
+/* geometry of sinogramFanJc.c. For every pixel and source angle the */
+/* fan angle gamma of the ray through the pixel is computed, the     */
+/* projection is interpolated linearly at gamma and weighted by the  */
+/* inverse squared distance between the source and the pixel:        */
+/*                                                                   */
+/*   f(x,y) = sum_k Q_k(gamma(x,y,beta_k)) / D(x,y,beta_k)^2         */
+/*                                                                   */
+/* Usage:                                                            */
+/*   f = backprojectFanc(Q, beta, gamma, L, N)                       */
+/*   Q:     [numel(gamma) x numel(beta)] filtered projections        */
+/*   beta:  source angles in degrees                                 */
+/*   gamma: fan angles of the detector elements in radians, equally  */
+/*          spaced                                                   */
+/*   L:     distance source - rotation center in pixels              */
+/*   N:     size of the N x N output image                           */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include "mex.h"
+
+static void backprojectFan(double *fPtr, double *qPtr, double *betaPtr, double gamma0,
+			   double dgamma, double L, int N, int numAngles, int numRays);
+
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+#define PI 3.14159265358979
+
+/* Input Arguments */
+#define Q      (prhs[0])
+#define BETA   (prhs[1])
+#define GAMMA  (prhs[2])
+#define L_IN   (prhs[3])
+#define N_IN   (prhs[4])
+
+/* Output Arguments */
+#define	F      (plhs[0])
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  int numAngles;		/* number of source angles */
+  int numRays;			/* number of rays per projection */
+  double *betaPtr;		/* pointer to source angles in radians */
+  double *gammaPtr;		/* pointer to fan angles */
+  double dgamma;		/* fan angle increment */
+  double deg2rad;		/* conversion factor */
+  int k;                /* loop counter */
+  int N;                /* output image size */
+
+  /* Check validity of arguments */
+  if (nrhs != 5)
+  {
+      mexErrMsgTxt("Usage: f = backprojectFanc(Q, beta, gamma, L, N)");
+  }
+  if (nlhs > 1)
+  {
+      mexErrMsgTxt("Too many output arguments to BACKPROJECTFAN");
+  }
+  if (mxIsSparse(Q) || mxIsComplex(Q))
+  {
+      mexErrMsgTxt("Sparse or complex inputs not supported");
+  }
+  if (!mxIsDouble(Q) || !mxIsDouble(BETA) || !mxIsDouble(GAMMA))
+  {
+      mexErrMsgTxt("Inputs must be double");
+  }
+
+  numAngles = mxGetNumberOfElements(BETA);
+  numRays = mxGetNumberOfElements(GAMMA);
+  if (mxGetM(Q) != numRays || mxGetN(Q) != numAngles)
+  {
+      mexErrMsgTxt("Q must be [numel(gamma) x numel(beta)]");
+  }
+  if (numRays < 2)
+  {
+      mexErrMsgTxt("At least two fan angles are needed");
+  }
+
+  /* Get BETA degree values and convert to radians */
+  deg2rad = PI / 180.0;
+  betaPtr = (double *) mxCalloc(numAngles, sizeof(double));
+  for (k = 0; k < numAngles; k++)
+    betaPtr[k] = mxGetPr(BETA)[k] * deg2rad;
+
+  gammaPtr = mxGetPr(GAMMA);
+  dgamma = (gammaPtr[numRays-1] - gammaPtr[0]) / (numRays - 1);
+
+  N = (int) mxGetScalar(N_IN);
+  F = mxCreateDoubleMatrix(N, N, mxREAL);
+  backprojectFan(mxGetPr(F), mxGetPr(Q), betaPtr, gammaPtr[0], dgamma, mxGetScalar(L_IN),
+		 N, numAngles, numRays);
+
+  mxFree(betaPtr);
+}
+
+static void
+backprojectFan(double *fPtr, double *qPtr, double *betaPtr, double gamma0, double dgamma,
+	       double L, int N, int numAngles, int numRays)
+{
+  int x,y,k;                                     /* Loop variables */
+  int origin;                                    /* Center of image */
+  double xdist, ydist;                           /* Distance in carthesian coordinates to image center */
+  double *cosine, *sine;                         /* Precalculated values for all source angles */
+  double sourceX, sourceY;                       /* Source position */
+  double vx, vy;                                 /* Vector from the source to the pixel */
+  double dot, cross;                             /* Projections of v on the central ray */
+  double gamma;                                  /* Fan angle of the ray through the pixel */
+  double u;                                      /* Position on the detector in elements */
+  int u_index;                                   /* Position as integer to index the projection */
+  double fraction;                               /* Fraction of the position */
+  double sum;                                    /* Backprojected value of the current pixel */
+  double *column;                                /* Current projection */
+
+  origin = MAX(0, (N-1)/2);
+
+  cosine = (double *) malloc(numAngles * sizeof(double));
+  sine   = (double *) malloc(numAngles * sizeof(double));
+  for(k=0;k<numAngles;++k)
+  {
+    cosine[k] = cos(-betaPtr[k]);
+    sine[k]   = sin(-betaPtr[k]);
+  }
+
+  #pragma omp parallel for private(x, k, xdist, ydist, sourceX, sourceY, vx, vy,\
+                                   dot, cross, gamma, u, u_index, fraction, sum, column)
+  for(y=0;y<N;++y)
+  {
+    for(x=0;x<N;++x)
+    {
+      xdist = y - origin;
+      ydist = x - origin;
+      sum = 0;
+      for(k=0;k<numAngles;++k)
+      {
+        /* The source is at L*(sin, -cos) and the central ray points along
+         * (-sin, cos), see sinogramFanJc.c */
+        sourceX =  L*sine[k];
+        sourceY = -L*cosine[k];
+        vx = xdist - sourceX;
+        vy = ydist - sourceY;
+        dot   = -sine[k]*vx + cosine[k]*vy;
+        cross = -sine[k]*vy - cosine[k]*vx;
+        gamma = -atan2(cross, dot);
+
+        u = (gamma - gamma0) / dgamma;
+        if(u < 0 || u > numRays - 1)
+          continue;
+        u_index = (int) u;
+        fraction = u - u_index;
+        column = qPtr + k*numRays;
+        if(u_index == numRays - 1)
+          sum += column[u_index] / (vx*vx + vy*vy);
+        else
+          sum += (column[u_index] + fraction*(column[u_index + 1] - column[u_index])) /
+                 (vx*vx + vy*vy);
+      }
+      fPtr[y*N + x] = sum;
+    }
+  }
+
+  free(cosine);
+  free(sine);
+}
@@ -0,0 +1,548 @@
+/*-------------------------------------------------------------------*/
+/* Hierarchical backprojection of parallel projections, a fast       */
+/* approximation of backprojectc with the same image axes and        */
+/* projection center.                                                */
+/*                                                                   */
+/* The image is split recursively into quadrants. A projection is    */
+/* passed to a quadrant by shifting its detector coordinate to the   */
+/* center of the quadrant, which does not change the samples. The    */
+/* smaller a region is, the fewer angles it needs: a ray through a   */
+/* pixel at the distance r from the center of the region moves by    */
+/* at most r*|dtheta| if the projection is backprojected at an angle */
+/* dtheta off its own. Every summed projection keeps the range of    */
+/* the original angles in it. Adjacent projections are summed to one */
+/* at the center of their range as long as the range displaces no    */
+/* ray of the region by more than the accuracy parameter, so the     */
+/* number of angles follows the accuracy continuously. A region only */
+/* sums its projections where that is cheaper than backprojecting    */
+/* them, it shifts them otherwise, and a region none of whose        */
+/* subregions sums projections is backprojected directly. The        */
+/* projections are interpolated linearly, the summed ones are        */
+/* sampled at OVERSAMPLING samples per detector element to limit the */
+/* blur of the repeated interpolation. Regions of LEAF_SIZE pixels   */
+/* are backprojected directly. With the number of angles             */
+/* proportional to N, the cost is O(N^2 log N) instead of O(N^3) for */
+/* the direct backprojection.                                        */
+/*                                                                   */
+/* The image is split into tiles of TILE_SIZE pixels, which are      */
+/* distributed over the threads.                                     */
+/*                                                                   */
+/* Usage:                                                            */
+/*   img = backprojectHierc(P, theta, N, interp, accuracy)           */
+/*   P:        [len x numAngles] filtered projections                */
+/*   theta:    projection angles in radians                          */
+/*   N:        size of the N x N output image                        */
+/*   interp:   0 for nearest neighbour, 1 for linear interpolation   */
+/*             in the direct backprojection of the smallest regions  */
+/*   accuracy: largest displacement of a ray by the summation of     */
+/*             angles, per region, in detector elements, e.g. 0.25.  */
+/*             Smaller values are more accurate and slower.          */
+/*   img:      [N x N] backprojected image, not scaled               */
+/*                                                                   */
+/* See compareBackprojection.m for the error against backprojectc.   */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "mexInputAccess.h"
+
+/* Input Arguments */
+#define P        (prhs[0])
+#define THETA    (prhs[1])
+#define N_SIZE   (prhs[2])
+#define INTERP   (prhs[3])
+#define ACCURACY (prhs[4])
+
+/* Output Arguments */
+#define IMG      (plhs[0])
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+/* Regions of at most LEAF_SIZE x LEAF_SIZE pixels are backprojected directly */
+#define LEAF_SIZE 8
+
+/* The threads compute tiles of TILE_SIZE x TILE_SIZE pixels */
+#define TILE_SIZE 64
+
+/* Samples of a summed projection beyond the radius of its region */
+#define MARGIN 2
+
+/* Samples per detector element of the summed projections */
+#define OVERSAMPLING 2
+
+/* Cost of interpolating a sample of a summed projection, relative to
+ * adding a projection to a pixel */
+#define INTERPOLATION_COST 2
+
+/* Projections of a region, the detector coordinate t is relative to the
+ * center of the region */
+typedef struct
+{
+  int numAngles;
+  double *theta;              /* angles, ascending */
+  double *cosine, *sine;
+  double *low, *high;         /* range of the original angles in every projection */
+  const double **data;        /* samples of every projection */
+  double *start;              /* t of the first sample of every projection */
+  int *length;                /* number of samples of every projection */
+  double scale;               /* samples per detector element */
+  int original;               /* nonzero if data are the input projections */
+  double *samples;            /* samples of summed projections, owned by the set */
+} projectionSet;
+
+/* Image and parameters shared by all regions */
+typedef struct
+{
+  double *img;
+  int N;
+  double xleft, ytop;         /* coordinates of the upper left pixel */
+  double accuracy;
+  int interp;
+  int qCenter;                /* sample of t = 0 in the input projections */
+} imageInfo;
+
+static int compareAngles(const void *a, const void *b);
+static void backprojectRegion(const imageInfo *info, const projectionSet *set,
+                              int col0, int numCols, int row0, int numRows);
+static void backprojectLeaf(const imageInfo *info, const projectionSet *set,
+                            int col0, int numCols, int row0, int numRows);
+static int groupAngles(const projectionSet *set, double radius, double accuracy, int *first);
+static int summedLength(double radius);
+static int summingPays(int numAngles, int numGroups, double radius);
+static void createSubSet(projectionSet *sub, const projectionSet *set, double dx, double dy,
+                         double radius, double accuracy);
+static void allocateSet(projectionSet *set, int numAngles);
+static void freeSet(projectionSet *set);
+static double interpolate(const double *data, int length, double u);
+
+static const double *sortTheta;   /* angles compared by compareAngles */
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  const double *pPtr;         /* projections */
+  const double *thetaPtr;     /* projection angles */
+  double *q;                  /* zero padded projections */
+  int *order;                 /* projections by ascending angle */
+  projectionSet set;          /* projections relative to the origin */
+  imageInfo info;
+  int len;                    /* length of the projections */
+  int numAngles;              /* number of projection angles */
+  int N;                      /* size of the output image */
+  int pad;                    /* number of zeros before and after a projection */
+  int qLength, qCenter;       /* length and center of the padded projections */
+  int numTiles;               /* number of tiles along each image axis */
+  int tile, col0, row0, k;
+
+  /* Check validity of arguments */
+  if (nrhs != 5)
+  {
+    mexErrMsgTxt("Usage: img = backprojectHierc(P, theta, N, interp, accuracy)");
+  }
+  if (nlhs > 1)
+  {
+    mexErrMsgTxt("Too many output arguments to BACKPROJECTHIERC");
+  }
+  if (mxIsSparse(P) || mxIsComplex(P) || !mxIsNumeric(P) || !mxIsNumeric(THETA))
+  {
+    mexErrMsgTxt("Projections and angles must be real and numeric.");
+  }
+
+  len = mxGetM(P);
+  numAngles = mxGetNumberOfElements(THETA);
+  N = (int) mxGetScalar(N_SIZE);
+  info.interp = (int) mxGetScalar(INTERP);
+  info.accuracy = mxGetScalar(ACCURACY);
+  if (mxGetNumberOfDimensions(P) > 2 || mxGetN(P) != (size_t) numAngles)
+  {
+    mexErrMsgTxt("P must have one column per angle.");
+  }
+  if (N < 0)
+  {
+    mexErrMsgTxt("N must be positive.");
+  }
+  if (!(info.accuracy >= 0))
+  {
+    mexErrMsgTxt("Accuracy must not be negative.");
+  }
+
+  IMG = mxCreateDoubleMatrix(N, N, mxREAL);
+  if (N == 0 || numAngles == 0)
+    return;
+
+  /* As in backprojectc, the padding keeps all pixels in the projections */
+  pad = (int) ceil(N/sqrt(2.0)) + 2;
+  qLength = len + 2*pad;
+  qCenter = pad + (len + 1)/2 - 1;
+
+  pPtr = mexInputDoubles(P);
+  q = (double *) mxCalloc((size_t) qLength * numAngles, sizeof(double));
+  for (k = 0; k < numAngles; k++)
+    memcpy(q + (size_t) k*qLength + pad, pPtr + (size_t) k*len, len * sizeof(double));
+  mexInputRelease(pPtr, P);
+
+  /* Sort the angles, adjacent angles are summed */
+  thetaPtr = mexInputDoubles(THETA);
+  order = (int *) mxMalloc(numAngles * sizeof(int));
+  for (k = 0; k < numAngles; k++)
+    order[k] = k;
+  sortTheta = thetaPtr;
+  qsort(order, numAngles, sizeof(int), compareAngles);
+
+  allocateSet(&set, numAngles);
+  for (k = 0; k < numAngles; k++)
+  {
+    set.theta[k] = thetaPtr[order[k]];
+    set.cosine[k] = cos(set.theta[k]);
+    set.sine[k] = sin(set.theta[k]);
+    set.low[k] = set.theta[k];
+    set.high[k] = set.theta[k];
+    set.data[k] = q + (size_t) order[k]*qLength;
+    set.start[k] = -qCenter;
+    set.length[k] = qLength;
+  }
+  set.scale = 1;
+  set.original = 1;
+  mexInputRelease(thetaPtr, THETA);
+
+  info.img = mxGetPr(IMG);
+  info.N = N;
+  info.xleft = -floor((N - 1)/2.0);
+  info.ytop = -info.xleft;
+  info.qCenter = qCenter;
+  numTiles = (N + TILE_SIZE - 1)/TILE_SIZE;
+
+  #pragma omp parallel for private(col0, row0) schedule(dynamic)
+  for (tile = 0; tile < numTiles*numTiles; tile++)
+  {
+    projectionSet tileSet;    /* projections relative to the center of the tile */
+    int numCols, numRows;
+
+    col0 = (tile/numTiles)*TILE_SIZE;
+    row0 = (tile%numTiles)*TILE_SIZE;
+    numCols = MIN(TILE_SIZE, N - col0);
+    numRows = MIN(TILE_SIZE, N - row0);
+
+    createSubSet(&tileSet, &set, info.xleft + col0 + (numCols - 1)/2.0,
+                 info.ytop - row0 - (numRows - 1)/2.0,
+                 0.5*sqrt((double) (numCols - 1)*(numCols - 1) + (numRows - 1)*(numRows - 1)),
+                 info.accuracy);
+    backprojectRegion(&info, &tileSet, col0, numCols, row0, numRows);
+    freeSet(&tileSet);
+  }
+
+  freeSet(&set);
+  mxFree(order);
+  mxFree(q);
+}
+
+static int
+compareAngles(const void *a, const void *b)
+{
+  const double thetaA = sortTheta[*(const int *) a];
+  const double thetaB = sortTheta[*(const int *) b];
+
+  return (thetaA > thetaB) - (thetaA < thetaB);
+}
+
+/* Backprojects set, relative to the center of the region, to the region
+ * [col0, col0 + numCols) x [row0, row0 + numRows) */
+static void
+backprojectRegion(const imageInfo *info, const projectionSet *set,
+                  int col0, int numCols, int row0, int numRows)
+{
+  projectionSet subSet;       /* projections relative to the center of a quadrant */
+  int cols[2], rows[2];       /* sizes of the quadrants */
+  int i, j, subCol0, subRow0;
+  double dx, dy;              /* center of a quadrant relative to the region */
+  int *first;                 /* groups of the angles in the subregions */
+  int size, subSize, sums;
+  double radius;
+
+  if (MAX(numCols, numRows) <= LEAF_SIZE || set->numAngles == 1)
+  {
+    backprojectLeaf(info, set, col0, numCols, row0, numRows);
+    return;
+  }
+
+  /* If no subregion down to the leaves sums the projections, only the
+   * overhead of the recursion would remain, the region is backprojected
+   * directly */
+  first = (int *) malloc((set->numAngles + 1) * sizeof(int));
+  sums = 0;
+  for (size = MAX(numCols, numRows); size > LEAF_SIZE && !sums; size = subSize)
+  {
+    subSize = (size + 1)/2;
+    radius = 0.5*sqrt(2.0)*(subSize - 1);
+    sums = summingPays(set->numAngles,
+                       groupAngles(set, radius, info->accuracy, first), radius);
+  }
+  free(first);
+  if (!sums)
+  {
+    backprojectLeaf(info, set, col0, numCols, row0, numRows);
+    return;
+  }
+
+  cols[0] = (numCols + 1)/2;
+  cols[1] = numCols - cols[0];
+  rows[0] = (numRows + 1)/2;
+  rows[1] = numRows - rows[0];
+
+  for (i = 0; i < 2; i++)
+  {
+    for (j = 0; j < 2; j++)
+    {
+      if (cols[i] == 0 || rows[j] == 0)
+        continue;
+      subCol0 = col0 + i*cols[0];
+      subRow0 = row0 + j*rows[0];
+      dx = (subCol0 + (cols[i] - 1)/2.0) - (col0 + (numCols - 1)/2.0);
+      dy = -((subRow0 + (rows[j] - 1)/2.0) - (row0 + (numRows - 1)/2.0));
+
+      createSubSet(&subSet, set, dx, dy,
+                   0.5*sqrt((double) (cols[i] - 1)*(cols[i] - 1) + (rows[j] - 1)*(rows[j] - 1)),
+                   info->accuracy);
+      backprojectRegion(info, &subSet, subCol0, cols[i], subRow0, rows[j]);
+      freeSet(&subSet);
+    }
+  }
+}
+
+/* Direct backprojection of a small region. All pixels are inside the
+ * projections of set, see createSubSet. */
+static void
+backprojectLeaf(const imageInfo *info, const projectionSet *set,
+                int col0, int numCols, int row0, int numRows)
+{
+  const double xcenter = info->xleft + col0 + (numCols - 1)/2.0;
+  const double ycenter = info->ytop - row0 - (numRows - 1)/2.0;
+  const double *proj;
+  double *column;
+  const double scale = set->scale;
+  double u0, u, du, fraction;
+  double xcoord, t;
+  int k, x, y, a;
+
+  for (k = 0; k < set->numAngles; k++)
+  {
+    proj = set->data[k];
+    for (x = 0; x < numCols; x++)
+    {
+      column = info->img + (size_t) (col0 + x)*info->N + row0;
+      /* Sample index of the top pixel of the column */
+      u0 = ((info->xleft + col0 + x - xcenter)*set->cosine[k]
+            + (info->ytop - row0 - ycenter)*set->sine[k] - set->start[k])*scale;
+      du = set->sine[k]*scale;
+      if (info->interp)
+      {
+        for (y = 0; y < numRows; y++)
+        {
+          u = u0 - y*du;
+          a = (int) u;
+          fraction = u - a;
+          column[y] += fraction*(proj[a + 1] - proj[a]) + proj[a];
+        }
+      }
+      else if (set->original)
+      {
+        /* t and its rounding as in backprojectColumn of backprojectc, so
+         * that unsummed projections give the direct backprojection */
+        xcoord = info->xleft + (col0 + x);
+        for (y = 0; y < numRows; y++)
+        {
+          t = xcoord*set->cosine[k] + (info->ytop - (row0 + y))*set->sine[k];
+          a = (int) t;
+          fraction = t - a;
+          a += (fraction >= 0.5) - (fraction <= -0.5);
+          column[y] += proj[a + info->qCenter];
+        }
+      }
+      else
+      {
+        for (y = 0; y < numRows; y++)
+        {
+          u = u0 - y*du;
+          column[y] += proj[(int) (u + 0.5)];
+        }
+      }
+    }
+  }
+}
+
+/* Groups of adjacent projections of set with original angles in a range
+ * of at most 2*accuracy/radius, the center of the range is at most
+ * accuracy/radius off every original angle. Group g is first[g] ..
+ * first[g + 1] - 1, first needs numAngles + 1 elements. Returns the
+ * number of groups. */
+static int
+groupAngles(const projectionSet *set, double radius, double accuracy, int *first)
+{
+  int numGroups, next, k;
+  double low, high;
+
+  numGroups = 0;
+  for (k = 0; k < set->numAngles; k = next)
+  {
+    first[numGroups++] = k;
+    low = set->low[k];
+    high = set->high[k];
+    for (next = k + 1; next < set->numAngles; next++)
+    {
+      if ((MAX(high, set->high[next]) - MIN(low, set->low[next]))*radius > 2*accuracy)
+        break;
+      low = MIN(low, set->low[next]);
+      high = MAX(high, set->high[next]);
+    }
+  }
+  first[numGroups] = set->numAngles;
+  return numGroups;
+}
+
+/* Number of samples of the summed projections of a region */
+static int
+summedLength(double radius)
+{
+  return 2*(int) ((ceil(radius) + MARGIN)*OVERSAMPLING) + 1;
+}
+
+/* Nonzero if summing numAngles projections of a region to numGroups is
+ * cheaper than backprojecting them. Every projection is interpolated at
+ * the samples of its summed projection, every projection less saves its
+ * backprojection to the region of about 2*radius^2 pixels. */
+static int
+summingPays(int numAngles, int numGroups, double radius)
+{
+  return (double) (numAngles - numGroups)*2*radius*radius
+         > (double) INTERPOLATION_COST*numAngles*summedLength(radius);
+}
+
+/* Projections of a subregion with the center (dx, dy) relative to the
+ * region of set and the given radius. Adjacent projections are summed while
+ * the range of their original angles displaces no ray of the subregion by
+ * more than accuracy, otherwise the projections are only shifted. */
+static void
+createSubSet(projectionSet *sub, const projectionSet *set, double dx, double dy,
+             double radius, double accuracy)
+{
+  const int numAngles = set->numAngles;
+  int numGroups, next, k, g, i, length;
+  int *first;                 /* first projection of every group */
+  double start, shift, t;
+  double *samples;
+
+  first = (int *) malloc((numAngles + 1) * sizeof(int));
+  numGroups = groupAngles(set, radius, accuracy, first);
+
+  if (!summingPays(numAngles, numGroups, radius))
+  {
+    allocateSet(sub, numAngles);
+    for (k = 0; k < numAngles; k++)
+    {
+      sub->theta[k] = set->theta[k];
+      sub->cosine[k] = set->cosine[k];
+      sub->sine[k] = set->sine[k];
+      sub->low[k] = set->low[k];
+      sub->high[k] = set->high[k];
+      sub->data[k] = set->data[k];
+      sub->start[k] = set->start[k] - (dx*set->cosine[k] + dy*set->sine[k]);
+      sub->length[k] = set->length[k];
+    }
+    sub->scale = set->scale;
+    sub->original = set->original;
+    free(first);
+    return;
+  }
+
+  /* The summed projections cover the subregion and MARGIN samples */
+  allocateSet(sub, numGroups);
+  sub->scale = OVERSAMPLING;
+  start = -(ceil(radius) + MARGIN);
+  length = summedLength(radius);
+  sub->samples = (double *) calloc((size_t) sub->numAngles * length, sizeof(double));
+
+  for (g = 0; g < sub->numAngles; g++)
+  {
+    k = first[g];
+    next = first[g + 1];
+    sub->low[g] = set->low[k];
+    sub->high[g] = set->high[k];
+    for (i = k + 1; i < next; i++)
+    {
+      sub->low[g] = MIN(sub->low[g], set->low[i]);
+      sub->high[g] = MAX(sub->high[g], set->high[i]);
+    }
+    sub->theta[g] = 0.5*(sub->low[g] + sub->high[g]);
+    sub->cosine[g] = cos(sub->theta[g]);
+    sub->sine[g] = sin(sub->theta[g]);
+    sub->start[g] = start;
+    sub->length[g] = length;
+    samples = sub->samples + (size_t) g*length;
+    sub->data[g] = samples;
+
+    for ( ; k < next; k++)
+    {
+      /* Sample i is at t = start + i in the subregion, at t + shift in the
+       * region, exact for the angle of the group and displaced by at most
+       * accuracy for the original angles in it */
+      shift = dx*set->cosine[k] + dy*set->sine[k];
+      for (i = 0; i < length; i++)
+      {
+        t = start + i/sub->scale + shift;
+        samples[i] += interpolate(set->data[k], set->length[k],
+                                  (t - set->start[k])*set->scale);
+      }
+    }
+  }
+  free(first);
+}
+
+static void
+allocateSet(projectionSet *set, int numAngles)
+{
+  set->numAngles = numAngles;
+  set->theta = (double *) malloc(numAngles * sizeof(double));
+  set->cosine = (double *) malloc(numAngles * sizeof(double));
+  set->sine = (double *) malloc(numAngles * sizeof(double));
+  set->low = (double *) malloc(numAngles * sizeof(double));
+  set->high = (double *) malloc(numAngles * sizeof(double));
+  set->data = (const double **) malloc(numAngles * sizeof(double *));
+  set->start = (double *) malloc(numAngles * sizeof(double));
+  set->length = (int *) malloc(numAngles * sizeof(int));
+  set->samples = NULL;
+  set->original = 0;
+}
+
+static void
+freeSet(projectionSet *set)
+{
+  free(set->theta);
+  free(set->cosine);
+  free(set->sine);
+  free(set->low);
+  free(set->high);
+  free((void *) set->data);
+  free(set->start);
+  free(set->length);
+  free(set->samples);
+}
+
+/* Linear interpolation at the sample index u, 0 outside the samples */
+static double
+interpolate(const double *data, int length, double u)
+{
+  int a;
+  double fraction;
+
+  if (u < 0 || u > length - 1)
+    return 0;
+  a = (int) u;
+  if (a == length - 1)
+    return data[a];
+  fraction = u - a;
+  return fraction*(data[a + 1] - data[a]) + data[a];
+}
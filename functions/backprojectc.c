@@ -0,0 +1,279 @@
+/*-------------------------------------------------------------------*/
+/* Backprojection of parallel projections, the backprojection step   */
+/* of MATLAB's iradon, see inverseRadon.m. Based on Backprojectc.c   */
+/* of the AO2015 extension, which is based on the implementation of  */
+/* Jeff Orchard, http://www.mathworks.com/matlabcentral/             */
+/* fileexchange/12852-iradon-speedy                                  */
+/*                                                                   */
+/* For every pixel and angle the detector coordinate                 */
+/* t = x*cos(theta) + y*sin(theta) is interpolated in the            */
+/* projection. The image axes and the center of the projections are  */
+/* those of iradon: the center is the element ceil(len/2) (1-based)  */
+/* and elements outside the projections are 0. The sum over the      */
+/* angles is not scaled.                                             */
+/*                                                                   */
+/* The image is split into square tiles, which are distributed over  */
+/* the threads. A tile stays in the L1 cache while all angles are    */
+/* added to it, and each angle reads only the short segment of the   */
+/* projection that covers the tile. The trigonometric values of the  */
+/* angles are tabulated once. The loop over the rows of a tile       */
+/* column is vectorized.                                             */
+/*                                                                   */
+/* Two sinograms of the same geometry, e.g. of the low and the high  */
+/* energy, are backprojected in one sweep. Their projections are     */
+/* interleaved, so t, the interpolated element and its fraction are  */
+/* computed once for both images.                                    */
+/*                                                                   */
+/* Usage:                                                            */
+/*   img = backprojectc(P, theta, N, interp)                         */
+/*   P:      [len x numAngles x C] filtered projections, a sinogram  */
+/*           (C = 1) or a stack of two (C = 2)                       */
+/*   theta:  projection angles in radians                            */
+/*   N:      size of the output image                                */
+/*   interp: 0 for nearest neighbour, 1 for linear interpolation     */
+/*   img:    [N x N x C] backprojected images                        */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "mexInputAccess.h"
+
+/* Input Arguments */
+#define P      (prhs[0])
+#define THETA  (prhs[1])
+#define N_SIZE (prhs[2])
+#define INTERP (prhs[3])
+
+/* Output Arguments */
+#define IMG    (plhs[0])
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+/* The image is computed in tiles of TILE_SIZE x TILE_SIZE pixels */
+#define TILE_SIZE 32
+
+static void backproject(double *img, const double *q, const double *cosine,
+                        const double *sine, int qLength, int qCenter, int numAngles,
+                        int N, int numChannels, int interp);
+static void backprojectColumn(double *column, const double *proj, double xcoord,
+                              double ytop, double cosine, double sine, int y0, int y1,
+                              int qLength, int interp);
+static void backprojectColumn2(double *column0, double *column1, const double *proj,
+                               double xcoord, double ytop, double cosine, double sine,
+                               int y0, int y1, int qLength, int interp);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  const double *pPtr;         /* projections */
+  const double *thetaPtr;     /* projection angles */
+  double *q;                  /* zero padded, interleaved projections */
+  double *cosine, *sine;      /* trigonometric values of the angles */
+  int len;                    /* length of the projections */
+  int numAngles;              /* number of projection angles */
+  int numChannels;            /* number of sinograms */
+  mwSize dims[3];             /* dimensions of the output */
+  int N;                      /* size of the output image */
+  int interp;                 /* linear interpolation? */
+  int pad;                    /* number of zeros before and after a projection */
+  int qLength, qCenter;       /* length and center of the padded projections */
+  int k, c, r;
+
+  /* Check validity of arguments */
+  if (nrhs != 4)
+  {
+    mexErrMsgTxt("Usage: img = backprojectc(P, theta, N, interp)");
+  }
+  if (nlhs > 1)
+  {
+    mexErrMsgTxt("Too many output arguments to BACKPROJECTC");
+  }
+  if (mxIsSparse(P) || mxIsComplex(P) || !mxIsNumeric(P) || !mxIsNumeric(THETA))
+  {
+    mexErrMsgTxt("Projections and angles must be real and numeric.");
+  }
+
+  len = mxGetM(P);
+  numAngles = mxGetNumberOfElements(THETA);
+  N = (int) mxGetScalar(N_SIZE);
+  interp = (int) mxGetScalar(INTERP);
+  numChannels = (mxGetNumberOfDimensions(P) > 2) ? (int) mxGetDimensions(P)[2] : 1;
+  if (mxGetNumberOfDimensions(P) > 3 || numChannels > 2)
+  {
+    mexErrMsgTxt("P must be one sinogram or a stack of two.");
+  }
+  if (mxGetN(P) != (size_t) numAngles*numChannels)
+  {
+    mexErrMsgTxt("P must have one column per angle.");
+  }
+  if (N < 0)
+  {
+    mexErrMsgTxt("N must be positive.");
+  }
+
+  /* |t| <= N/sqrt(2), the padding keeps all interpolated elements in
+   * the padded projections, so the inner loop has no bounds checks */
+  pad = (int) ceil(N/sqrt(2.0)) + 2;
+  qLength = len + 2*pad;
+  qCenter = pad + (len + 1)/2 - 1;
+
+  pPtr = mexInputDoubles(P);
+  q = (double *) mxCalloc((size_t) qLength * numChannels * (numAngles > 0 ? numAngles : 1),
+                          sizeof(double));
+  if (numChannels == 1)
+  {
+    for (k = 0; k < numAngles; k++)
+      memcpy(q + (size_t) k*qLength + pad, pPtr + (size_t) k*len, len * sizeof(double));
+  }
+  else
+  {
+    /* Element r of angle k of sinogram c at q[2*(k*qLength + pad + r) + c] */
+    for (c = 0; c < numChannels; c++)
+      for (k = 0; k < numAngles; k++)
+        for (r = 0; r < len; r++)
+          q[2*((size_t) k*qLength + pad + r) + c] = pPtr[((size_t) c*numAngles + k)*len + r];
+  }
+  mexInputRelease(pPtr, P);
+
+  thetaPtr = mexInputDoubles(THETA);
+  cosine = (double *) mxMalloc((numAngles > 0 ? numAngles : 1) * sizeof(double));
+  sine = (double *) mxMalloc((numAngles > 0 ? numAngles : 1) * sizeof(double));
+  for (k = 0; k < numAngles; k++)
+  {
+    cosine[k] = cos(thetaPtr[k]);
+    sine[k] = sin(thetaPtr[k]);
+  }
+  mexInputRelease(thetaPtr, THETA);
+
+  dims[0] = N;
+  dims[1] = N;
+  dims[2] = numChannels;
+  IMG = mxCreateNumericArray(numChannels > 1 ? 3 : 2, dims, mxDOUBLE_CLASS, mxREAL);
+  backproject(mxGetPr(IMG), q, cosine, sine, qLength, qCenter, numAngles, N, numChannels,
+              interp);
+
+  mxFree(q);
+  mxFree(cosine);
+  mxFree(sine);
+}
+
+static void
+backproject(double *img, const double *q, const double *cosine, const double *sine,
+            int qLength, int qCenter, int numAngles, int N, int numChannels, int interp)
+{
+  int numTiles;               /* number of tiles along each image axis */
+  int tile;                   /* index of the current tile */
+  int x, k;                   /* loop indices */
+  int x0, x1, y0, y1;         /* the current tile is [x0, x1) x [y0, y1) */
+  double xcoord;              /* x-coordinate of the current column */
+  double xleft, ytop;         /* coordinates of the upper left pixel */
+  const double *proj;         /* projections of the current angle, at their center */
+  double *column;             /* current column of the first image */
+
+  xleft = -floor((N - 1)/2.0);
+  ytop = -xleft;
+  numTiles = (N + TILE_SIZE - 1)/TILE_SIZE;
+
+  #pragma omp parallel for private(k, x, x0, x1, y0, y1, xcoord, proj, column)
+  for (tile = 0; tile < numTiles*numTiles; tile++)
+  {
+    x0 = (tile/numTiles)*TILE_SIZE;
+    y0 = (tile%numTiles)*TILE_SIZE;
+    x1 = MIN(x0 + TILE_SIZE, N);
+    y1 = MIN(y0 + TILE_SIZE, N);
+
+    for (k = 0; k < numAngles; k++)
+    {
+      proj = q + numChannels*((size_t) k*qLength + qCenter);
+      for (x = x0; x < x1; x++)
+      {
+        xcoord = xleft + x;
+        column = img + (size_t) x*N;
+        if (numChannels == 1)
+          backprojectColumn(column, proj, xcoord, ytop, cosine[k], sine[k],
+                            y0, y1, qLength, interp);
+        else
+          backprojectColumn2(column, column + (size_t) N*N, proj, xcoord, ytop,
+                             cosine[k], sine[k], y0, y1, qLength, interp);
+      }
+    }
+  }
+}
+
+/* Adds one projection to the rows [y0, y1) of a column */
+static void
+backprojectColumn(double *column, const double *proj, double xcoord, double ytop,
+                  double cosine, double sine, int y0, int y1, int qLength, int interp)
+{
+  const double t0 = xcoord*cosine + ytop*sine;  /* t of the top row */
+  double t, fraction;
+  int y, a;
+
+  if (interp)
+  {
+    #pragma omp simd private(t, a, fraction)
+    for (y = y0; y < y1; y++)
+    {
+      t = t0 - y*sine;
+      a = ((int) (t + qLength)) - qLength;  /* floor(t), t > -qLength */
+      fraction = t - a;
+      column[y] += fraction*(proj[a + 1] - proj[a]) + proj[a];
+    }
+  }
+  else
+  {
+    /* t is computed as in iradon, a different rounding of t could
+     * move a tie at .5 to the other neighbour */
+    #pragma omp simd private(t, a, fraction)
+    for (y = y0; y < y1; y++)
+    {
+      t = xcoord*cosine + (ytop - y)*sine;
+      /* round(t), halves away from zero as MATLAB's round. t - a is
+       * exact, t + 0.5 is not for t just below .5 */
+      a = (int) t;
+      fraction = t - a;
+      a += (fraction >= 0.5) - (fraction <= -0.5);
+      column[y] += proj[a];
+    }
+  }
+}
+
+/* As backprojectColumn, for two interleaved projections */
+static void
+backprojectColumn2(double *column0, double *column1, const double *proj, double xcoord,
+                   double ytop, double cosine, double sine, int y0, int y1, int qLength,
+                   int interp)
+{
+  const double t0 = xcoord*cosine + ytop*sine;  /* t of the top row */
+  double t, fraction;
+  int y, a;
+
+  if (interp)
+  {
+    #pragma omp simd private(t, a, fraction)
+    for (y = y0; y < y1; y++)
+    {
+      t = t0 - y*sine;
+      a = ((int) (t + qLength)) - qLength;
+      fraction = t - a;
+      column0[y] += fraction*(proj[2*a + 2] - proj[2*a]) + proj[2*a];
+      column1[y] += fraction*(proj[2*a + 3] - proj[2*a + 1]) + proj[2*a + 1];
+    }
+  }
+  else
+  {
+    #pragma omp simd private(t, a, fraction)
+    for (y = y0; y < y1; y++)
+    {
+      t = xcoord*cosine + (ytop - y)*sine;
+      a = (int) t;
+      fraction = t - a;
+      a += (fraction >= 0.5) - (fraction <= -0.5);
+      column0[y] += proj[2*a];
+      column1[y] += proj[2*a + 1];
+    }
+  }
+}
@@ -0,0 +1,39 @@
+function B = coarsenGrid(A, f, dims)
+  % COARSENGRID Average and decimate an array by an integer factor.
+  %
+  % B = coarsenGrid(A, f, dims) averages A over boxes of f elements and
+  % keeps every f-th element along the dimensions dims, e.g. 1 for the
+  % detector elements of a sinogram or [1 2] for a stack of images. The
+  % center of iradon, the element ceil(n/2), is kept, so the image axes
+  % and the projection center of the coarse grid are those of iradon
+  % with the element size multiplied by f. The coarse length is
+  % 2*floor((ceil(n/2)-1)/f)+1, e.g. 255 for n = 511 and f = 2. Averages
+  % preserve line integrals and volume fractions.
+
+  % Weights of the box of width f at the offsets -floor(f/2):floor(f/2)
+  if mod(f, 2) == 0
+    w = [0.5, ones(1, f-1), 0.5]/f;
+  else
+    w = ones(1, f)/f;
+  end
+  h = floor(f/2);
+
+  B = A;
+  for d = dims
+    n = size(B, d);
+    c = ceil(n/2);
+    m = 2*floor((c-1)/f) + 1;
+    fine = c + f*((1:m) - ceil(m/2));   % fine elements kept
+
+    order = [d, 1:d-1, d+1:max(ndims(B), d)];
+    sizeP = size(permute(B, order));
+    X = reshape(permute(B, order), n, []);
+    X = [zeros(h, size(X, 2)); X; zeros(h, size(X, 2))];
+    Y = zeros(m, size(X, 2));
+    for k = 1:length(w)
+      Y = Y + w(k)*X(fine + k - 1, :);
+    end
+    sizeP(1) = m;
+    B = ipermute(reshape(Y, sizeP), order);
+  end
+end
@@ -0,0 +1,54 @@
+function report = compareBackprojection(p, degVec, N, accuracies)
+  % COMPAREBACKPROJECTION Error and time of the hierarchical backprojection.
+  %
+  % Reconstructs p with the direct backprojection of backprojectc and with
+  % the hierarchical backprojection of backprojectHierc for every accuracy,
+  % both after filtering with the Hann filter as in DIRA. Prints and
+  % returns the errors relative to the direct reconstruction and the
+  % times.
+  %
+  % Input:
+  % p:          [len x numel(degVec)] parallel projections
+  % degVec:     projection angles in degrees
+  % N:          size of the N x N reconstructed image
+  % accuracies: accuracies of backprojectHierc, default [0.05 0.1 0.15 0.25 0.35 0.5 1]
+  %
+  % Output:
+  % report:     struct array with the fields accuracy, relRmsError
+  %             (RMS error / RMS of the direct image), relMaxError
+  %             (largest error / largest absolute value of the direct
+  %             image), time and speedup
+  %
+  % Example:
+  % >> p = radon(phantom(1024), 0:0.125:179.875);
+  % >> compareBackprojection(p, 0:0.125:179.875, 1024);
+  %
+  % See also: backprojectHierc, backprojectc, inverseRadon
+
+  if nargin < 4
+    accuracies = [0.05 0.1 0.15 0.25 0.35 0.5 1];
+  end
+
+  q = filterProjectionsc(double(p), 'Hann', 1);
+  theta = pi*double(degVec)/180;
+
+  tic;
+  direct = backprojectc(q, theta, N, 1);
+  directTime = toc;
+  fprintf('Direct backprojection: %.3f s\n', directTime);
+
+  report = struct('accuracy', num2cell(accuracies), 'relRmsError', 0,...
+    'relMaxError', 0, 'time', 0, 'speedup', 0);
+  for k = 1:length(accuracies)
+    tic;
+    img = backprojectHierc(q, theta, N, 1, accuracies(k));
+    report(k).time = toc;
+    err = img - direct;
+    report(k).relRmsError = sqrt(mean(err(:).^2)) / sqrt(mean(direct(:).^2));
+    report(k).relMaxError = max(abs(err(:))) / max(abs(direct(:)));
+    report(k).speedup = directTime / report(k).time;
+    fprintf('Accuracy %5.2f: %.3f s (%.1fx), relative RMS error %.2e, relative max error %.2e\n',...
+      accuracies(k), report(k).time, report(k).speedup, report(k).relRmsError,...
+      report(k).relMaxError);
+  end
+end
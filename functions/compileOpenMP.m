@@ -3,11 +3,35 @@ if(ispc)
 %  mex Backprojectc_openmp.c COMPFLAGS="/openmp $COMPFLAGS"
   mex computePolyProjc_openmp.c COMPFLAGS="/openmp $COMPFLAGS"
   mex sinogramJc_openmp.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex sinogramJPlanc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex computeFusedPolyProjc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex sinogramFanJc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex backprojectFanc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex computePolyProjLUTc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex computePolyProjc_simd.cpp COMPFLAGS="/openmp $COMPFLAGS"
+  mex decomposeTissuesc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex filterProjectionsc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex backprojectc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex backprojectHierc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex griddingReconstructc.c COMPFLAGS="/openmp $COMPFLAGS"
+  mex projectionFilterc.c COMPFLAGS="/openmp $COMPFLAGS"
 elseif(isunix)
   disp('Compiling for UNIX');
 %  mex Backprojectc_openmp.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
   mex computePolyProjc_openmp.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
   mex sinogramJc_openmp.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex sinogramJPlanc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex computeFusedPolyProjc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex sinogramFanJc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex backprojectFanc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex computePolyProjLUTc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex computePolyProjc_simd.cpp CXXFLAGS="\$CXXFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex decomposeTissuesc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex filterProjectionsc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex backprojectc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex backprojectHierc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex griddingReconstructc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
+  mex projectionFilterc.c CFLAGS="\$CFLAGS -fopenmp" LDFLAGS="\$LDFLAGS -fopenmp"
 end
 
 %mex Backprojectc.c
@@ -0,0 +1,124 @@
+function [Ec, Nc, muc, err] = compressSpectrum(E, N, mu, tol, lmax)
+  % COMPRESSSPECTRUM Reduce a spectrum to a few weighted energy nodes.
+  %
+  % The polychromatic projection computed by computePolyProj,
+  %   Ap = -log(sum_k E(k)*N(k)*exp(-sum_i 100*mu(E(k),i)*p_i) / uE),
+  % costs one exp() per detector element and spectrum energy. Adjacent
+  % energies are merged into clusters, and every cluster is replaced by a
+  % two-point Gauss quadrature along the principal direction of its LACs.
+  % The two nodes preserve the total weight sum(E.*N) of the cluster and
+  % the first three weighted moments of its LACs in that direction. A
+  % cluster grows as long as its error stays below its share of tol for
+  % all test line integrals p with 0 <= p_i <= lmax.
+  %
+  % The compressed spectrum is returned in the format expected by
+  % computePolyProj: Ec = (1:K)' indexes the rows of muc, and Nc is chosen
+  % so that Ec.*Nc are the node weights, i.e. uE = sum(E.*N) is unchanged.
+  %
+  % Input:
+  % E:    [Ne x 1] spectrum energies in keV, rows of mu
+  % N:    [Ne x 1] relative number of photons
+  % mu:   [Nmax x Ntbm] LACs in 1/cm of the base materials, row E(k) is
+  %       the LAC at energy E(k)
+  % tol:  maximum error of Ap
+  % lmax: maximum line integral of a base material in m, e.g. the
+  %       diameter of the reconstructed area
+  %
+  % Output:
+  % Ec:   [K x 1] node indices 1:K
+  % Nc:   [K x 1] node weights divided by Ec
+  % muc:  [K x Ntbm] LACs of the nodes
+  % err:  maximum error of Ap over the test line integrals
+  %
+  % Example:
+  %   [ELowC, NLowC, muLowC] = compressSpectrum(smd.ELow, smd.NLow, ...
+  %     pmd.muLow, 1e-4, Nr2*pixsiz);
+  %   ApLow = computePolyProj(ELowC, uLow, NLowC, p, muLowC);
+
+  E = E(:);
+  N = N(:);
+  Ne = length(E);
+  Ntbm = size(mu, 2);
+  w = E .* N;                  % weights of the energies
+  M = mu(E, :);                % LACs at the spectrum energies
+  uE = sum(w);
+
+  % Test line integrals: every material alone and every pair of materials
+  % in equal parts, at several path lengths up to lmax
+  t = linspace(0, lmax, 9)';
+  t = t(2:end);
+  I = eye(Ntbm);
+  L = zeros(0, Ntbm);
+  for i = 1:Ntbm
+    L = [L; t * I(i, :)];
+    for j = i+1:Ntbm
+      L = [L; t * (I(i, :) + I(j, :)) / 2];
+    end
+  end
+
+  % Transmission of every energy and the exact detector signal
+  A = exp(-100 * L * M');      % [Ntest x Ne]
+  U = A * w;
+
+  % Merge adjacent energies greedily. The share of tol of a cluster is the
+  % mean of its fraction of the unattenuated and of the attenuated signal,
+  % so that the errors of all clusters add up to at most tol.
+  first = 1;
+  Wc = zeros(0, 1);
+  muc = zeros(0, Ntbm);
+  while first <= Ne
+    last = first;
+    [W, m] = nodes(first, last);
+    while last < Ne
+      [W1, m1] = nodes(first, last + 1);
+      exact = A(:, first:last+1) * w(first:last+1);
+      e = abs(exact - exp(-100 * L * m1') * W1) ./ U;
+      if any(e > tol / 2 * (sum(W1) / uE + exact ./ U))
+        break;
+      end
+      last = last + 1;
+      W = W1;
+      m = m1;
+    end
+    Wc = [Wc; W];
+    muc = [muc; m];
+    first = last + 1;
+  end
+
+  K = length(Wc);
+  Ec = (1:K)';
+  Nc = Wc ./ Ec;
+  err = max(abs(log((exp(-100 * L * muc') * Wc) ./ U)));
+
+  % Quadrature nodes of the energies first:last. W are the weights and the
+  % rows of m the LACs of the nodes.
+  function [W, m] = nodes(first, last)
+    wk = w(first:last);
+    Mk = M(first:last, :);
+    Wsum = sum(wk);
+    if Wsum <= 0
+      W = Wsum;
+      m = Mk(1, :);
+      return;
+    end
+    mk = (wk' * Mk) / Wsum;
+    D = Mk - repmat(mk, size(Mk, 1), 1);
+    [V, lambda] = eig(D' * diag(wk) * D / Wsum);
+    [s2, i] = max(diag(lambda));
+    if s2 <= eps * max(abs(mk))^2
+      W = Wsum;
+      m = mk;
+      return;
+    end
+    % Two-point Gauss quadrature for the projections s on the principal
+    % direction v: the nodes are the roots of x^2 - (s3/s2)*x - s2
+    v = V(:, i)';
+    s = D * v';
+    s2 = (wk' * s.^2) / Wsum;
+    s3 = (wk' * s.^3) / Wsum;
+    d = sqrt((s3 / s2)^2 + 4 * s2);
+    x = [(s3 / s2 + d) / 2; (s3 / s2 - d) / 2];
+    W = Wsum * [-x(2); x(1)] / (x(1) - x(2));
+    m = [mk + x(1) * v; mk + x(2) * v];
+  end
+end
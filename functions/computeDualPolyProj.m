@@ -0,0 +1,44 @@
+%% Calculate polyenergetic projections for both spectra
+%
+% [ApLow, ApHigh] = computeDualPolyProj(ELow, EHigh, uLow, uHigh, NLow,
+% NHigh, p, muLow, muHigh) is equivalent to
+%   ApLow = computePolyProj(ELow, uLow, NLow, p, muLow);
+%   ApHigh = computePolyProj(EHigh, uHigh, NHigh, p, muHigh);
+% but the C, OpenMP and OpenCL codes read p only once. C and OpenMP use
+% the vectorized kernel computePolyProjc_simd if it is compiled.
+%
+% The optional layout is 'bins' for an [Nd x Np x Ntbm] array p (default)
+% or 'interleaved' for an [Ntbm x Nd x Np] array, see computePolyProj.m.
+% The OpenCL code only reads the 'bins' layout.
+function [ApLow, ApHigh] = computeDualPolyProj(ELow, EHigh, uLow, uHigh,...
+    NLow, NHigh, p, muLow, muHigh, layout)
+
+  if nargin < 10
+    layout = 'bins';
+  end
+
+  % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+  global useCode
+  if (useCode == 1 || useCode == 2) && exist('computePolyProjc_simd', 'file') == 3
+    [ApLow, ApHigh] = computePolyProjc_simd(ELow, EHigh, uLow, uHigh,...
+      NLow, NHigh, p, muLow, muHigh, layout);
+    return;
+  end
+  switch (useCode)
+    case 1
+      [ApLow, ApHigh] = computePolyProjc(ELow, EHigh, uLow, uHigh,...
+        NLow, NHigh, p, muLow, muHigh, layout);
+    case 2
+      [ApLow, ApHigh] = computePolyProjc_openmp(ELow, EHigh, uLow, uHigh,...
+        NLow, NHigh, p, muLow, muHigh, layout);
+    case 3
+      if strcmp(layout, 'interleaved')
+        p = permute(p, [2 3 1]);
+      end
+      [ApLow, ApHigh] = computePolyProjc_opencl(ELow, EHigh, uLow, uHigh,...
+        NLow, NHigh, p, muLow, muHigh);
+    otherwise
+      ApLow = computePolyProj(ELow, uLow, NLow, p, muLow, layout);
+      ApHigh = computePolyProj(EHigh, uHigh, NHigh, p, muHigh, layout);
+  end
+end
@@ -0,0 +1,295 @@
+/*-------------------------------------------------------------------*/
+/* Fused Joseph projection and polychromatic projection for DIRA.    */
+/* The volume fractions of all base materials are projected angle by */
+/* angle; the line integrals of one detector element are combined    */
+/* with the tabulated LACs right away, so the [Nd x Np x Ntbm] cube  */
+/* of line integrals is never stored.                                */
+/*                                                                   */
+/* Usage:                                                            */
+/*   [ApLow, ApHigh, MLow, MHigh] = computeFusedPolyProjc(Vol,       */
+/*       theta, rvec, pixsiz, ELow, EHigh, uLow, uHigh, NLow, NHigh, */
+/*       muLow, muHigh, attLow, attHigh)                             */
+/*                                                                   */
+/* The projection is the Joseph projection with linear interpolation */
+/* (filter 2 of sinogramJ), computed ray by ray by sinogramJRay.h.   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include "mex.h"
+#include "sinogramJRay.h"
+
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+#define PI 3.14159265358979
+
+/* Input Arguments */
+#define VOL      (prhs[0])
+#define THETA    (prhs[1])
+#define R_IN     (prhs[2])
+#define PIXSIZ   (prhs[3])
+#define E_LOW    (prhs[4])
+#define E_HIGH   (prhs[5])
+#define UE_LOW   (prhs[6])
+#define UE_HIGH  (prhs[7])
+#define N_LOW    (prhs[8])
+#define N_HIGH   (prhs[9])
+#define MU_LOW   (prhs[10])
+#define MU_HIGH  (prhs[11])
+#define ATT_LOW  (prhs[12])
+#define ATT_HIGH (prhs[13])
+
+/* Output Arguments */
+#define AP_LOW   (plhs[0])
+#define AP_HIGH  (plhs[1])
+#define M_LOW    (plhs[2])
+#define M_HIGH   (plhs[3])
+
+typedef struct
+{
+  int numEnergies;      /* number of spectrum channels */
+  double *weight;       /* E(k)*N(k) */
+  double *mu;           /* 100*pixsiz*mu(E(k),c), materials innermost */
+  double *att;          /* 100*pixsiz*att(c) */
+  double ue;            /* sum of E(k)*N(k) */
+} spectrum;
+
+static void checkSpectrum(const mxArray *e, const mxArray *n, const mxArray *mu);
+static void initSpectrum(spectrum *s, const mxArray *e, const mxArray *n, const mxArray *mu,
+			 const mxArray *att, double ue, double pixsiz, int numChannels);
+static void freeSpectrum(spectrum *s);
+static void fusedPolyProj(double *apLow, double *apHigh, double *mLow, double *mHigh,
+			  double *iPtr, double *thetaPtr, int M, int N, int xOrigin, int yOrigin,
+			  int numAngles, int rSize, int numChannels,
+			  spectrum *low, spectrum *high);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  int numAngles;        /* number of theta values */
+  double *thetaPtr;     /* pointer to theta values in radians */
+  double deg2rad;       /* conversion factor */
+  double pixsiz;        /* pixel size */
+  int k;                /* loop counter */
+  int M, N;             /* input image size */
+  int xOrigin, yOrigin; /* center of image */
+  int rSize;            /* number of rows in output */
+  int numChannels;      /* number of base materials */
+  const mwSize *dimPtr; /* dimensions of the input stack */
+  spectrum low, high;   /* spectra for Ul and Uh */
+  double *mLow, *mHigh; /* monoenergetic projections */
+
+  /* Check validity of arguments */
+  if (nrhs != 14)
+  {
+      mexErrMsgTxt("Incorrect number of INPUT arguments.");
+  }
+  if (nlhs > 4)
+  {
+      mexErrMsgTxt("Incorrect number of OUTPUT arguments.");
+  }
+  for (k = 0; k < nrhs; k++)
+  {
+    if (mxIsSparse(prhs[k]) || mxIsComplex(prhs[k]))
+      mexErrMsgTxt("Sparse or complex inputs not supported.");
+    if (!mxIsDouble(prhs[k]))
+      mexErrMsgTxt("Input must be double.");
+  }
+
+  /* Get input image size, an M x N x numChannels stack of volume fractions */
+  dimPtr = mxGetDimensions(VOL);
+  M = dimPtr[0];
+  N = dimPtr[1];
+  numChannels = (M*N > 0) ? mxGetNumberOfElements(VOL) / (M*N) : 1;
+
+  if (mxGetN(MU_LOW) != numChannels || mxGetN(MU_HIGH) != numChannels ||
+      mxGetNumberOfElements(ATT_LOW) != numChannels ||
+      mxGetNumberOfElements(ATT_HIGH) != numChannels)
+  {
+      mexErrMsgTxt("mu and att must have one column per base material.");
+  }
+
+  /* Get THETA degree values and convert to radians */
+  deg2rad = PI / 180.0;
+  numAngles = mxGetNumberOfElements(THETA);
+  thetaPtr = (double *) mxCalloc(numAngles, sizeof(double));
+  for (k = 0; k < numAngles; k++)
+    thetaPtr[k] = mxGetPr(THETA)[k] * deg2rad;
+
+  rSize = mxGetNumberOfElements(R_IN);
+  pixsiz = mxGetScalar(PIXSIZ);
+
+  /* Where is the coordinate system's origin? */
+  xOrigin = MAX(0, (N-1)/2);
+  yOrigin = MAX(0, (M-1)/2);
+
+  checkSpectrum(E_LOW, N_LOW, MU_LOW);
+  checkSpectrum(E_HIGH, N_HIGH, MU_HIGH);
+  initSpectrum(&low, E_LOW, N_LOW, MU_LOW, ATT_LOW, mxGetScalar(UE_LOW), pixsiz, numChannels);
+  initSpectrum(&high, E_HIGH, N_HIGH, MU_HIGH, ATT_HIGH, mxGetScalar(UE_HIGH), pixsiz, numChannels);
+
+  AP_LOW  = mxCreateDoubleMatrix(rSize, numAngles, mxREAL);
+  AP_HIGH = mxCreateDoubleMatrix(rSize, numAngles, mxREAL);
+  M_LOW   = mxCreateDoubleMatrix(rSize, numAngles, mxREAL);
+  M_HIGH  = mxCreateDoubleMatrix(rSize, numAngles, mxREAL);
+  mLow  = mxGetPr(M_LOW);
+  mHigh = mxGetPr(M_HIGH);
+
+  fusedPolyProj(mxGetPr(AP_LOW), mxGetPr(AP_HIGH), mLow, mHigh, mxGetPr(VOL), thetaPtr,
+		M, N, xOrigin, yOrigin, numAngles, rSize, numChannels, &low, &high);
+
+  freeSpectrum(&low);
+  freeSpectrum(&high);
+  mxFree(thetaPtr);
+}
+
+/* Checks that all energies of a spectrum are rows of its mu table */
+static void
+checkSpectrum(const mxArray *e, const mxArray *n, const mxArray *mu)
+{
+  int k;
+  int energy;
+
+  if (mxGetNumberOfElements(n) != mxGetNumberOfElements(e))
+  {
+      mexErrMsgTxt("E and N must have the same number of elements.");
+  }
+  for (k = 0; k < mxGetNumberOfElements(e); k++)
+  {
+    energy = (int) mxGetPr(e)[k];
+    if (energy < 1 || energy > mxGetM(mu))
+    {
+        mexErrMsgTxt("Energy outside the mu table.");
+    }
+  }
+}
+
+/* Tabulates the spectrum weights and the scaled LACs of all materials */
+static void
+initSpectrum(spectrum *s, const mxArray *e, const mxArray *n, const mxArray *mu,
+	     const mxArray *att, double ue, double pixsiz, int numChannels)
+{
+  int k, c;
+  int energy;
+  int muSize = mxGetM(mu);
+
+  s->numEnergies = mxGetNumberOfElements(e);
+  s->weight = (double *) malloc(s->numEnergies * sizeof(double));
+  s->mu     = (double *) malloc(s->numEnergies * numChannels * sizeof(double));
+  s->att    = (double *) malloc(numChannels * sizeof(double));
+  s->ue     = ue;
+
+  for (k = 0; k < s->numEnergies; k++)
+  {
+    energy = (int) mxGetPr(e)[k];
+    s->weight[k] = energy * mxGetPr(n)[k];
+    for (c = 0; c < numChannels; c++)
+      s->mu[k*numChannels + c] = 100 * pixsiz * mxGetPr(mu)[c*muSize + energy - 1];
+  }
+  for (c = 0; c < numChannels; c++)
+    s->att[c] = 100 * pixsiz * mxGetPr(att)[c];
+}
+
+static void
+freeSpectrum(spectrum *s)
+{
+  free(s->weight);
+  free(s->mu);
+  free(s->att);
+}
+
+/* Polychromatic projection -log(sum_k w_k exp(-sum_c mu_kc l_c) / ue) of
+ * one detector element with the line integrals l */
+static double
+polyProj(spectrum *s, double *l, int numChannels)
+{
+  int k, c;
+  double temporarySum;
+  double result = 0;
+
+  for (k = 0; k < s->numEnergies; k++)
+  {
+    temporarySum = 0;
+    for (c = 0; c < numChannels; c++)
+      temporarySum += s->mu[k*numChannels + c] * l[c];
+    result += s->weight[k] * exp(-temporarySum);
+  }
+  return -log(result / s->ue);
+}
+
+static void
+fusedPolyProj(double *apLow, double *apHigh, double *mLow, double *mHigh,
+	      double *iPtr, double *thetaPtr, int M, int N, int xOrigin, int yOrigin,
+	      int numAngles, int rSize, int numChannels, spectrum *low, spectrum *high)
+{
+  int k,b,c;                                     /* Loop variables */
+  int radius;                                    /* Radius of circle from which to use values */
+  int rFirst;                                    /* r-value of the first detector element */
+  double *columns, *rows;                        /* Padded copies of the images along x and along y */
+  int columnsSize, rowsSize;                     /* Size of the padded lines of one image */
+  int imageSize;                                 /* Stride between channels */
+  double *integrals;                             /* Line integrals of the current angle, [rSize x numChannels] */
+  double *l;                                     /* Line integrals of the current element, [numChannels] */
+  double mono;                                   /* Monoenergetic projection */
+
+  /* Only values in a circle will be used, the edges do not add anything */
+  radius = ceil(rSize/2);
+  rFirst = (1-rSize)/2;
+
+  imageSize   = M * N;
+  columnsSize = M * (N + 2*PAD);
+  rowsSize    = N * (M + 2*PAD);
+  columns = (double *) calloc(numChannels * columnsSize, sizeof(double));
+  rows    = (double *) calloc(numChannels * rowsSize, sizeof(double));
+
+  /* Copy the pixels inside the circle, the rest of the lines stay zero */
+  for(c=0;c<numChannels;++c)
+    copyRayLines(columns + c*columnsSize, rows + c*rowsSize, iPtr + c*imageSize,
+                 M, N, xOrigin, yOrigin, radius);
+
+  #pragma omp parallel private(k, b, c, integrals, l, mono)
+  {
+    /* Every thread keeps the line integrals of one angle */
+    integrals = (double *) malloc(rSize * numChannels * sizeof(double));
+    l = (double *) malloc(numChannels * sizeof(double));
+
+    #pragma omp for schedule(dynamic)
+    for(k=0;k<numAngles;++k)
+    {
+      for(b=0;b<rSize*numChannels;++b)
+        integrals[b] = 0;
+
+      for(c=0;c<numChannels;++c)
+        projectRays(integrals + c*rSize, 1, 0, rSize, columns + c*columnsSize,
+                    rows + c*rowsSize, M, N, xOrigin, yOrigin, radius, rFirst,
+                    thetaPtr[k], 1);
+
+      /* Evaluate both spectra for every detector element of the angle */
+      for(b=0;b<rSize;++b)
+      {
+        for(c=0;c<numChannels;++c)
+          l[c] = integrals[c*rSize + b];
+
+        mono = 0;
+        for(c=0;c<numChannels;++c)
+          mono += low->att[c] * l[c];
+        mLow[k*rSize + b] = mono;
+
+        mono = 0;
+        for(c=0;c<numChannels;++c)
+          mono += high->att[c] * l[c];
+        mHigh[k*rSize + b] = mono;
+
+        apLow[k*rSize + b]  = polyProj(low, l, numChannels);
+        apHigh[k*rSize + b] = polyProj(high, l, numChannels);
+      }
+    }
+
+    free(integrals);
+    free(l);
+  }
+
+  free(columns);
+  free(rows);
+}
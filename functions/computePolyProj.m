@@ -1,18 +1,41 @@
 %% Calculate polyenergetic projection
 %
-function [Ap] = computePolyProj(E, uE, N, p, mu)
+% p is an [Nd x Np x Ntbm] array of line integrals or, if layout is
+% 'interleaved', an [Ntbm x Nd x Np] array as returned by sinogramJ with
+% opts.layout = 'interleaved'. The default layout is 'bins'.
+function [Ap] = computePolyProj(E, uE, N, p, mu, layout)
+
+  if nargin < 6
+    layout = 'bins';
+  end
 
   % 0 = Matlab, 1 = C, 2 = OpenMP
+  % The vectorized kernel is used by C and OpenMP if it is compiled.
   global useCode
+  if (useCode == 1 || useCode == 2) && exist('computePolyProjc_simd', 'file') == 3
+    [Ap] = computePolyProjc_simd(E, uE, N, p, mu, layout);
+    return;
+  end
   switch (useCode)
     case 1
-      [Ap] = computePolyProjc(E, uE, N, p, mu);
+      [Ap] = computePolyProjc(E, uE, N, p, mu, layout);
       return;
     case 2
-      [Ap] = computePolyProjc_openmp(E, uE, N, p, mu);
+      [Ap] = computePolyProjc_openmp(E, uE, N, p, mu, layout);
       return;
   end
 
+  if strcmp(layout, 'interleaved')
+    % The line integrals of a ray form the columns of P
+    P = reshape(p, size(p, 1), []);
+    up = zeros(1, size(P, 2));
+    for k = 1:length(E)
+      up = up + (E(k)*N(k)).*exp(-100*mu(E(k), :)*P);
+    end
+    Ap = reshape(-log(up/uE), size(p, 2), size(p, 3));
+    return;
+  end
+
   sizeE = size(E);
   sizeP = size(p);
   
@@ -0,0 +1,68 @@
+function [ApLow, ApHigh] = computePolyProjLUT(lut, p, layout)
+  % COMPUTEPOLYPROJLUT Polychromatic projections by table lookup.
+  %
+  % [ApLow, ApHigh] = computePolyProjLUT(lut, p) interpolates the tables
+  % created by createPolyProjLUT at the basis line integrals V' * p of
+  % every detector element. It replaces
+  %   ApLow = computePolyProj(ELow, uLow, NLow, p, muLow);
+  %   ApHigh = computePolyProj(EHigh, uHigh, NHigh, p, muHigh);
+  % Rays outside the tables are computed exactly.
+  %
+  % Input:
+  % lut: table structure, see createPolyProjLUT.m
+  % p:   [Nd x Np x Ntbm] line integrals in m
+  % layout: 'bins' (default) or 'interleaved' if p is [Ntbm x Nd x Np],
+  %      see computePolyProj.m
+  %
+  % Output:
+  % ApLow, ApHigh: [Nd x Np] polychromatic projections
+
+  if nargin < 3
+    layout = 'bins';
+  end
+
+  % 0 = Matlab, 1 = C, 2 = OpenMP
+  global useCode
+  if useCode == 1 || useCode == 2
+    [ApLow, ApHigh] = computePolyProjLUTc(p, lut.V, lut.qMin, lut.qStep,...
+      lut.tableLow, lut.tableHigh, lut.wLow, lut.muLow, lut.uLow,...
+      lut.wHigh, lut.muHigh, lut.uHigh, layout);
+    return;
+  end
+
+  % P holds the line integrals of a ray in a row
+  if strcmp(layout, 'interleaved')
+    sizeP = [size(p, 2), size(p, 3)];
+    P = reshape(p, size(p, 1), []).';
+  else
+    sizeP = size(p);
+    P = reshape(p, sizeP(1)*sizeP(2), []);
+  end
+  Q = P * lut.V;
+  numBasis = size(lut.V, 2);
+  tableSize = size(lut.tableLow, 1);
+  grid = cell(1, numBasis);
+  q = cell(1, numBasis);
+  for r = 1:numBasis
+    grid{r} = lut.qMin(r) + (0:tableSize-1)' * lut.qStep(r);
+    q{r} = Q(:, r);
+  end
+
+  if numBasis == 1
+    ApLow = interp1(grid{1}, lut.tableLow, q{1});
+    ApHigh = interp1(grid{1}, lut.tableHigh, q{1});
+  else
+    ApLow = interpn(grid{:}, lut.tableLow, q{:});
+    ApHigh = interpn(grid{:}, lut.tableHigh, q{:});
+  end
+
+  % Rays outside the tables
+  outside = isnan(ApLow);
+  if any(outside)
+    ApLow(outside) = -log(exp(-P(outside, :) * lut.muLow') * lut.wLow / lut.uLow);
+    ApHigh(outside) = -log(exp(-P(outside, :) * lut.muHigh') * lut.wHigh / lut.uHigh);
+  end
+
+  ApLow = reshape(ApLow, sizeP(1), sizeP(2));
+  ApHigh = reshape(ApHigh, sizeP(1), sizeP(2));
+end
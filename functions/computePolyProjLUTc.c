@@ -0,0 +1,284 @@
+/*-------------------------------------------------------------------*/
+/* Polychromatic projections by table lookup, see createPolyProjLUT. */
+/* The line integrals p of every detector element are reduced to     */
+/* one to three basis line integrals q = V' * p and Ap is            */
+/* interpolated multilinearly in the tables of both spectra. Rays    */
+/* outside the tables are computed exactly as in computePolyProjc.c. */
+/*                                                                   */
+/* Usage:                                                            */
+/*   [ApLow, ApHigh] = computePolyProjLUTc(p, V, qMin, qStep,        */
+/*       tableLow, tableHigh, wLow, muLow, uLow, wHigh, muHigh,      */
+/*       uHigh, layout)                                              */
+/*   p:         [Nd x Np x Ntbm] line integrals, or [Ntbm x Nd x Np] */
+/*              if layout is 'interleaved'                           */
+/*   V:         [Ntbm x Nb] basis, Nb = 1, 2 or 3                    */
+/*   qMin:      first grid point of every basis function             */
+/*   qStep:     grid step of every basis function                    */
+/*   table*:    n x ... x n tables of Ap, Nb dimensions              */
+/*   w*:        E.*N of the spectra                                  */
+/*   mu*:       [Ne x Ntbm] 100*LACs at the spectrum energies        */
+/*   u*:        sum(E.*N) of the spectra                             */
+/*   layout:    'bins' (default) or 'interleaved', optional          */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <string.h>
+#include "mex.h"
+
+/* Maximum number of basis functions */
+#define MAX_BASIS 3
+
+/* Input Arguments */
+#define P_IN       (prhs[0])
+#define V_IN       (prhs[1])
+#define QMIN       (prhs[2])
+#define QSTEP      (prhs[3])
+#define TABLE_LOW  (prhs[4])
+#define TABLE_HIGH (prhs[5])
+#define W_LOW      (prhs[6])
+#define MU_LOW     (prhs[7])
+#define UE_LOW     (prhs[8])
+#define W_HIGH     (prhs[9])
+#define MU_HIGH    (prhs[10])
+#define UE_HIGH    (prhs[11])
+#define LAYOUT     (prhs[12])
+
+/* Output Arguments */
+#define AP_LOW     (plhs[0])
+#define AP_HIGH    (plhs[1])
+
+typedef struct
+{
+  int numEnergies;      /* number of spectrum channels */
+  double *weight;       /* E(k)*N(k) */
+  double *mu;           /* 100*mu(E(k),c), column-major [numEnergies x numChannels] */
+  double ue;            /* sum of E(k)*N(k) */
+  double *table;        /* tabulated Ap */
+} spectrum;
+
+static void initSpectrum(spectrum *s, const mxArray *w, const mxArray *mu, const mxArray *ue,
+			 const mxArray *table, int numChannels);
+static int isInterleaved(const mxArray *layout);
+static double exactPolyProj(spectrum *s, double *pPtr, int channelStride, int numChannels);
+static void polyProjLUT(double *apLow, double *apHigh, double *pPtr, double *vPtr,
+			double *qMin, double *qStep, int tableSize, int numBasis,
+			int numBins, int numChannels, int interleaved, spectrum *low,
+			spectrum *high);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  int k;                /* loop counter */
+  int numBins;          /* number of detector elements times angles */
+  int numChannels;      /* number of base materials */
+  int numBasis;         /* number of basis functions */
+  int tableSize;        /* number of grid points per basis function */
+  int numElements;      /* number of table elements */
+  int interleaved;      /* are the line integrals of a ray adjacent? */
+  mwSize M, N;          /* size of the projections */
+  const mwSize *dimPtr; /* dimensions of p */
+  spectrum low, high;   /* spectra for Ul and Uh */
+
+  /* Check validity of arguments */
+  if (nrhs != 12 && nrhs != 13)
+  {
+      mexErrMsgTxt("Incorrect number of INPUT arguments.");
+  }
+  if (nlhs > 2)
+  {
+      mexErrMsgTxt("Incorrect number of OUTPUT arguments.");
+  }
+  for (k = 0; k < 12; k++)
+  {
+    if (mxIsSparse(prhs[k]) || mxIsComplex(prhs[k]))
+      mexErrMsgTxt("Sparse or complex inputs not supported.");
+    if (!mxIsDouble(prhs[k]))
+      mexErrMsgTxt("Input must be double.");
+  }
+
+  interleaved = (nrhs == 13) ? isInterleaved(LAYOUT) : 0;
+  dimPtr = mxGetDimensions(P_IN);
+  if (interleaved)
+  {
+    numChannels = dimPtr[0];
+    M = dimPtr[1];
+    N = (numChannels*M > 0) ? mxGetNumberOfElements(P_IN) / (numChannels*M) : 0;
+  }
+  else
+  {
+    M = dimPtr[0];
+    N = dimPtr[1];
+    numChannels = (M*N > 0) ? mxGetNumberOfElements(P_IN) / (M*N) : 1;
+  }
+  numBins = M * N;
+
+  numBasis = mxGetN(V_IN);
+  if ((int) mxGetM(V_IN) != numChannels)
+  {
+      mexErrMsgTxt("V must have one row per base material.");
+  }
+  if (numBasis < 1 || numBasis > MAX_BASIS)
+  {
+      mexErrMsgTxt("The number of basis functions must be 1, 2 or 3.");
+  }
+  if ((int) mxGetNumberOfElements(QMIN) != numBasis || (int) mxGetNumberOfElements(QSTEP) != numBasis)
+  {
+      mexErrMsgTxt("qMin and qStep must have one element per basis function.");
+  }
+
+  tableSize = mxGetM(TABLE_LOW);
+  numElements = 1;
+  for (k = 0; k < numBasis; k++)
+    numElements *= tableSize;
+  if (tableSize < 2 || (int) mxGetNumberOfElements(TABLE_LOW) != numElements ||
+      (int) mxGetNumberOfElements(TABLE_HIGH) != numElements)
+  {
+      mexErrMsgTxt("The tables must have at least two grid points per basis function.");
+  }
+
+  initSpectrum(&low, W_LOW, MU_LOW, UE_LOW, TABLE_LOW, numChannels);
+  initSpectrum(&high, W_HIGH, MU_HIGH, UE_HIGH, TABLE_HIGH, numChannels);
+
+  AP_LOW  = mxCreateDoubleMatrix(M, N, mxREAL);
+  AP_HIGH = mxCreateDoubleMatrix(M, N, mxREAL);
+
+  polyProjLUT(mxGetPr(AP_LOW), mxGetPr(AP_HIGH), mxGetPr(P_IN), mxGetPr(V_IN),
+	      mxGetPr(QMIN), mxGetPr(QSTEP), tableSize, numBasis, numBins, numChannels,
+	      interleaved, &low, &high);
+}
+
+/* Is the layout of p 'interleaved' or 'bins'? */
+static int
+isInterleaved(const mxArray *layout)
+{
+  char name[16];
+
+  if (!mxIsChar(layout) || mxGetString(layout, name, sizeof(name)) != 0)
+  {
+      mexErrMsgTxt("Layout must be 'bins' or 'interleaved'.");
+  }
+  if (strcmp(name, "interleaved") == 0)
+    return 1;
+  if (strcmp(name, "bins") != 0)
+    mexErrMsgTxt("Layout must be 'bins' or 'interleaved'.");
+  return 0;
+}
+
+/* Collects the weights, LACs and the table of a spectrum */
+static void
+initSpectrum(spectrum *s, const mxArray *w, const mxArray *mu, const mxArray *ue,
+	     const mxArray *table, int numChannels)
+{
+  s->numEnergies = mxGetNumberOfElements(w);
+  if ((int) mxGetM(mu) != s->numEnergies || (int) mxGetN(mu) != numChannels)
+  {
+      mexErrMsgTxt("mu must be [numel(w) x Ntbm].");
+  }
+  s->weight = mxGetPr(w);
+  s->mu = mxGetPr(mu);
+  s->ue = mxGetScalar(ue);
+  s->table = mxGetPr(table);
+}
+
+/* Exact Ap of one detector element, p points to its first line integral */
+static double
+exactPolyProj(spectrum *s, double *pPtr, int channelStride, int numChannels)
+{
+  int k, c;
+  double temporarySum;
+  double sum = 0;
+
+  for(k=0;k<s->numEnergies;++k)
+  {
+    temporarySum = 0;
+    for(c=0;c<numChannels;++c)
+      temporarySum += s->mu[c*s->numEnergies + k] * pPtr[c*channelStride];
+    sum += s->weight[k] * exp(-temporarySum);
+  }
+  return -log(sum / s->ue);
+}
+
+static void
+polyProjLUT(double *apLow, double *apHigh, double *pPtr, double *vPtr, double *qMin,
+	    double *qStep, int tableSize, int numBasis, int numBins, int numChannels,
+	    int interleaved, spectrum *low, spectrum *high)
+{
+  int i, b, c, corner;                           /* Loop variables */
+  double u[MAX_BASIS];                           /* Position in the table in grid steps */
+  int index[MAX_BASIS];                          /* Position as integer */
+  double fraction[MAX_BASIS];                    /* Fraction of the position */
+  int stride[MAX_BASIS];                         /* Strides of the table dimensions */
+  int inside;                                    /* Whether the ray lies inside the table */
+  int offset;                                    /* Table index of the current corner */
+  double weight;                                 /* Weight of the current corner */
+  double sumLow, sumHigh;                        /* Interpolated Ap */
+  double q;                                      /* Basis line integral */
+  double *ray;                                   /* Line integrals of the current ray */
+  int channelStride;                             /* Distance between the line integrals of a ray */
+  int binStride;                                 /* Distance between rays */
+
+  channelStride = interleaved ? 1 : numBins;
+  binStride = interleaved ? numChannels : 1;
+
+  stride[0] = 1;
+  for(b=1;b<numBasis;++b)
+    stride[b] = stride[b-1] * tableSize;
+
+  #pragma omp parallel for private(b, c, corner, u, index, fraction, inside, offset,\
+                                   weight, sumLow, sumHigh, q, ray)
+  for(i=0;i<numBins;++i)
+  {
+    ray = pPtr + i*binStride;
+    inside = 1;
+    for(b=0;b<numBasis;++b)
+    {
+      q = 0;
+      for(c=0;c<numChannels;++c)
+        q += vPtr[b*numChannels + c] * ray[c*channelStride];
+      u[b] = (q - qMin[b]) / qStep[b];
+      if(!(u[b] >= 0 && u[b] <= tableSize - 1))
+      {
+        inside = 0;
+        break;
+      }
+      index[b] = (int) u[b];
+      if(index[b] > tableSize - 2)
+        index[b] = tableSize - 2;
+      fraction[b] = u[b] - index[b];
+    }
+
+    if(!inside)
+    {
+      apLow[i]  = exactPolyProj(low, ray, channelStride, numChannels);
+      apHigh[i] = exactPolyProj(high, ray, channelStride, numChannels);
+      continue;
+    }
+
+    /* Multilinear interpolation over the 2^numBasis corners of the cell */
+    sumLow = 0;
+    sumHigh = 0;
+    for(corner=0;corner<(1 << numBasis);++corner)
+    {
+      offset = 0;
+      weight = 1;
+      for(b=0;b<numBasis;++b)
+      {
+        if(corner & (1 << b))
+        {
+          offset += (index[b] + 1) * stride[b];
+          weight *= fraction[b];
+        }
+        else
+        {
+          offset += index[b] * stride[b];
+          weight *= 1 - fraction[b];
+        }
+      }
+      sumLow  += weight * low->table[offset];
+      sumHigh += weight * high->table[offset];
+    }
+    apLow[i]  = sumLow;
+    apHigh[i] = sumHigh;
+  }
+}
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <CL/cl.h>
 #include "mex.h"
+#include "mexInputAccess.h"
 
 /* Input Arguments */
 #define ELOW      (prhs[0])
@@ -30,20 +31,18 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   int *eHighPtr;     /* Energy levels */
   double ueLow;  
   double ueHigh;
-  double *nLowPtr;    
-  double *nHighPtr;
-  double *pPtr;    
-  double *muLowPtr;
-  double *muHighPtr;
+  const double *nLowPtr;    
+  const double *nHighPtr;
+  const double *pPtr;    
+  const double *muLowPtr;
+  const double *muHighPtr;
   double *apLowPtr;
   double *apHighPtr;
   
   /* temp pointers for copying values */
-  double *from_doublePtr;   
-  double *to_doublePtr;   
-  int *from_intPtr;   
+  const double *from_doublePtr;   
   int *to_intPtr;  
-  const int *dimPtr;   
+  const mwSize *dimPtr;   
   
   /*Size variables */
   int columns;        /* columns */
@@ -142,21 +141,23 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
     mexErrMsgTxt("Sparse inputs not supported.");
   }
   
-  if (!mxIsDouble(ELOW) || !mxIsDouble(UELOW) || !mxIsDouble(NLOW) || !mxIsDouble(P) || !mxIsDouble(MULOW))
+  if (!mxIsDouble(ELOW) || !mxIsDouble(EHIGH))
   {
     mexErrMsgTxt("Input must be double.");
   }
   
-  if (!mxIsDouble(EHIGH) || !mxIsDouble(UEHIGH) || !mxIsDouble(NHIGH) || !mxIsDouble(MUHIGH))
+  if (!mxIsNumeric(UELOW) || !mxIsNumeric(NLOW) || !mxIsNumeric(P) || !mxIsNumeric(MULOW) ||
+      !mxIsNumeric(UEHIGH) || !mxIsNumeric(NHIGH) || !mxIsNumeric(MUHIGH))
   {
-    mexErrMsgTxt("Input must be double.");
+    mexErrMsgTxt("Input must be numeric.");
   }
   
-  /* Get the size of E matrix and allocate memory */
+  /* Convert the energies to integers */
   columns = mxGetN(ELOW);
   rows = mxGetM(ELOW);
   total_size = rows * columns; 
   eLowPtr = (int *) mxCalloc(total_size, sizeof(int));
+  MEX_INPUT_COUNT(total_size * sizeof(int));
   from_doublePtr = mxGetPr(ELOW);
   to_intPtr = eLowPtr;
   for (k = 0; k < total_size; k++)
@@ -168,6 +169,7 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   rows = mxGetM(EHIGH);
   total_size = rows * columns; 
   eHighPtr = (int *) mxCalloc(total_size, sizeof(int));
+  MEX_INPUT_COUNT(total_size * sizeof(int));
   from_doublePtr = mxGetPr(EHIGH);
   to_intPtr = eHighPtr;
   for (k = 0; k < total_size; k++)
@@ -176,76 +178,30 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   eHigh_Size = rows;
   
   /* Copy value of uE */
-  from_doublePtr = mxGetPr(UELOW);
-  ueLow = *from_doublePtr;
-  
-  from_doublePtr = mxGetPr(UEHIGH);
-  ueHigh = *from_doublePtr;
-  
-  /* Get the size of N matrix and allocate memory */
-  columns = mxGetN(NLOW);
-  rows = mxGetM(NLOW);
-  total_size = rows * columns; 
-  nLowPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(NLOW);
-  to_doublePtr = nLowPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
-  
-  columns = mxGetN(NHIGH);
-  rows = mxGetM(NHIGH);
-  total_size = rows * columns; 
-  nHighPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(NHIGH);
-  to_doublePtr = nHighPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
-  
-  /* Get the size of MU matrix and allocate memory */
-  columns = mxGetN(MULOW);
-  rows = mxGetM(MULOW);
-  total_size = rows * columns; 
-  muLowPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(MULOW);
-  to_doublePtr = muLowPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
-  
-  muLow_Size = rows;
-  
-  columns = mxGetN(MUHIGH);
-  rows = mxGetM(MUHIGH);
-  total_size = rows * columns; 
-  muHighPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(MUHIGH);
-  to_doublePtr = muHighPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
-  
-  muHigh_Size = rows;
-  
-  /* P */
-  columns = mxGetN(P);
-  rows = mxGetM(P);
-  total_size = rows * columns; 
-  pPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(P);
-  to_doublePtr = pPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
+  ueLow = mxGetScalar(UELOW);
+  ueHigh = mxGetScalar(UEHIGH);
+  
+  /* N, MU and P are read in place */
+  nLowPtr = mexInputDoubles(NLOW);
+  nHighPtr = mexInputDoubles(NHIGH);
+  muLowPtr = mexInputDoubles(MULOW);
+  muLow_Size = mxGetM(MULOW);
+  muHighPtr = mexInputDoubles(MUHIGH);
+  muHigh_Size = mxGetM(MUHIGH);
+  pPtr = mexInputDoubles(P);
   
   /* Get the z-dimension for matrix P */
   dimPtr = mxGetDimensions(P);
-  no_projections = dimPtr[2];
-  
-  total_size = rows*columns/no_projections;
+  rows = dimPtr[0];
+  columns = dimPtr[1];
+  total_size = rows*columns;
+  no_projections = (total_size > 0) ? mxGetNumberOfElements(P) / total_size : 1;
   
   /* Allocate a 2D matrix for the output AP */
-  /* Columns is 720x5 = 3600, need only 720 as column value, so divide by no_projections */
-  APLOW = mxCreateDoubleMatrix(rows, columns/no_projections, mxREAL);
+  APLOW = mxCreateDoubleMatrix(rows, columns, mxREAL);
   apLowPtr = mxGetPr(APLOW);
   
-  APHIGH = mxCreateDoubleMatrix(rows, columns/no_projections, mxREAL);
+  APHIGH = mxCreateDoubleMatrix(rows, columns, mxREAL);
   apHighPtr = mxGetPr(APHIGH);
   
   error = clGetPlatformIDs(1, &platform, &no_platforms);
@@ -263,11 +219,12 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   
   kernel_computePolyProj = clCreateKernel(program_computePolyProj, "computePolyProj", &error);
   
-  /* Compute ApLow */
+  /* Compute ApLow. The read-only buffers use MATLAB's memory, P is shared
+   * by both spectra. */
+  P_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * total_size*no_projections, (void *) pPtr, NULL);
   E_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(int) * eLow_Size, eLowPtr, NULL);
-  N_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * eLow_Size, nLowPtr, NULL);
-  P_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * total_size*no_projections, pPtr, NULL);
-  MU_input = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * muLow_Size*no_projections, muLowPtr, NULL);
+  N_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * eLow_Size, (void *) nLowPtr, NULL);
+  MU_input = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * muLow_Size*no_projections, (void *) muLowPtr, NULL);
   
   AP_output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(double) * total_size, NULL, NULL);
   
@@ -294,11 +251,15 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   clWaitForEvents(1, &event); // Synch
   
   
+  clReleaseMemObject(E_input);
+  clReleaseMemObject(N_input);
+  clReleaseMemObject(MU_input);
+  clReleaseMemObject(AP_output);
+  
   /* Compute ApHigh */
   E_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(int) * eHigh_Size, eHighPtr, NULL);
-  N_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * eHigh_Size, nHighPtr, NULL);
-  P_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * total_size*no_projections, pPtr, NULL);
-  MU_input = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * muHigh_Size*no_projections, muHighPtr, NULL);
+  N_input  = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * eHigh_Size, (void *) nHighPtr, NULL);
+  MU_input = clCreateBuffer(context,  CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * muHigh_Size*no_projections, (void *) muHighPtr, NULL);
   
   AP_output = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(double) * total_size, NULL, NULL);
   
@@ -330,4 +291,13 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   clReleaseProgram(program_computePolyProj);
   clReleaseCommandQueue(commandqueue);
   clReleaseContext(context);
+  
+  mxFree(eLowPtr);
+  mxFree(eHighPtr);
+  mexInputRelease(nLowPtr, NLOW);
+  mexInputRelease(nHighPtr, NHIGH);
+  mexInputRelease(muLowPtr, MULOW);
+  mexInputRelease(muHighPtr, MUHIGH);
+  mexInputRelease(pPtr, P);
+  mexInputReport("computePolyProjc_opencl");
 }
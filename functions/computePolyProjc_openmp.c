@@ -1,11 +1,38 @@
 #include "mex.h"
+#include "mexInputAccess.h"
 #include <math.h>
+#include <string.h>
 #include <omp.h>
 
-static void 
-computePolychromaticProjection(int *ePtr, double ue, double *nPtr, double *pPtr,
-                               double *muPtr, double *apPtr, int e_Size, int no_projections,
-                                int mu_Size, int N, int M);
+/* Maximum number of spectra computed in one pass */
+#define MAX_SPECTRA 2
+
+typedef struct
+{
+  int *ePtr;                 /* Energies */
+  double ue;
+  const double *nPtr;        /* relative number of photons */
+  const double *muPtr;       /* LACs, row E(k) is used for energy k */
+  int e_Size;                /* Number of energies */
+  int mu_Size;               /* Number of rows of mu */
+  const mxArray *n;          /* inputs viewed by nPtr and muPtr */
+  const mxArray *mu;
+} spectrum;
+
+static void
+initSpectrum(spectrum *s, const mxArray *e, const mxArray *ue, const mxArray *n,
+             const mxArray *mu, int no_projections);
+
+static void
+releaseSpectrum(spectrum *s);
+
+static int
+isInterleaved(const mxArray *layout);
+
+static void
+computePolychromaticProjection(spectrum *spectra, int no_spectra, const double *pPtr,
+                               double **apPtr, int no_projections, int N, int M,
+                               int interleaved);
 
 /* Input Arguments */
 #define E     (prhs[0])
@@ -13,171 +40,243 @@ computePolychromaticProjection(int *ePtr, double ue, double *nPtr, double *pPtr,
 #define N_P   (prhs[2])
 #define P     (prhs[3])
 #define MU    (prhs[4])
+#define LAYOUT    (prhs[nrhs-1])
+
+/* Input Arguments of the dual-spectrum call */
+#define ELOW      (prhs[0])
+#define EHIGH     (prhs[1])
+#define UELOW     (prhs[2])
+#define UEHIGH    (prhs[3])
+#define NLOW      (prhs[4])
+#define NHIGH     (prhs[5])
+#define P2        (prhs[6])
+#define MULOW     (prhs[7])
+#define MUHIGH    (prhs[8])
 
 /* Output Arguments */
 #define  AP    (plhs[0])
+#define  APLOW     (plhs[0])
+#define  APHIGH    (plhs[1])
 
 /**
  * Need 5 input arguments: E, uE, N, p, mu
  * Produces 1 output: Ap
+ *
+ * or 9 input arguments: ELow, EHigh, uELow, uEHigh, NLow, NHigh, p, muLow, muHigh
+ * Produces 2 outputs: ApLow, ApHigh
+ *
+ * In the second form p is read once for both spectra. Double inputs are
+ * used in place, see mexInputAccess.h, only the energies are converted to
+ * integers.
+ *
+ * An optional last argument gives the layout of p, 'bins' for an
+ * [M x N x no_projections] array (default) or 'interleaved' for a
+ * [no_projections x M x N] array as returned by sinogramJ. In the latter
+ * the line integrals of a ray are adjacent.
  */
-void 
+void
 mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
 {
-  /* Input pointers */
-  int *ePtr;        /* Energies */
-  double ue;  
-  double *nPtr;      /* relative number of photons for Ul */
-  double *pPtr;    
-  double *muPtr;    
-  
-  /* temp pointers for copying values */
-  double *from_doublePtr;   
-  double *to_doublePtr;   
-  int *from_intPtr;   
-  int *to_intPtr;  
-  int *dimPtr;   
-  
+  spectrum spectra[MAX_SPECTRA];
+  double *apPtr[MAX_SPECTRA];
+  int no_spectra;
+  int no_inputs;            /* number of numeric inputs */
+  int interleaved;
+  const mxArray *p;
+  const double *pPtr;
+  const mwSize *dimPtr;
+
   /*Size variables */
   int N;
   int M;
-  int total_size;   /* Total image size, N * M */
-  int e_Size;       /* Number of energies */
   int no_projections;       /* number of materials */
-  int mu_Size;
-  
+
   int k;            /* Loop counter */
 
   /* Check validity of arguments */
-  if (nrhs != 5)
+  if (nrhs != 5 && nrhs != 6 && nrhs != 9 && nrhs != 10)
   {
       mexErrMsgTxt("Incorrect number of INPUT arguments.");
   }
-  
-  if (nlhs != 1)
+  no_spectra = (nrhs < 9) ? 1 : 2;
+  no_inputs = (no_spectra == 1) ? 5 : 9;
+  interleaved = (nrhs > no_inputs) ? isInterleaved(LAYOUT) : 0;
+
+  if (nlhs != no_spectra)
   {
       mexErrMsgTxt("Incorrect number of OUTPUT arguments.");
   }
-  
-  if (mxIsSparse(E) || mxIsSparse(UE) || mxIsSparse(N_P) || mxIsSparse(P) || mxIsSparse(MU))
+
+  for (k = 0; k < no_inputs; k++)
   {
+    if (mxIsSparse(prhs[k]))
       mexErrMsgTxt("Sparse inputs not supported.");
+    if (!mxIsNumeric(prhs[k]))
+      mexErrMsgTxt("Input must be numeric.");
+  }
+
+  /* Get the size of P, an [M x N x no_projections] or, if interleaved,
+   * [no_projections x M x N] array */
+  p = (no_spectra == 1) ? P : P2;
+  dimPtr = mxGetDimensions(p);
+  if (interleaved)
+  {
+    no_projections = dimPtr[0];
+    M = dimPtr[1];
+    N = (no_projections*M > 0) ? mxGetNumberOfElements(p) / (no_projections*M) : 0;
+  }
+  else
+  {
+    M = dimPtr[0];
+    N = dimPtr[1];
+    no_projections = (M*N > 0) ? mxGetNumberOfElements(p) / (M*N) : 1;
+  }
+
+  if (no_spectra == 1)
+  {
+    initSpectrum(&spectra[0], E, UE, N_P, MU, no_projections);
+  }
+  else
+  {
+    initSpectrum(&spectra[0], ELOW, UELOW, NLOW, MULOW, no_projections);
+    initSpectrum(&spectra[1], EHIGH, UEHIGH, NHIGH, MUHIGH, no_projections);
+  }
+
+  /* Allocate a 2D matrix for every output */
+  for (k = 0; k < no_spectra; k++)
+  {
+    plhs[k] = mxCreateDoubleMatrix(M, N, mxREAL);
+    apPtr[k] = mxGetPr(plhs[k]);
+  }
+
+  pPtr = mexInputDoubles(p);
+  computePolychromaticProjection(spectra, no_spectra, pPtr, apPtr,
+                                 no_projections, N, M, interleaved);
+
+  mexInputRelease(pPtr, p);
+  for (k = 0; k < no_spectra; k++)
+    releaseSpectrum(&spectra[k]);
+  mexInputReport("computePolyProjc_openmp");
+}
+
+static void
+initSpectrum(spectrum *s, const mxArray *e, const mxArray *ue, const mxArray *n,
+             const mxArray *mu, int no_projections)
+{
+  const double *from_doublePtr;
+  int k;
+
+  s->e_Size = mxGetNumberOfElements(e);
+  s->mu_Size = mxGetM(mu);
+  if (mxGetNumberOfElements(n) != s->e_Size)
+  {
+      mexErrMsgTxt("E and N must have the same number of elements.");
+  }
+  if (mxGetN(mu) != no_projections)
+  {
+      mexErrMsgTxt("mu must have one column per material.");
+  }
+
+  /* Copy the energies as integers */
+  s->ePtr = (int *) mxCalloc(s->e_Size, sizeof(int));
+  MEX_INPUT_COUNT(s->e_Size * sizeof(int));
+  from_doublePtr = mexInputDoubles(e);
+  for (k = 0; k < s->e_Size; k++)
+  {
+    s->ePtr[k] = (int) from_doublePtr[k];
+    if (s->ePtr[k] < 1 || s->ePtr[k] > s->mu_Size)
+      mexErrMsgTxt("Energies must index rows of mu.");
   }
-  
-  if (!mxIsDouble(E) || !mxIsDouble(UE) || !mxIsDouble(N_P) || !mxIsDouble(P) || !mxIsDouble(MU))
+  mexInputRelease(from_doublePtr, e);
+
+  s->ue = mxGetScalar(ue);
+  s->n = n;
+  s->mu = mu;
+  s->nPtr = mexInputDoubles(n);
+  s->muPtr = mexInputDoubles(mu);
+}
+
+static void
+releaseSpectrum(spectrum *s)
+{
+  mxFree(s->ePtr);
+  mexInputRelease(s->nPtr, s->n);
+  mexInputRelease(s->muPtr, s->mu);
+}
+
+/* Is the layout of p 'interleaved' or 'bins'? */
+static int
+isInterleaved(const mxArray *layout)
+{
+  char name[16];
+
+  if (!mxIsChar(layout) || mxGetString(layout, name, sizeof(name)) != 0)
   {
-      mexErrMsgTxt("Input must be double.");
+      mexErrMsgTxt("Layout must be 'bins' or 'interleaved'.");
   }
-  
-  /**
-   * Matrix allocation
-   */
-  
-  /* Get the size of E matrix and allocate memory */
-  N = mxGetN(E);
-  M = mxGetM(E);
-  total_size = M*N; 
-  ePtr = (int *) mxCalloc(total_size, sizeof(int));
-  from_doublePtr = mxGetPr(E);
-  to_intPtr = ePtr;
-  for (k = 0; k < total_size; k++)
-    *(to_intPtr++) = (int)*(from_doublePtr++);
-  
-  e_Size = M;
-  
-  /* Copy value of uE */
-  from_doublePtr = mxGetPr(UE);
-  ue = *from_doublePtr;
-  
-  /* Get the size of N matrix and allocate memory */
-  N = mxGetN(N_P);
-  M = mxGetM(N_P);
-  total_size = M*N; 
-  nPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(N_P);
-  to_doublePtr = nPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
-  
-  /* Get the size of MU matrix and allocate memory */
-  N = mxGetN(MU);
-  M = mxGetM(MU);
-  total_size = M*N; 
-  muPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(MU);
-  to_doublePtr = muPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
-  
-  mu_Size = M;
-  
-  /* P */
-  N = mxGetN(P);
-  M = mxGetM(P);
-  total_size = M*N; 
-  pPtr = (double *) mxCalloc(total_size, sizeof(double));
-  from_doublePtr = mxGetPr(P);
-  to_doublePtr = pPtr;
-  for (k = 0; k < total_size; k++)
-    *(to_doublePtr++) = *(from_doublePtr++);
-  
-  /* Get the z-dimension for matrix P */
-  dimPtr = mxGetDimensions(P);
-  no_projections = dimPtr[2];
-  
-  /* Allocate a 2D matrix for the output AP */
-  /* Columns is 720x5 = 3600, need only 720 as column value, so divide by no_projections */
-  AP = mxCreateDoubleMatrix(M, N/no_projections, mxREAL);
-  
-  computePolychromaticProjection(ePtr, ue, nPtr, pPtr, muPtr, mxGetPr(AP),
-                                 e_Size, no_projections, mu_Size, N/no_projections, M);
+  if (strcmp(name, "interleaved") == 0)
+    return 1;
+  if (strcmp(name, "bins") != 0)
+    mexErrMsgTxt("Layout must be 'bins' or 'interleaved'.");
+  return 0;
 }
 
-static void 
-computePolychromaticProjection(int *ePtr, double ue, double *nPtr, double *pPtr,
-                               double *muPtr, double *apPtr, int e_Size, int no_projections,
-                               int mu_Size, int N, int M)
-{    
+static void
+computePolychromaticProjection(spectrum *spectra, int no_spectra, const double *pPtr,
+                               double **apPtr, int no_projections, int N, int M,
+                               int interleaved)
+{
     /* Loop variables */
     int x,y;
     int k;
     int l;
-    
+    int s;
+
     int energy;
     int image_size;
-    
+    int pixelStride;        /* distance between the line integrals of two rays */
+    int materialStride;     /* distance between the line integrals of a ray */
+
     double temporarySum;
     double result;
-    
+    spectrum *sp;
+
     image_size = M*N;
-    
-    /* Calculate for each pixel in the matrix */
-    #pragma omp parallel for private(x, result, k, temporarySum, energy, l)
+    pixelStride = interleaved ? no_projections : 1;
+    materialStride = interleaved ? 1 : image_size;
+
+    /* Calculate for each pixel in the matrix. The line integrals of the
+     * pixel stay in the cache between the spectra. */
+    #pragma omp parallel for private(x, result, k, temporarySum, energy, l, s, sp)
     for(y=0;y<M;++y)
     {
         for(x=0;x<N;x++)
         {
-            result = 0;
-
-            for(k=0;k<e_Size;++k)
+            for(s=0;s<no_spectra;++s)
             {
-                /* tmpSum = zeros(size(p(:, :, 1))); % 511x720 */
-                temporarySum = 0;
-                
-                energy = ePtr[k];
-                
-                /* tmpSum = tmpSum+(-mu(E(k), i)*100.*p(:, :, i)); */
-                for(l=0;l<no_projections;++l)
+                sp = &spectra[s];
+                result = 0;
+
+                for(k=0;k<sp->e_Size;++k)
                 {
-                    temporarySum += -muPtr[l*mu_Size + energy - 1]*100*
-                                     pPtr[y*N + x + l*image_size] ;
+                    /* tmpSum = zeros(size(p(:, :, 1))); % 511x720 */
+                    temporarySum = 0;
+
+                    energy = sp->ePtr[k];
+
+                    /* tmpSum = tmpSum+(-mu(E(k), i)*100.*p(:, :, i)); */
+                    for(l=0;l<no_projections;++l)
+                    {
+                        temporarySum += -sp->muPtr[l*sp->mu_Size + energy - 1]*100*
+                                         pPtr[(y*N + x)*pixelStride + l*materialStride] ;
+                    }
+
+                    /* sl(:, :, k) = (E(k)*N(k)).*exp(tmpSum);    */
+                    result += (energy * sp->nPtr[k])*exp(temporarySum);
                 }
-                
-                /* sl(:, :, k) = (E(k)*N(k)).*exp(tmpSum);    */
-                result += (energy * nPtr[k])*exp(temporarySum);
+                /* Ap = -log(up/uE);  */
+                apPtr[s][y*N + x] = -log((result)/sp->ue);
             }
-            /* Ap = -log(up/uE);  */
-            apPtr[y*N + x] = -log((result)/ue);
-        }  
-    }    
-}   
+        }
+    }
+}
@@ -0,0 +1,466 @@
+/**
+ * Computes polychromatic projections by summing the values of the
+ * projections of individual base materials over all photon energies used,
+ * see computePolyProjc.c. This version
+ *
+ *  - repacks mu energy-major and prescales it by -100, so the LACs of one
+ *    energy are contiguous,
+ *  - is specialized at compile time for 2, 3, 5, 7 and 8 materials, so the
+ *    material loop is fully unrolled,
+ *  - computes 4 detector bins at once with AVX2 and a vector exp/log whose
+ *    relative error is below 1e-15, if the CPU supports AVX2 and FMA.
+ *    Otherwise a scalar version of the same kernel is used.
+ *
+ * Usage as computePolyProjc:
+ *   Ap = computePolyProjc_simd(E, uE, N, p, mu, layout)
+ *   [ApLow, ApHigh] = computePolyProjc_simd(ELow, EHigh, uELow, uEHigh,
+ *                                           NLow, NHigh, p, muLow, muHigh, layout)
+ * where the optional layout is 'bins' (default) or 'interleaved'. The line
+ * integrals of 4 interleaved bins are contiguous and are gathered into
+ * vectors.
+ *
+ * The file compiles with and without OpenMP.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "mex.h"
+#include "mexInputAccess.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNEL 1
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+/* Maximum number of spectra computed in one pass */
+#define MAX_SPECTRA 2
+
+/* Number of detector bins per vector */
+#define LANES 4
+
+typedef struct
+{
+  int e_Size;                /* Number of energies */
+  double ue;
+  double *weight;            /* E(k)*N(k) */
+  double *mu;                /* -100*mu(E(k),l), [e_Size x no_projections] energy-major */
+} spectrum;
+
+static void initSpectrum(spectrum *s, const mxArray *e, const mxArray *ue, const mxArray *n,
+                         const mxArray *mu, int no_projections);
+static int isInterleaved(const mxArray *layout);
+static void computePolychromaticProjection(spectrum *spectra, int no_spectra, const double *pPtr,
+                                           double **apPtr, int no_projections, int image_size,
+                                           int interleaved);
+
+/* Input Arguments */
+#define E     (prhs[0])
+#define UE    (prhs[1])
+#define N_P   (prhs[2])
+#define P     (prhs[3])
+#define MU    (prhs[4])
+
+/* Input Arguments of the dual-spectrum call */
+#define ELOW      (prhs[0])
+#define EHIGH     (prhs[1])
+#define UELOW     (prhs[2])
+#define UEHIGH    (prhs[3])
+#define NLOW      (prhs[4])
+#define NHIGH     (prhs[5])
+#define P2        (prhs[6])
+#define MULOW     (prhs[7])
+#define MUHIGH    (prhs[8])
+#define LAYOUT    (prhs[nrhs-1])
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  spectrum spectra[MAX_SPECTRA];
+  double *apPtr[MAX_SPECTRA];
+  int no_spectra;
+  int no_inputs;            /* number of numeric inputs */
+  int interleaved;
+  const mxArray *p;
+  const double *pPtr;
+  const mwSize *dimPtr;
+  int M, N;
+  int no_projections;       /* number of materials */
+  int k;                    /* Loop counter */
+
+  /* Check validity of arguments */
+  if (nrhs != 5 && nrhs != 6 && nrhs != 9 && nrhs != 10)
+  {
+      mexErrMsgTxt("Incorrect number of INPUT arguments.");
+  }
+  no_spectra = (nrhs < 9) ? 1 : 2;
+  no_inputs = (no_spectra == 1) ? 5 : 9;
+  interleaved = (nrhs > no_inputs) ? isInterleaved(LAYOUT) : 0;
+
+  if (nlhs != no_spectra)
+  {
+      mexErrMsgTxt("Incorrect number of OUTPUT arguments.");
+  }
+
+  for (k = 0; k < no_inputs; k++)
+  {
+    if (mxIsSparse(prhs[k]))
+      mexErrMsgTxt("Sparse inputs not supported.");
+    if (!mxIsNumeric(prhs[k]))
+      mexErrMsgTxt("Input must be numeric.");
+  }
+
+  /* Get the size of P, an [M x N x no_projections] or, if interleaved,
+   * [no_projections x M x N] array */
+  p = (no_spectra == 1) ? P : P2;
+  dimPtr = mxGetDimensions(p);
+  if (interleaved)
+  {
+    no_projections = dimPtr[0];
+    M = dimPtr[1];
+    N = (no_projections*M > 0) ? mxGetNumberOfElements(p) / (no_projections*M) : 0;
+  }
+  else
+  {
+    M = dimPtr[0];
+    N = dimPtr[1];
+    no_projections = (M*N > 0) ? mxGetNumberOfElements(p) / (M*N) : 1;
+  }
+
+  if (no_spectra == 1)
+  {
+    initSpectrum(&spectra[0], E, UE, N_P, MU, no_projections);
+  }
+  else
+  {
+    initSpectrum(&spectra[0], ELOW, UELOW, NLOW, MULOW, no_projections);
+    initSpectrum(&spectra[1], EHIGH, UEHIGH, NHIGH, MUHIGH, no_projections);
+  }
+
+  for (k = 0; k < no_spectra; k++)
+  {
+    plhs[k] = mxCreateDoubleMatrix(M, N, mxREAL);
+    apPtr[k] = mxGetPr(plhs[k]);
+  }
+
+  pPtr = mexInputDoubles(p);
+  computePolychromaticProjection(spectra, no_spectra, pPtr, apPtr, no_projections, M*N,
+                                 interleaved);
+
+  mexInputRelease(pPtr, p);
+  for (k = 0; k < no_spectra; k++)
+  {
+    mxFree(spectra[k].weight);
+    mxFree(spectra[k].mu);
+  }
+  mexInputReport("computePolyProjc_simd");
+}
+
+/* Repacks the weights and the LACs of a spectrum */
+static void
+initSpectrum(spectrum *s, const mxArray *e, const mxArray *ue, const mxArray *n,
+             const mxArray *mu, int no_projections)
+{
+  const double *ePtr = mexInputDoubles(e);
+  const double *nPtr = mexInputDoubles(n);
+  const double *muPtr = mexInputDoubles(mu);
+  int mu_Size = mxGetM(mu);
+  int energy;
+  int k, l;
+
+  s->e_Size = mxGetNumberOfElements(e);
+  if ((int) mxGetNumberOfElements(n) != s->e_Size)
+  {
+      mexErrMsgTxt("E and N must have the same number of elements.");
+  }
+  if ((int) mxGetN(mu) != no_projections)
+  {
+      mexErrMsgTxt("mu must have one column per material.");
+  }
+
+  s->ue = mxGetScalar(ue);
+  s->weight = (double *) mxCalloc(s->e_Size, sizeof(double));
+  s->mu = (double *) mxCalloc(s->e_Size * no_projections, sizeof(double));
+  for (k = 0; k < s->e_Size; k++)
+  {
+    energy = (int) ePtr[k];
+    if (energy < 1 || energy > mu_Size)
+      mexErrMsgTxt("Energies must index rows of mu.");
+    s->weight[k] = energy * nPtr[k];
+    for (l = 0; l < no_projections; l++)
+      s->mu[k*no_projections + l] = -100 * muPtr[l*mu_Size + energy - 1];
+  }
+
+  mexInputRelease(ePtr, e);
+  mexInputRelease(nPtr, n);
+  mexInputRelease(muPtr, mu);
+}
+
+/* Scalar kernel for the bins first..last-1. NP > 0 is the number of
+ * materials known at compile time, NP = 0 uses no_projections. Line
+ * integral l of bin i is pPtr[i*pixelStride + l*materialStride]. */
+template <int NP>
+static void
+scalarKernel(spectrum *spectra, int no_spectra, const double *pPtr, double **apPtr,
+             int no_projections, int pixelStride, int materialStride, int first, int last)
+{
+  const int np = (NP > 0) ? NP : no_projections;
+  int i, k, l, s;
+  double temporarySum, result;
+  const double *mu;
+
+  #pragma omp parallel for private(k, l, s, temporarySum, result, mu)
+  for(i=first;i<last;++i)
+  {
+    for(s=0;s<no_spectra;++s)
+    {
+      result = 0;
+      mu = spectra[s].mu;
+      for(k=0;k<spectra[s].e_Size;++k, mu += np)
+      {
+        temporarySum = 0;
+        for(l=0;l<np;++l)
+          temporarySum += mu[l] * pPtr[i*pixelStride + l*materialStride];
+        result += spectra[s].weight[k] * exp(temporarySum);
+      }
+      apPtr[s][i] = -log(result/spectra[s].ue);
+    }
+  }
+}
+
+#ifdef HAVE_AVX2_KERNEL
+
+/* exp(x) for 4 doubles. x = n*ln2 + r with |r| <= ln2/2, exp(r) by a
+ * degree 12 Taylor polynomial, the relative error is below 1e-15. 2^n is
+ * applied in two halves, so subnormal results are rounded as by exp(). */
+static inline TARGET_AVX2 __m256d
+vexp(__m256d x)
+{
+  const __m256d log2e  = _mm256_set1_pd(1.4426950408889634);
+  const __m256d ln2hi  = _mm256_set1_pd(6.93145751953125e-1);
+  const __m256d ln2lo  = _mm256_set1_pd(1.42860682030941723212e-6);
+  const __m256d shift  = _mm256_set1_pd(6755399441055744.0 + 1023.0);  /* 2^52 + 2^51 + bias */
+  const __m256d xmin   = _mm256_set1_pd(-746.0);
+  const __m256d xmax   = _mm256_set1_pd(709.0);
+  __m256d n, n1, r, poly, scale1, scale2;
+
+  x = _mm256_min_pd(_mm256_max_pd(x, xmin), xmax);
+
+  n = _mm256_round_pd(_mm256_mul_pd(x, log2e), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  r = _mm256_fnmadd_pd(n, ln2hi, x);
+  r = _mm256_fnmadd_pd(n, ln2lo, r);
+
+  poly = _mm256_set1_pd(1.0/479001600.0);
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/39916800.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/3628800.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/362880.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/40320.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/5040.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/720.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/120.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/24.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0/6.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(0.5));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0));
+  poly = _mm256_fmadd_pd(poly, r, _mm256_set1_pd(1.0));
+
+  /* 2^n = 2^n1 * 2^(n-n1), n1 + 1023 lies in the low mantissa bits of
+   * n1 + shift */
+  n1 = _mm256_floor_pd(_mm256_mul_pd(n, _mm256_set1_pd(0.5)));
+  scale1 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(n1, shift)), 52));
+  scale2 = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(
+             _mm256_add_pd(_mm256_sub_pd(n, n1), shift)), 52));
+  return _mm256_mul_pd(_mm256_mul_pd(poly, scale1), scale2);
+}
+
+/* log(x) for 4 positive normal doubles. x = m*2^e with sqrt(1/2) <= m <
+ * sqrt(2), log(m) = 2*atanh(s) with s = (m-1)/(m+1), |s| <= 0.172, by an
+ * odd polynomial of degree 21. The relative error is below 1e-15. */
+static inline TARGET_AVX2 __m256d
+vlog(__m256d x)
+{
+  const __m256i mantissaMask = _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+  const __m256i one          = _mm256_set1_epi64x(0x3FF0000000000000LL);
+  const __m256i magic        = _mm256_set1_epi64x(0x4330000000000000LL);  /* 2^52 */
+  const __m256d sqrt2        = _mm256_set1_pd(1.4142135623730951);
+  const __m256d ln2          = _mm256_set1_pd(6.93147180559945309417e-1);
+  __m256i bits;
+  __m256d m, e, s, s2, poly, big;
+
+  bits = _mm256_castpd_si256(x);
+  m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, mantissaMask), one));
+  e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), magic)),
+                    _mm256_set1_pd(4503599627370496.0 + 1023.0));
+
+  big = _mm256_cmp_pd(m, sqrt2, _CMP_GT_OQ);
+  m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+  e = _mm256_add_pd(e, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+
+  s = _mm256_div_pd(_mm256_sub_pd(m, _mm256_set1_pd(1.0)), _mm256_add_pd(m, _mm256_set1_pd(1.0)));
+  s2 = _mm256_mul_pd(s, s);
+  poly = _mm256_set1_pd(2.0/21.0);
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/19.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/17.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/15.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/13.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/11.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/9.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/7.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/5.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0/3.0));
+  poly = _mm256_fmadd_pd(poly, s2, _mm256_set1_pd(2.0));
+  return _mm256_fmadd_pd(e, ln2, _mm256_mul_pd(poly, s));
+}
+
+/* Line integrals of LANES consecutive bins, which are pixelStride apart.
+ * GCC implements the unmasked gather with an undefined source, which
+ * -Wmaybe-uninitialized reports, so all lanes are gathered into zeros. */
+static inline TARGET_AVX2 __m256d
+loadBins(const double *pPtr, int pixelStride, __m128i offsets)
+{
+  if(pixelStride == 1)
+    return _mm256_loadu_pd(pPtr);
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), pPtr, offsets,
+                                  _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+/* AVX2 kernel for the bins 0..last-1, last is a multiple of LANES */
+template <int NP>
+static TARGET_AVX2 void
+avx2Kernel(spectrum *spectra, int no_spectra, const double *pPtr, double **apPtr,
+           int no_projections, int pixelStride, int materialStride, int last)
+{
+  const int np = (NP > 0) ? NP : no_projections;
+  const __m256d smallest = _mm256_set1_pd(2.2250738585072014e-308);
+  const __m128i offsets = _mm_setr_epi32(0, pixelStride, 2*pixelStride, 3*pixelStride);
+  int i, j, k, l, s;
+  __m256d p[(NP > 0) ? NP : 1];
+  __m256d temporarySum, result, ap;
+  const double *mu;
+  double out[LANES];
+
+  #pragma omp parallel for private(j, k, l, s, p, temporarySum, result, ap, mu, out)
+  for(i=0;i<last;i+=LANES)
+  {
+    if(NP > 0)
+    {
+      for(l=0;l<NP;++l)
+        p[l] = loadBins(pPtr + i*pixelStride + l*materialStride, pixelStride, offsets);
+    }
+
+    for(s=0;s<no_spectra;++s)
+    {
+      result = _mm256_setzero_pd();
+      mu = spectra[s].mu;
+      for(k=0;k<spectra[s].e_Size;++k, mu += np)
+      {
+        temporarySum = _mm256_setzero_pd();
+        if(NP > 0)
+        {
+          for(l=0;l<NP;++l)
+            temporarySum = _mm256_fmadd_pd(_mm256_broadcast_sd(mu + l), p[l], temporarySum);
+        }
+        else
+        {
+          for(l=0;l<np;++l)
+            temporarySum = _mm256_fmadd_pd(_mm256_broadcast_sd(mu + l),
+                                           loadBins(pPtr + i*pixelStride + l*materialStride,
+                                                    pixelStride, offsets),
+                                           temporarySum);
+        }
+        result = _mm256_fmadd_pd(_mm256_broadcast_sd(spectra[s].weight + k),
+                                 vexp(temporarySum), result);
+      }
+      result = _mm256_div_pd(result, _mm256_set1_pd(spectra[s].ue));
+
+      if(_mm256_movemask_pd(_mm256_cmp_pd(result, smallest, _CMP_GE_OQ)) == 0xF)
+      {
+        ap = _mm256_sub_pd(_mm256_setzero_pd(), vlog(result));
+        _mm256_storeu_pd(apPtr[s] + i, ap);
+      }
+      else
+      {
+        /* Zero, subnormal or NaN sums */
+        _mm256_storeu_pd(out, result);
+        for(j=0;j<LANES;++j)
+          apPtr[s][i + j] = -log(out[j]);
+      }
+    }
+  }
+}
+
+static int
+cpuHasAVX2(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+#endif /* HAVE_AVX2_KERNEL */
+
+/* Runs the kernels specialized for NP materials */
+template <int NP>
+static void
+dispatch(spectrum *spectra, int no_spectra, const double *pPtr, double **apPtr,
+         int no_projections, int image_size, int interleaved)
+{
+  int first = 0;
+  int pixelStride = interleaved ? no_projections : 1;
+  int materialStride = interleaved ? 1 : image_size;
+
+#ifdef HAVE_AVX2_KERNEL
+  if(cpuHasAVX2())
+  {
+    first = image_size - image_size % LANES;
+    avx2Kernel<NP>(spectra, no_spectra, pPtr, apPtr, no_projections, pixelStride,
+                   materialStride, first);
+  }
+#endif
+  scalarKernel<NP>(spectra, no_spectra, pPtr, apPtr, no_projections, pixelStride,
+                   materialStride, first, image_size);
+}
+
+/* Is the layout of p 'interleaved' or 'bins'? */
+static int
+isInterleaved(const mxArray *layout)
+{
+  char name[16];
+
+  if (!mxIsChar(layout) || mxGetString(layout, name, sizeof(name)) != 0)
+  {
+      mexErrMsgTxt("Layout must be 'bins' or 'interleaved'.");
+  }
+  if (strcmp(name, "interleaved") == 0)
+    return 1;
+  if (strcmp(name, "bins") != 0)
+    mexErrMsgTxt("Layout must be 'bins' or 'interleaved'.");
+  return 0;
+}
+
+static void
+computePolychromaticProjection(spectrum *spectra, int no_spectra, const double *pPtr,
+                               double **apPtr, int no_projections, int image_size,
+                               int interleaved)
+{
+  switch(no_projections)
+  {
+    case 2:
+      dispatch<2>(spectra, no_spectra, pPtr, apPtr, no_projections, image_size, interleaved);
+      break;
+    case 3:
+      dispatch<3>(spectra, no_spectra, pPtr, apPtr, no_projections, image_size, interleaved);
+      break;
+    case 5:
+      dispatch<5>(spectra, no_spectra, pPtr, apPtr, no_projections, image_size, interleaved);
+      break;
+    case 7:
+      dispatch<7>(spectra, no_spectra, pPtr, apPtr, no_projections, image_size, interleaved);
+      break;
+    case 8:
+      dispatch<8>(spectra, no_spectra, pPtr, apPtr, no_projections, image_size, interleaved);
+      break;
+    default:
+      dispatch<0>(spectra, no_spectra, pPtr, apPtr, no_projections, image_size, interleaved);
+      break;
+  }
+}
@@ -0,0 +1,112 @@
+function lut = createPolyProjLUT(ELow, EHigh, uLow, uHigh, NLow, NHigh, muLow, muHigh,...
+    lmax, numBasis, tableSize)
+  % CREATEPOLYPROJLUT Tabulate polychromatic projections of a spectrum pair.
+  %
+  % The LACs of the Ntbm base materials at the energies of both spectra
+  % are factored jointly by SVD, [M_low; M_high] ~ B * V', where V is
+  % [Ntbm x numBasis]. The line integrals p of a ray are then reduced to
+  % numBasis basis line integrals q = V' * p and the polychromatic projections
+  %   Ap = -log(sum_k E(k)*N(k)*exp(-100*B(k,:)*q) / uE)
+  % are tabulated on a regular grid of q for both spectra. The table is
+  % built once and evaluated by computePolyProjLUT for every iteration.
+  %
+  % The grid covers the basis line integrals of all p with p_i >= 0 and
+  % sum(p) <= lmax. Rays outside the grid are computed exactly with the
+  % full LACs.
+  %
+  % Input:
+  % ELow, EHigh:   spectrum energies in keV, rows of muLow and muHigh
+  % uLow, uHigh:   sum(E.*N) of the spectra
+  % NLow, NHigh:   relative number of photons
+  % muLow, muHigh: [Nmax x Ntbm] LACs in 1/cm of the base materials
+  % lmax:          maximum total line integral in m
+  % numBasis:      number of basis functions, 1 to 3 (default: the
+  %                smallest number with residual below 1e-3, at most 3)
+  % tableSize:     number of grid points per basis function (default 256
+  %                for one and two basis functions, 64 for three)
+  %
+  % Output:
+  % lut:           structure with the fields
+  %   V:           [Ntbm x numBasis] basis, q = V' * p
+  %   qMin, qStep: [1 x numBasis] first grid point and grid step
+  %   tableLow, tableHigh: tabulated Ap on the grid
+  %   wLow, wHigh: E.*N of the spectra
+  %   muLow, muHigh: [Ne x Ntbm] 100*LACs at the spectrum energies
+  %   uLow, uHigh: sum(E.*N) of the spectra
+  %   residual:    maximum error of the exponent -100*mu*p caused by the
+  %                factorization, over all p with sum(p) <= lmax
+  %
+  % Example:
+  %   lut = createPolyProjLUT(smd.ELow, smd.EHigh, uLow, uHigh, smd.NLow,...
+  %     smd.NHigh, pmd.muLow, pmd.muHigh, Nr2*pixsiz);
+  %   [ApLow, ApHigh] = computePolyProjLUT(lut, p);
+
+  ELow = ELow(:);
+  EHigh = EHigh(:);
+  lut.wLow = ELow .* NLow(:);
+  lut.wHigh = EHigh .* NHigh(:);
+  lut.muLow = 100 * muLow(ELow, :);
+  lut.muHigh = 100 * muHigh(EHigh, :);
+  lut.uLow = uLow;
+  lut.uHigh = uHigh;
+  Ntbm = size(muLow, 2);
+
+  % Joint factorization of both spectra
+  M = [lut.muLow; lut.muHigh];
+  [~, ~, V] = svd(M, 'econ');
+  maxRank = min(3, Ntbm);
+  residual = zeros(1, maxRank);
+  for r = 1:maxRank
+    R = M - M * V(:, 1:r) * V(:, 1:r)';
+    residual(r) = lmax * max(abs(R(:)));
+  end
+  if nargin < 10 || isempty(numBasis)
+    numBasis = find(residual < 1e-3, 1);
+    if isempty(numBasis)
+      numBasis = maxRank;
+    end
+  end
+  if numBasis < 1 || numBasis > maxRank
+    error('numBasis must be between 1 and %d', maxRank);
+  end
+  if nargin < 11 || isempty(tableSize)
+    if numBasis < 3
+      tableSize = 256;
+    else
+      tableSize = 64;
+    end
+  end
+  lut.V = V(:, 1:numBasis);
+  lut.residual = residual(numBasis);
+  BLow = lut.muLow * lut.V;
+  BHigh = lut.muHigh * lut.V;
+
+  % q = V' * p over the simplex p_i >= 0, sum(p) <= lmax
+  qMax = lmax * max(0, max(lut.V, [], 1));
+  lut.qMin = lmax * min(0, min(lut.V, [], 1));
+  lut.qStep = (qMax - lut.qMin) / (tableSize - 1);
+
+  % Tabulate Ap. The grid is processed in slabs along the last basis
+  % function to limit the size of the intermediate [points x energies]
+  % matrices.
+  grid = cell(1, numBasis);
+  for r = 1:numBasis
+    grid{r} = lut.qMin(r) + (0:tableSize-1)' * lut.qStep(r);
+  end
+  lut.tableLow = zeros([tableSize * ones(1, numBasis), 1]);
+  lut.tableHigh = zeros([tableSize * ones(1, numBasis), 1]);
+  slab = tableSize^(numBasis-1);
+  Q = zeros(slab, numBasis);
+  if numBasis > 1
+    G = cell(1, numBasis-1);
+    [G{:}] = ndgrid(grid{1:numBasis-1});
+    for r = 1:numBasis-1
+      Q(:, r) = G{r}(:);
+    end
+  end
+  for j = 1:tableSize
+    Q(:, numBasis) = grid{numBasis}(j);
+    lut.tableLow((j-1)*slab+1:j*slab) = -log(exp(-Q * BLow') * lut.wLow / uLow);
+    lut.tableHigh((j-1)*slab+1:j*slab) = -log(exp(-Q * BHigh') * lut.wHigh / uHigh);
+  end
+end
@@ -0,0 +1,95 @@
+function [Wei2, dens, Wei3, dens3, Vol] = decomposeTissues(AttE1mat, AttE2mat, Att2, Dens2,...
+    tissue2, Att3, Dens3, tissue3, isSpecial)
+  % DECOMPOSETISSUES Two- and three-material decomposition of all tissues.
+  %
+  % Decomposes every tissue doublet with MD2 and every tissue triplet with
+  % MD3. The C version processes all tissues in one pass over the images.
+  %
+  % Input:
+  % AttE1mat:  matrix of measured LACs at effective energy E1
+  % AttE2mat:  matrix of measured LACs at effective energy E2
+  % Att2:      cell of tabulated LACs of doublet base materials at E1 and E2
+  % Dens2:     cell of mass densities of doublet base materials
+  % tissue2:   cell of masks defining the doublet tissues to be decomposed,
+  %            or of the sorted pixel indices of the tissues, see maskIndices
+  % Att3:      cell of tabulated LACs of triplet base materials at E1 and E2
+  % Dens3:     cell of mass densities of triplet base materials
+  % tissue3:   cell of masks or pixel indices of the triplet tissues
+  % isSpecial: different treatment at a vacuum-tissue border, see MD3
+  %
+  % Output:
+  % Wei2:     cell with 2 matrices of mass fractions per doublet tissue
+  % dens:     cell with a matrix of mass densities per doublet tissue
+  % Wei3:     cell with 3 matrices of mass fractions per triplet tissue
+  % dens3:    cell with a matrix of mass densities per triplet tissue, see
+  %           computeDensityMd3
+  % Vol:      [Nr x Nr x 2*Nt2+3*Nt3] volume fractions v_i = w_i*rho/rho_i
+  %           of all base materials, the doublets first. This is the stack
+  %           of images projected in DIRA.
+  %
+  % The C version computes dens3 and Vol in the same pass as the mass
+  % fractions, only if they are requested.
+  %
+  % Only the first length(tissue2) doublets and length(tissue3) triplets
+  % are decomposed. Pass an empty cell to skip MD2 or MD3.
+
+  if nargin < 9
+    isSpecial = 0;
+  end
+
+  % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+  global useCode
+  switch (useCode)
+    case {1, 2, 3}
+      if nargout > 3
+        [Wei2, dens, Wei3, dens3, Vol] = decomposeTissuesc(AttE1mat, AttE2mat,...
+          Att2, Dens2, tissue2, Att3, Dens3, tissue3, isSpecial);
+      else
+        [Wei2, dens, Wei3] = decomposeTissuesc(AttE1mat, AttE2mat, Att2, Dens2,...
+          tissue2, Att3, Dens3, tissue3, isSpecial);
+      end
+      return;
+  end
+
+  Wei2 = cell(length(tissue2), 1);
+  dens = cell(length(tissue2), 1);
+  for id = 1:length(tissue2)  % id = doublet index
+    [Wei2{id}, dens{id}] = MD2(AttE1mat, AttE2mat, Att2{id}, Dens2{id},...
+      tissueMask(tissue2{id}, size(AttE1mat)));
+  end
+
+  Wei3 = cell(length(tissue3), 1);
+  for it = 1:length(tissue3)  % it = triplet index
+    Wei3{it} = MD3(AttE1mat, AttE2mat, Att3{it}, Dens3{it},...
+      tissueMask(tissue3{it}, size(AttE1mat)), isSpecial);
+  end
+
+  if nargout < 4
+    return;
+  end
+
+  % Volume fractions v_i = w_i * rho / rho_i
+  Vol = zeros(size(AttE1mat, 1), size(AttE1mat, 2), 2*length(tissue2) + 3*length(tissue3));
+  dens3 = cell(length(tissue3), 1);
+  for id = 1:length(tissue2)  % id = doublet index
+    for ic = 1:2
+      Vol(:, :, 2*(id-1) + ic) = Wei2{id}(:, :, ic) .* dens{id} / Dens2{id}(ic);
+    end
+  end
+  for it = 1:length(tissue3)  % it = triplet index
+    dens3{it} = computeDensityMd3(Wei3{it}, Dens3{it});
+    for i = 1:3
+      Vol(:, :, 2*length(tissue2) + 3*(it-1) + i) = Wei3{it}(:, :, i) .* dens3{it} / Dens3{it}(i);
+    end
+  end
+end
+
+function mask = tissueMask(tissue, imgSize)
+  % Mask of a tissue given as a mask or as a list of pixel indices
+  if islogical(tissue)
+    mask = tissue;
+  else
+    mask = false(imgSize);
+    mask(tissue) = true;
+  end
+end
@@ -0,0 +1,518 @@
+/*-------------------------------------------------------------------*/
+/* Two- and three-material decomposition of all tissue doublets and  */
+/* triplets in one call, see MD2c.c and MD3c.c. The images are       */
+/* processed in blocks of pixels distributed over the threads. Each  */
+/* block is decomposed for every doublet and triplet while the       */
+/* measured LACs of the block are in the cache: the tissue pixels of */
+/* the block are gathered, their systems are solved by a vectorized  */
+/* loop without branches and the results are scattered. The terms of */
+/* the MD2 system that do not depend on the pixel are computed once  */
+/* per doublet. The mass densities of the triplets and the volume    */
+/* fractions of all base materials are computed in the same pass.    */
+/* The results are the same as those of MD2c, MD3c,                  */
+/* computeDensityMd3.m and the volume fractions of DIRA.m.           */
+/*                                                                   */
+/* Usage:                                                            */
+/*   [Wei2, dens, Wei3, dens3, Vol] = decomposeTissuesc(AttE1mat,    */
+/*       AttE2mat, Att2, Dens2, mask2, Att3, Dens3, mask3,           */
+/*       isSpecial)                                                  */
+/*   AttE1mat:  [M x N] measured LACs at E1                          */
+/*   AttE2mat:  [M x N] measured LACs at E2                          */
+/*   Att2:      {Nt2} cell of [2 x 2] tabulated LACs of doublets     */
+/*   Dens2:     {Nt2} cell of [1 x 2] mass densities of doublets     */
+/*   mask2:     {Nt2} cell of [M x N] masks of doublets, or of the   */
+/*              sorted linear indices of their pixels, see           */
+/*              maskIndices.m                                        */
+/*   Att3:      {Nt3} cell of [2 x 3] tabulated LACs of triplets     */
+/*   Dens3:     {Nt3} cell of [1 x 3] mass densities of triplets     */
+/*   mask3:     {Nt3} cell of masks or index lists of triplets       */
+/*   isSpecial: see MD3.m, optional, default 0                       */
+/*   Wei2:      {Nt2 x 1} cell of [M x N x 2] mass fractions         */
+/*   dens:      {Nt2 x 1} cell of [M x N] mass densities             */
+/*   Wei3:      {Nt3 x 1} cell of [M x N x 3] mass fractions         */
+/*   dens3:     {Nt3 x 1} cell of [M x N] mass densities, optional,  */
+/*              see computeDensityMd3.m                              */
+/*   Vol:       [M x N x 2*Nt2+3*Nt3] volume fractions of all base   */
+/*              materials, optional, the doublets first. This is the */
+/*              image stack projected by sinogramJExec in DIRA.m.    */
+/*                                                                   */
+/* Only the pixels of a tissue are written, the others stay 0. With  */
+/* index lists the images are not scanned for the tissue pixels.     */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include "mex.h"
+#include "mexInputAccess.h"
+
+/* Number of pixels in a block. The tissue pixels of a block are gathered
+ * into buffers of this size, which fit in the L1 cache. */
+#define BLOCK_SIZE 256
+
+/* Results per pixel of a tissue with n base materials: n mass fractions,
+ * the mass density and n volume fractions */
+#define MAX_OUTPUTS 7
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+/* Input Arguments */
+#define ATTE1MAT  (prhs[0])
+#define ATTE2MAT  (prhs[1])
+#define ATT2      (prhs[2])
+#define DENS2     (prhs[3])
+#define MASK2     (prhs[4])
+#define ATT3      (prhs[5])
+#define DENS3     (prhs[6])
+#define MASK3     (prhs[7])
+#define ISSPECIAL (prhs[8])
+
+/* Output Arguments */
+#define WEI2      (plhs[0])
+#define DENS      (plhs[1])
+#define WEI3      (plhs[2])
+#define DENSITY3  (plhs[3])
+#define VOL       (plhs[4])
+
+/* Pixels of a tissue, a mask or a sorted list of indices */
+typedef struct
+{
+  const mxLogical *mask;    /* [image_size] mask, or NULL */
+  const double *list;       /* sorted 1-based linear indices, or NULL */
+  int count;                /* number of indices in list */
+  const mxArray *array;     /* input viewed by mask or list */
+} pixelSet;
+
+typedef struct
+{
+  /* Terms of the system that do not depend on the pixel */
+  double m00;           /* Att2(1,1)/Dens2(1) - Att2(1,2)/Dens2(2) */
+  double b0;            /* -Att2(1,2)/Dens2(2) */
+  double quota;         /* m10/m00 of the Gaussian elimination */
+  double b1;            /* b1 - b0*quota */
+  double dens[2];       /* mass densities */
+  pixelSet pixels;
+  double *dst[MAX_OUTPUTS]; /* images of the results, see MAX_OUTPUTS */
+  int numOutputs;       /* number of results written */
+} doublet;
+
+typedef struct
+{
+  double att[6];        /* tabulated LACs, column-major [2 x 3] */
+  double dens[3];       /* mass densities */
+  pixelSet pixels;
+  double *dst[MAX_OUTPUTS]; /* images of the results, see MAX_OUTPUTS */
+  int numOutputs;       /* number of results written */
+} triplet;
+
+static void getTissue(const mxArray *cell, int k, int numElements, double *values,
+                      const char *name);
+static void getPixels(const mxArray *cell, int k, int image_size, pixelSet *pixels);
+static void releasePixels(pixelSet *pixels);
+static void decompose(doublet *doublets, int numDoublets, triplet *triplets,
+                      int numTriplets, const double *atte1Ptr, const double *atte2Ptr,
+                      int isSpecial, int image_size);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  const double *atte1Ptr;   /* measured LACs at E1 */
+  const double *atte2Ptr;   /* measured LACs at E2 */
+  doublet *doublets;
+  triplet *triplets;
+  int numDoublets, numTriplets;
+  int isSpecial;
+  int M, N, image_size;
+  double att[6];
+  double *wei, *densPtr, *volPtr;
+  mxArray *array;
+  mwSize dims[3];
+  int k, i;
+
+  /* Check validity of arguments */
+  if (nrhs != 8 && nrhs != 9)
+  {
+    mexErrMsgTxt("Incorrect number of INPUT arguments.");
+  }
+  if (nlhs > 5)
+  {
+    mexErrMsgTxt("Incorrect number of OUTPUT arguments.");
+  }
+  for (k = 0; k < 2; k++)
+  {
+    if (mxIsSparse(prhs[k]) || mxIsComplex(prhs[k]) || !mxIsNumeric(prhs[k]))
+      mexErrMsgTxt("AttE1mat and AttE2mat must be real and numeric.");
+  }
+  for (k = 2; k < 8; k++)
+  {
+    if (!mxIsCell(prhs[k]))
+      mexErrMsgTxt("Att2, Dens2, mask2, Att3, Dens3 and mask3 must be cells.");
+  }
+
+  M = mxGetM(ATTE1MAT);
+  N = mxGetN(ATTE1MAT);
+  image_size = M*N;
+  if (mxGetNumberOfElements(ATTE2MAT) != image_size)
+  {
+    mexErrMsgTxt("AttE1mat and AttE2mat must have the same size.");
+  }
+
+  numDoublets = mxGetNumberOfElements(MASK2);
+  numTriplets = mxGetNumberOfElements(MASK3);
+  if (mxGetNumberOfElements(ATT2) < numDoublets || mxGetNumberOfElements(DENS2) < numDoublets)
+  {
+    mexErrMsgTxt("Att2 and Dens2 must have one element per doublet mask.");
+  }
+  if (mxGetNumberOfElements(ATT3) < numTriplets || mxGetNumberOfElements(DENS3) < numTriplets)
+  {
+    mexErrMsgTxt("Att3 and Dens3 must have one element per triplet mask.");
+  }
+  isSpecial = (nrhs == 9) ? (mxGetScalar(ISSPECIAL) != 0) : 0;
+
+  WEI2 = mxCreateCellMatrix(numDoublets, 1);
+  DENS = mxCreateCellMatrix(numDoublets, 1);
+  WEI3 = mxCreateCellMatrix(numTriplets, 1);
+  if (nlhs > 3)
+    DENSITY3 = mxCreateCellMatrix(numTriplets, 1);
+  doublets = (doublet *) mxCalloc(numDoublets > 0 ? numDoublets : 1, sizeof(doublet));
+  triplets = (triplet *) mxCalloc(numTriplets > 0 ? numTriplets : 1, sizeof(triplet));
+
+  /* The volume fractions of all tissues are stacked in one array */
+  dims[0] = M;
+  dims[1] = N;
+  volPtr = NULL;
+  if (nlhs > 4)
+  {
+    dims[2] = 2*numDoublets + 3*numTriplets;
+    VOL = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+    volPtr = mxGetPr(VOL);
+  }
+
+  for (k = 0; k < numDoublets; k++)
+  {
+    getTissue(ATT2, k, 4, att, "Att2 must contain 2x2 matrices.");
+    getTissue(DENS2, k, 2, doublets[k].dens, "Dens2 must contain 1x2 vectors.");
+    doublets[k].m00   = att[0]/doublets[k].dens[0] - att[2]/doublets[k].dens[1];
+    doublets[k].b0    = -att[2]/doublets[k].dens[1];
+    doublets[k].quota = (att[1]/doublets[k].dens[0] - att[3]/doublets[k].dens[1]) /
+                        doublets[k].m00;
+    doublets[k].b1    = -att[3]/doublets[k].dens[1] - doublets[k].b0*doublets[k].quota;
+    getPixels(MASK2, k, image_size, &doublets[k].pixels);
+
+    dims[2] = 2;
+    array = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+    wei = mxGetPr(array);
+    mxSetCell(WEI2, k, array);
+    array = mxCreateDoubleMatrix(M, N, mxREAL);
+    densPtr = mxGetPr(array);
+    mxSetCell(DENS, k, array);
+
+    doublets[k].numOutputs = (volPtr != NULL) ? 5 : 3;
+    for (i = 0; i < 2; i++)
+    {
+      doublets[k].dst[i] = wei + i*image_size;
+      if (volPtr != NULL)
+        doublets[k].dst[3 + i] = volPtr + (2*k + i)*image_size;
+    }
+    doublets[k].dst[2] = densPtr;
+  }
+  for (k = 0; k < numTriplets; k++)
+  {
+    getTissue(ATT3, k, 6, triplets[k].att, "Att3 must contain 2x3 matrices.");
+    getTissue(DENS3, k, 3, triplets[k].dens, "Dens3 must contain 1x3 vectors.");
+    getPixels(MASK3, k, image_size, &triplets[k].pixels);
+
+    dims[2] = 3;
+    array = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxREAL);
+    wei = mxGetPr(array);
+    mxSetCell(WEI3, k, array);
+
+    triplets[k].numOutputs = (volPtr != NULL) ? 7 : (nlhs > 3) ? 4 : 3;
+    for (i = 0; i < 3; i++)
+    {
+      triplets[k].dst[i] = wei + i*image_size;
+      if (volPtr != NULL)
+        triplets[k].dst[4 + i] = volPtr + (2*numDoublets + 3*k + i)*image_size;
+    }
+    if (nlhs > 3)
+    {
+      array = mxCreateDoubleMatrix(M, N, mxREAL);
+      triplets[k].dst[3] = mxGetPr(array);
+      mxSetCell(DENSITY3, k, array);
+    }
+  }
+
+  atte1Ptr = mexInputDoubles(ATTE1MAT);
+  atte2Ptr = mexInputDoubles(ATTE2MAT);
+
+  decompose(doublets, numDoublets, triplets, numTriplets, atte1Ptr, atte2Ptr,
+            isSpecial, image_size);
+
+  mexInputRelease(atte1Ptr, ATTE1MAT);
+  mexInputRelease(atte2Ptr, ATTE2MAT);
+  for (k = 0; k < numDoublets; k++)
+    releasePixels(&doublets[k].pixels);
+  for (k = 0; k < numTriplets; k++)
+    releasePixels(&triplets[k].pixels);
+  mxFree(doublets);
+  mxFree(triplets);
+  mexInputReport("decomposeTissuesc");
+}
+
+/* Copies the tabulated values of tissue k */
+static void
+getTissue(const mxArray *cell, int k, int numElements, double *values, const char *name)
+{
+  const mxArray *a = mxGetCell(cell, k);
+  int i;
+
+  if (a == NULL || !mxIsNumeric(a) || mxGetNumberOfElements(a) != numElements)
+  {
+    mexErrMsgTxt(name);
+  }
+  for (i = 0; i < numElements; i++)
+    values[i] = mexInputElement(a, i);
+}
+
+/* View of the pixels of tissue k, a logical mask or an index list */
+static void
+getPixels(const mxArray *cell, int k, int image_size, pixelSet *pixels)
+{
+  const mxArray *a = mxGetCell(cell, k);
+  int j;
+
+  if (a == NULL || (!mxIsLogical(a) && !mxIsNumeric(a)))
+  {
+    mexErrMsgTxt("The masks must be logical images or index lists.");
+  }
+  pixels->array = a;
+  pixels->mask = NULL;
+  pixels->list = NULL;
+  pixels->count = 0;
+  if (mxIsLogical(a))
+  {
+    if (mxGetNumberOfElements(a) != image_size)
+      mexErrMsgTxt("The masks must be logical images of the size of AttE1mat.");
+    pixels->mask = mexInputLogicals(a);
+    return;
+  }
+
+  pixels->count = mxGetNumberOfElements(a);
+  pixels->list = mexInputDoubles(a);
+  for (j = 0; j < pixels->count; j++)
+  {
+    if (pixels->list[j] < 1 || pixels->list[j] > image_size ||
+        (j > 0 && pixels->list[j] <= pixels->list[j-1]))
+    {
+      mexErrMsgTxt("The index lists must be sorted pixel indices of AttE1mat.");
+    }
+  }
+}
+
+static void
+releasePixels(pixelSet *pixels)
+{
+  if (pixels->mask != NULL)
+    mexInputRelease(pixels->mask, pixels->array);
+  if (pixels->list != NULL)
+    mexInputRelease(pixels->list, pixels->array);
+}
+
+/* Position of the first index of a sorted list that is >= i */
+static int
+findIndex(const double *list, int count, int i)
+{
+  int lo = 0, hi = count, mid;
+
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo)/2;
+    if (list[mid] < i)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Gathers the indices and the measured LACs of the tissue pixels among
+ * first..last-1, returns their number. Masks are compacted without
+ * branches, the masks of the tissues interleave unpredictably. Index
+ * lists are sorted, the pixels of the block are found by bisection. */
+static int
+gatherPixels(const pixelSet *pixels, const double *atte1Ptr, const double *atte2Ptr,
+             int first, int last, int *index, double *e1, double *e2)
+{
+  int i, j, n = 0;
+
+  if (pixels->mask != NULL)
+  {
+    for(i=first;i<last;++i)
+    {
+      index[n] = i;
+      n += (pixels->mask[i] == 1);
+    }
+  }
+  else
+  {
+    /* The list holds 1-based indices */
+    i = findIndex(pixels->list, pixels->count, first + 1);
+    j = findIndex(pixels->list + i, pixels->count - i, last + 1);
+    for(n=0;n<j;++n)
+      index[n] = (int) pixels->list[i + n] - 1;
+  }
+  for(j=0;j<n;++j)
+  {
+    e1[j] = atte1Ptr[index[j]];
+    e2[j] = atte2Ptr[index[j]];
+  }
+  return n;
+}
+
+/* Writes the results of the gathered pixels to their images */
+static void
+scatterPixels(const int *index, int n, double (*out)[BLOCK_SIZE], double **dst,
+              int numOutputs)
+{
+  int j, o;
+
+  for(o=0;o<numOutputs;++o)
+  {
+    for(j=0;j<n;++j)
+      dst[o][index[j]] = out[o][j];
+  }
+}
+
+/* MD2 of n gathered pixels of a doublet: mass fractions and density */
+static void
+solveDoublet(const doublet *d, int n, const double *e1, const double *e2,
+             double (*out)[BLOCK_SIZE])
+{
+  int j;
+  const double m00 = d->m00, b0 = d->b0, quota = d->quota, b1 = d->b1;
+
+  #pragma omp simd
+  for(j=0;j<n;++j)
+  {
+    /* m01 = -AttE1mat, m11 = -AttE2mat, Gaussian elimination */
+    double m01 = -e1[j];
+    double m11 = -e2[j] - m01*quota;
+    double w1  = b1/m11;
+    double w0  = (b0 - m01*w1)/m00;
+
+    out[0][j] = w0;
+    out[1][j] = 1 - w0;
+    out[2][j] = 1/w1;
+  }
+}
+
+/* MD3 of n gathered pixels of a triplet: mass fractions */
+static void
+solveTriplet(const triplet *t, int n, const double *e1, const double *e2, int isSpecial,
+             double (*out)[BLOCK_SIZE])
+{
+  int j;
+  const double a0 = t->att[0], a1 = t->att[1], a2 = t->att[2];
+  const double a3 = t->att[3], a4 = t->att[4], a5 = t->att[5];
+  const double d0 = t->dens[0], d1 = t->dens[1], d2 = t->dens[2];
+
+  #pragma omp simd
+  for(j=0;j<n;++j)
+  {
+    double c1  = (e1[j] - a4)/d2;
+    double c2  = (e2[j] - a5)/d2;
+    double m00 = (e1[j] - a0)/d0 - c1;
+    double m01 = (e1[j] - a2)/d1 - c1;
+    double m10 = (e2[j] - a1)/d0 - c2;
+    double m11 = (e2[j] - a3)/d1 - c2;
+    double b0  = -c1;
+    double b1  = -c2;
+    double quota, w0, w1;
+    int special = isSpecial & !((e1[j] >= a0) & (e2[j] >= a1));
+
+    /* Use Gaussian elimination to solve the linear equation */
+    quota = m10/m00;
+    m11   = m11 - m01*quota;
+    b1    = b1 - b0*quota;
+    w1    = b1/m11;
+    b0    = b0 - m01*w1;
+    w0    = b0/m00;
+
+    /* At a vacuum-tissue border only the first fraction is set */
+    out[0][j] = special ? (e1[j]/a0 + e2[j]/a1)/2 : w0;
+    out[1][j] = special ? 0 : w1;
+    out[2][j] = special ? 0 : 1 - w0 - w1;
+  }
+}
+
+/* Mass density of n pixels of a triplet from their mass fractions, as
+ * computeDensityMd3.m, whose sum starts from 0 */
+static void
+densityTriplet(const triplet *t, int n, double (*out)[BLOCK_SIZE])
+{
+  int j;
+  const double d0 = t->dens[0], d1 = t->dens[1], d2 = t->dens[2];
+
+  #pragma omp simd
+  for(j=0;j<n;++j)
+  {
+    double density = 1.0 / (0 + out[0][j]/d0 + out[1][j]/d1 + out[2][j]/d2);
+
+    out[3][j] = (density == HUGE_VAL) ? 0.0 : density;
+  }
+}
+
+/* Volume fractions v_i = w_i*rho/rho_i of n pixels of a tissue with
+ * numMaterials base materials of the mass densities dens */
+static void
+volumeFractions(int n, int numMaterials, const double *dens, double (*out)[BLOCK_SIZE])
+{
+  int i, j;
+  const double *density = out[numMaterials];
+
+  for(i=0;i<numMaterials;++i)
+  {
+    const double *w = out[i];
+    double *v = out[numMaterials + 1 + i];
+    const double rho = dens[i];
+
+    #pragma omp simd
+    for(j=0;j<n;++j)
+      v[j] = w[j] * density[j] / rho;
+  }
+}
+
+static void
+decompose(doublet *doublets, int numDoublets, triplet *triplets, int numTriplets,
+          const double *atte1Ptr, const double *atte2Ptr, int isSpecial, int image_size)
+{
+  int first, last, k, n;
+
+  #pragma omp parallel for private(last, k, n)
+  for(first=0;first<image_size;first+=BLOCK_SIZE)
+  {
+    int index[BLOCK_SIZE];              /* tissue pixels of the block */
+    double e1[BLOCK_SIZE];              /* their LACs at E1 */
+    double e2[BLOCK_SIZE];              /* their LACs at E2 */
+    double out[MAX_OUTPUTS][BLOCK_SIZE]; /* their results */
+
+    last = MIN(first + BLOCK_SIZE, image_size);
+    for(k=0;k<numDoublets;++k)
+    {
+      n = gatherPixels(&doublets[k].pixels, atte1Ptr, atte2Ptr, first, last, index, e1, e2);
+      solveDoublet(&doublets[k], n, e1, e2, out);
+      if(doublets[k].numOutputs > 3)
+        volumeFractions(n, 2, doublets[k].dens, out);
+      scatterPixels(index, n, out, doublets[k].dst, doublets[k].numOutputs);
+    }
+    for(k=0;k<numTriplets;++k)
+    {
+      n = gatherPixels(&triplets[k].pixels, atte1Ptr, atte2Ptr, first, last, index, e1, e2);
+      solveTriplet(&triplets[k], n, e1, e2, isSpecial, out);
+      if(triplets[k].numOutputs > 3)
+        densityTriplet(&triplets[k], n, out);
+      if(triplets[k].numOutputs > 4)
+        volumeFractions(n, 3, triplets[k].dens, out);
+      scatterPixels(index, n, out, triplets[k].dst, triplets[k].numOutputs);
+    }
+  }
+}
@@ -0,0 +1,49 @@
+function f = fanFBP(g, betavec, gammavec, L, N)
+  % FANFBP Fan-beam filtered backprojection for equiangular detectors.
+  %
+  % The projections are weighted by L*cos(gamma), ramp filtered with the
+  % fan-beam kernel of ramp.m and backprojected with the inverse squared
+  % source-pixel distance by backprojectFanc. If the source angles cover
+  % less than 360 degrees (short scan, e.g. 228 degrees), the redundant
+  % rays are weighted by the Parker weights.
+  %
+  % Input:
+  % g:        [numel(gammavec) x numel(betavec)] fan-beam projections,
+  %           line integrals in pixels, see sinogramFanJ
+  % betavec:  equally spaced source angles in degrees
+  % gammavec: equally spaced fan angles of the detector elements in radians
+  % L:        distance source - rotation center in pixels
+  % N:        size of the N x N reconstructed image
+  %
+  % Output:
+  % f:        [N x N] reconstructed image
+  %
+  % See also: sinogramFanJ, ramp
+
+  Nb = numel(betavec);
+  gamma = gammavec(:);
+  dbeta = abs(betavec(2) - betavec(1)) * pi / 180;
+  dgamma = gamma(2) - gamma(1);
+  range = Nb * dbeta;
+
+  % Cosine weighting
+  q = g .* ((L * cos(gamma)) * ones(1, Nb));
+
+  % Parker weights for short scans. delta is half the fan angle, or half
+  % of the overscan if the scan covers more than 180 degrees + fan angle.
+  if range < 2*pi - dbeta/2
+    delta = max(max(abs(gamma)) + abs(dgamma)/2, (range - pi) / 2);
+    [b, gam] = meshgrid((0:Nb-1) * dbeta, gamma);
+    w = ones(size(q));
+    idx = b < 2 * (delta - gam);
+    w(idx) = sin(pi/4 * b(idx) ./ (delta - gam(idx))).^2;
+    idx = b > pi - 2 * gam;
+    w(idx) = sin(pi/4 * max(0, pi + 2*delta - b(idx)) ./ (delta + gam(idx))).^2;
+    % Every line is measured once, while a full scan measures it twice
+    q = 2 * w .* q;
+  end
+
+  % Ramp filtering and backprojection
+  q = ramp(q, abs(dgamma)) * abs(dgamma) * dbeta;
+  f = backprojectFanc(q, betavec, gammavec, L, N);
+end
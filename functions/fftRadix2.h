@@ -0,0 +1,140 @@
+/*-------------------------------------------------------------------*/
+/* Radix-2 fast Fourier transforms for the MEX functions.            */
+/*                                                                   */
+/* A plan holds the bit-reversal permutation and the twiddle factors */
+/* of one power-of-2 length. The transform is computed in place on   */
+/* separate real and imaginary arrays:                               */
+/*                                                                   */
+/*   fftPlan *plan = fftCreatePlan(n);                               */
+/*   fftExecute(plan, re, im, 0);     forward, as MATLAB's fft       */
+/*   fftExecute(plan, re, im, 1);     inverse, as MATLAB's ifft      */
+/*   fftDestroyPlan(plan);                                           */
+/*                                                                   */
+/* Plans are read-only during fftExecute, so the threads may share   */
+/* one plan. The twiddle factors are computed directly, not by a     */
+/* recurrence, so the transforms are accurate to a few ulps.         */
+/*-------------------------------------------------------------------*/
+#ifndef FFT_RADIX2_H
+#define FFT_RADIX2_H
+
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(__GNUC__)
+#define FFT_FUNCTION static __attribute__((unused))
+#else
+#define FFT_FUNCTION static
+#endif
+
+typedef struct
+{
+  int n;                /* length, a power of 2 */
+  int *reversed;        /* bit-reversed index of every index */
+  double *cosine;       /* cos(2*pi*k/n), k < n/2 */
+  double *sine;         /* sin(2*pi*k/n), k < n/2 */
+} fftPlan;
+
+/* Smallest power of 2 that is >= n */
+FFT_FUNCTION int
+fftNextPow2(int n)
+{
+  int m = 1;
+
+  while (m < n)
+    m *= 2;
+  return m;
+}
+
+/* Plan for the length n, which must be a power of 2 */
+FFT_FUNCTION fftPlan *
+fftCreatePlan(int n)
+{
+  fftPlan *plan;
+  int k, bits, r, m;
+  const double pi = 3.14159265358979323846;
+
+  plan = (fftPlan *) malloc(sizeof(fftPlan));
+  plan->n = n;
+  plan->reversed = (int *) malloc(n * sizeof(int));
+  plan->cosine = (double *) malloc((n/2 + 1) * sizeof(double));
+  plan->sine = (double *) malloc((n/2 + 1) * sizeof(double));
+
+  for (bits = 0; (1 << bits) < n; bits++)
+    ;
+  for (k = 0; k < n; k++)
+  {
+    r = 0;
+    for (m = 0; m < bits; m++)
+      r |= ((k >> m) & 1) << (bits - 1 - m);
+    plan->reversed[k] = r;
+  }
+  for (k = 0; k < n/2; k++)
+  {
+    plan->cosine[k] = cos(2*pi*k/n);
+    plan->sine[k] = sin(2*pi*k/n);
+  }
+  return plan;
+}
+
+FFT_FUNCTION void
+fftDestroyPlan(fftPlan *plan)
+{
+  if (plan == NULL)
+    return;
+  free(plan->reversed);
+  free(plan->cosine);
+  free(plan->sine);
+  free(plan);
+}
+
+/* In-place transform of re + i*im. The forward transform uses the kernel
+ * exp(-2*pi*i*j*k/n), the inverse exp(+2*pi*i*j*k/n) and the factor 1/n. */
+FFT_FUNCTION void
+fftExecute(const fftPlan *plan, double *re, double *im, int inverse)
+{
+  const int n = plan->n;
+  const double sign = inverse ? 1.0 : -1.0;
+  int k, r, len, half, step, i, j;
+  double t, wr, wi, xr, xi;
+
+  for (k = 0; k < n; k++)
+  {
+    r = plan->reversed[k];
+    if (r > k)
+    {
+      t = re[k]; re[k] = re[r]; re[r] = t;
+      t = im[k]; im[k] = im[r]; im[r] = t;
+    }
+  }
+
+  for (len = 2; len <= n; len *= 2)
+  {
+    half = len/2;
+    step = n/len;
+    for (i = 0; i < n; i += len)
+    {
+      for (j = 0; j < half; j++)
+      {
+        wr = plan->cosine[j*step];
+        wi = sign*plan->sine[j*step];
+        xr = re[i + j + half]*wr - im[i + j + half]*wi;
+        xi = re[i + j + half]*wi + im[i + j + half]*wr;
+        re[i + j + half] = re[i + j] - xr;
+        im[i + j + half] = im[i + j] - xi;
+        re[i + j] += xr;
+        im[i + j] += xi;
+      }
+    }
+  }
+
+  if (inverse)
+  {
+    for (k = 0; k < n; k++)
+    {
+      re[k] /= n;
+      im[k] /= n;
+    }
+  }
+}
+
+#endif /* FFT_RADIX2_H */
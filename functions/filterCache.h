@@ -0,0 +1,216 @@
+/*-------------------------------------------------------------------*/
+/* Cache of the frequency responses and FFT plans of the MEX         */
+/* functions that filter projections, projectionFilterc and          */
+/* filterProjectionsc.                                               */
+/*                                                                   */
+/* A filter is designed once per key: the filter type, the column    */
+/* length, the FFT length, two parameters and an optional table,     */
+/* e.g. an MTF. The calling file designs the frequency response in a */
+/* filterDesign function. Plans are kept per power of 2 length. The  */
+/* cache lives until the MEX file is cleared, FILTER_CACHE_SIZE      */
+/* filters are kept and the oldest one is replaced:                  */
+/*                                                                   */
+/*   plan = getCachedPlan(order);                                    */
+/*   filter = getCachedFilter(type, len, order, param, 0, NULL, 0,   */
+/*                            designFilter);                         */
+/*   filterColumns(q, p, filter->filt, plan, len, numColumns);       */
+/*                                                                   */
+/* The cache is not thread safe, filterColumns distributes the pairs */
+/* of columns over the threads.                                      */
+/*-------------------------------------------------------------------*/
+#ifndef FILTER_CACHE_H
+#define FILTER_CACHE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "fftRadix2.h"
+
+#if defined(__GNUC__)
+#define FILTER_CACHE_FUNCTION static __attribute__((unused))
+#else
+#define FILTER_CACHE_FUNCTION static
+#endif
+
+/* Number of cached filters, the oldest one is replaced */
+#define FILTER_CACHE_SIZE 16
+
+/* Plans are cached by log2 of their length */
+#define MAX_LOG2_LENGTH 31
+
+typedef struct
+{
+  int type;             /* filter type of the calling file */
+  int length;           /* length of the columns */
+  int order;            /* FFT length */
+  double param[2];      /* parameters of the filter */
+  int tableLength;      /* number of elements of the table */
+  double *table;        /* copy of the table, part of the key */
+  double *filt;         /* [order] frequency response */
+} cachedFilter;
+
+/* Fills f->filt from the key of f, plan is the FFT of length f->order */
+typedef void (*filterDesign)(cachedFilter *f, const fftPlan *plan);
+
+static cachedFilter *filterCache[FILTER_CACHE_SIZE];  /* cached filters */
+static int nextCachedFilter = 0;                      /* slot of the next new filter */
+static fftPlan *planCache[MAX_LOG2_LENGTH];           /* cached plans, by log2 of the length */
+static int filterCacheInitialized = 0;
+
+static void freeFilterCache(void);
+
+FILTER_CACHE_FUNCTION void
+initFilterCache(void)
+{
+  if (!filterCacheInitialized)
+  {
+    mexAtExit(freeFilterCache);
+    filterCacheInitialized = 1;
+  }
+}
+
+/* The cached plan of the power of 2 length order */
+FILTER_CACHE_FUNCTION const fftPlan *
+getCachedPlan(int order)
+{
+  int bits;
+
+  initFilterCache();
+  for (bits = 0; (1 << bits) < order; bits++)
+    ;
+  if (planCache[bits] == NULL)
+    planCache[bits] = fftCreatePlan(order);
+  return planCache[bits];
+}
+
+FILTER_CACHE_FUNCTION void
+freeCachedFilter(cachedFilter *f)
+{
+  if (f == NULL)
+    return;
+  free(f->table);
+  free(f->filt);
+  free(f);
+}
+
+/* The cached filter of the key, designed by design if it is not in the
+ * cache */
+FILTER_CACHE_FUNCTION const cachedFilter *
+getCachedFilter(int type, int length, int order, double param0, double param1,
+                const double *table, int tableLength, filterDesign design)
+{
+  cachedFilter *f;
+  int k;
+
+  initFilterCache();
+  for (k = 0; k < FILTER_CACHE_SIZE; k++)
+  {
+    f = filterCache[k];
+    if (f != NULL && f->type == type && f->length == length && f->order == order
+        && f->param[0] == param0 && f->param[1] == param1 && f->tableLength == tableLength
+        && (tableLength == 0 || memcmp(f->table, table, tableLength * sizeof(double)) == 0))
+      return f;
+  }
+
+  f = (cachedFilter *) calloc(1, sizeof(cachedFilter));
+  f->type = type;
+  f->length = length;
+  f->order = order;
+  f->param[0] = param0;
+  f->param[1] = param1;
+  f->tableLength = tableLength;
+  if (tableLength > 0)
+  {
+    f->table = (double *) malloc(tableLength * sizeof(double));
+    memcpy(f->table, table, tableLength * sizeof(double));
+  }
+  f->filt = (double *) malloc(order * sizeof(double));
+  design(f, getCachedPlan(order));
+
+  freeCachedFilter(filterCache[nextCachedFilter]);
+  filterCache[nextCachedFilter] = f;
+  nextCachedFilter = (nextCachedFilter + 1) % FILTER_CACHE_SIZE;
+  return f;
+}
+
+/* Filters the [len x numColumns] columns of pPtr with the real and even
+ * frequency response filt into qPtr. A real column stays real, so two
+ * columns are filtered by one complex FFT, the first as the real and the
+ * second as the imaginary part. */
+FILTER_CACHE_FUNCTION void
+filterColumns(double *qPtr, const double *pPtr, const double *filt,
+              const fftPlan *plan, int len, int numColumns)
+{
+  const int order = plan->n;
+  double *re, *im;
+  int pair, first, second, r;
+
+#ifdef _OPENMP
+  #pragma omp parallel private(re, im, first, second, r)
+#endif
+  {
+    re = (double *) malloc(order * sizeof(double));
+    im = (double *) malloc(order * sizeof(double));
+
+#ifdef _OPENMP
+    #pragma omp for schedule(static)
+#endif
+    for (pair = 0; pair < (numColumns + 1)/2; pair++)
+    {
+      first = 2*pair;
+      second = first + 1;
+
+      /* Zero padded columns, the second one may not exist */
+      for (r = 0; r < len; r++)
+      {
+        re[r] = pPtr[(size_t) first*len + r];
+        im[r] = (second < numColumns) ? pPtr[(size_t) second*len + r] : 0;
+      }
+      for (r = len; r < order; r++)
+      {
+        re[r] = 0;
+        im[r] = 0;
+      }
+
+      fftExecute(plan, re, im, 0);
+      for (r = 0; r < order; r++)
+      {
+        re[r] *= filt[r];
+        im[r] *= filt[r];
+      }
+      fftExecute(plan, re, im, 1);
+
+      /* Truncate the filtered columns */
+      for (r = 0; r < len; r++)
+      {
+        qPtr[(size_t) first*len + r] = re[r];
+        if (second < numColumns)
+          qPtr[(size_t) second*len + r] = im[r];
+      }
+    }
+
+    free(re);
+    free(im);
+  }
+}
+
+static void
+freeFilterCache(void)
+{
+  int k;
+
+  for (k = 0; k < FILTER_CACHE_SIZE; k++)
+  {
+    freeCachedFilter(filterCache[k]);
+    filterCache[k] = NULL;
+  }
+  for (k = 0; k < MAX_LOG2_LENGTH; k++)
+  {
+    fftDestroyPlan(planCache[k]);
+    planCache[k] = NULL;
+  }
+  nextCachedFilter = 0;
+  filterCacheInitialized = 0;
+}
+
+#endif /* FILTER_CACHE_H */
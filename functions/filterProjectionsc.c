@@ -0,0 +1,197 @@
+/*-------------------------------------------------------------------*/
+/* Filtering of parallel projections for the filtered backprojection */
+/* of inverseRadon.m, the filtering step of MATLAB's iradon.         */
+/*                                                                   */
+/* The filter is the band-limited ramp filter of iradon multiplied   */
+/* by a window and cropped at the frequency scaling d. The           */
+/* projections are zero padded to the length of the filter,          */
+/* max(64, 2^nextpow2(2*len)). Since the filter is real and even, a  */
+/* real projection stays real: two projections are filtered by one   */
+/* complex FFT, the first as the real and the second as the          */
+/* imaginary part. The pairs of projections are distributed over the */
+/* threads.                                                          */
+/*                                                                   */
+/* The filters and the FFT plans are cached in the MEX file, see     */
+/* filterCache.h, so later calls with the same length, filter and    */
+/* frequency scaling, e.g. for the next iteration or slice, only     */
+/* filter.                                                           */
+/*                                                                   */
+/* Usage:                                                            */
+/*   [Q, H] = filterProjectionsc(P, filter, d)                       */
+/*   P:      [len x numAngles x C] projections, C >= 1 sinograms     */
+/*   filter: 'ram-lak', 'shepp-logan', 'cosine', 'hamming', 'hann'   */
+/*           or 'none', case is ignored                              */
+/*   d:      frequency scaling, 0 < d <= 1                           */
+/*   Q:      [len x numAngles x C] filtered projections              */
+/*   H:      [order x 1] frequency response of the filter, optional  */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "mex.h"
+#include "mexInputAccess.h"
+#include "filterCache.h"
+
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+#define PI 3.14159265358979323846
+
+/* Windows of the ramp filter */
+enum { RAM_LAK, SHEPP_LOGAN, COSINE, HAMMING, HANN, NONE };
+
+/* Input Arguments */
+#define P      (prhs[0])
+#define FILTER (prhs[1])
+#define D      (prhs[2])
+
+/* Output Arguments */
+#define Q      (plhs[0])
+#define H      (plhs[1])
+
+static int getFilter(const mxArray *filter);
+static void designFilter(cachedFilter *f, const fftPlan *plan);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  const double *pPtr;         /* projections */
+  const cachedFilter *filter; /* frequency response of the filter */
+  const fftPlan *plan;        /* FFT of the filter length */
+  int window;                 /* window of the ramp filter */
+  double d;                   /* frequency scaling */
+  int len;                    /* length of the projections */
+  int numAngles;              /* number of projections of all sinograms */
+  int order;                  /* length of the filter */
+
+  /* Check validity of arguments */
+  if (nrhs != 3)
+  {
+      mexErrMsgTxt("Usage: [Q, H] = filterProjectionsc(P, filter, d)");
+  }
+  if (nlhs > 2)
+  {
+      mexErrMsgTxt("Too many output arguments to FILTERPROJECTIONSC");
+  }
+  if (mxIsSparse(P) || mxIsComplex(P) || !mxIsNumeric(P))
+  {
+      mexErrMsgTxt("Projections must be real and numeric");
+  }
+  window = getFilter(FILTER);
+  d = mxGetScalar(D);
+  if (!(d > 0 && d <= 1))
+  {
+      mexErrMsgTxt("Frequency scaling must be in (0, 1]");
+  }
+
+  len = mxGetM(P);
+  numAngles = mxGetN(P);
+  order = MAX(64, fftNextPow2(2*len));
+
+  plan = getCachedPlan(order);
+  filter = getCachedFilter(window, len, order, d, 0, NULL, 0, designFilter);
+
+  Q = mxCreateNumericArray(mxGetNumberOfDimensions(P), mxGetDimensions(P),
+                           mxDOUBLE_CLASS, mxREAL);
+  pPtr = mexInputDoubles(P);
+  if (window == NONE)
+    memcpy(mxGetPr(Q), pPtr, (size_t) len * numAngles * sizeof(double));
+  else
+    filterColumns(mxGetPr(Q), pPtr, filter->filt, plan, len, numAngles);
+  mexInputRelease(pPtr, P);
+
+  if (nlhs > 1)
+  {
+    H = mxCreateDoubleMatrix(order, 1, mxREAL);
+    memcpy(mxGetPr(H), filter->filt, order * sizeof(double));
+  }
+}
+
+/* Window named by the filter argument */
+static int
+getFilter(const mxArray *filter)
+{
+  static const char *names[] = { "ram-lak", "shepp-logan", "cosine", "hamming", "hann",
+                                 "none" };
+  char name[16];
+  int k;
+
+  if (!mxIsChar(filter) || mxGetString(filter, name, sizeof(name)) != 0)
+  {
+      mexErrMsgTxt("Filter must be 'ram-lak', 'shepp-logan', 'cosine', 'hamming', 'hann' or 'none'");
+  }
+  for (k = 0; name[k] != '\0'; k++)
+    name[k] = (char) tolower((unsigned char) name[k]);
+  for (k = 0; k <= NONE; k++)
+  {
+    if (strcmp(name, names[k]) == 0)
+      return k;
+  }
+  mexErrMsgTxt("Filter must be 'ram-lak', 'shepp-logan', 'cosine', 'hamming', 'hann' or 'none'");
+  return NONE;
+}
+
+/* The filter of iradon: the FFT of the band-limited ramp's impulse
+ * response (Kak and Slaney, eqn. 61, chapter 3), windowed and cropped
+ * at the frequency d*pi */
+static void
+designFilter(cachedFilter *f, const fftPlan *plan)
+{
+  const int order = plan->n;
+  const int window = f->type;
+  const double d = f->param[0];
+  double *filt = f->filt;
+  double *im;
+  double w;
+  int k;
+
+  if (window == NONE)
+  {
+    for (k = 0; k < order; k++)
+      filt[k] = 1;
+    return;
+  }
+
+  /* Impulse response, symmetric and 0 for even n > 0 */
+  im = (double *) mxCalloc(order, sizeof(double));
+  for (k = 0; k < order; k++)
+    filt[k] = 0;
+  filt[0] = 0.25;
+  for (k = 1; k <= order/2; k += 2)
+  {
+    filt[k] = -1 / ((PI*k)*(PI*k));
+    filt[order - k] = filt[k];
+  }
+  fftExecute(plan, filt, im, 0);
+  mxFree(im);
+
+  for (k = 0; k <= order/2; k++)
+  {
+    filt[k] = 2*filt[k];
+    w = 2*PI*k/order;
+    if (k > 0)
+    {
+      switch (window)
+      {
+        case SHEPP_LOGAN:
+          filt[k] *= sin(w/(2*d)) / (w/(2*d));
+          break;
+        case COSINE:
+          filt[k] *= cos(w/(2*d));
+          break;
+        case HAMMING:
+          filt[k] *= .54 + .46*cos(w/d);
+          break;
+        case HANN:
+          filt[k] *= (1 + cos(w/d)) / 2;
+          break;
+      }
+    }
+    if (w > PI*d)
+      filt[k] = 0;
+  }
+  for (k = 1; k < order/2; k++)
+    filt[order - k] = filt[k];
+}
@@ -0,0 +1,504 @@
+/*-------------------------------------------------------------------*/
+/* Direct Fourier reconstruction of parallel projections by          */
+/* gridding, an alternative to the filtered backprojection of        */
+/* inverseRadon.m with the same image axes, projection center,       */
+/* filters and scaling.                                              */
+/*                                                                   */
+/* By the Fourier slice theorem, the FFT of the projection at the    */
+/* angle theta is the 2D Fourier transform of the image along the    */
+/* line (omega*cos(theta), omega*sin(theta)). The samples are        */
+/* weighted by the ramp |omega|, the window of the filter and the    */
+/* angular spacing, the density of the polar grid. They are          */
+/* convolved onto a Cartesian grid, oversampled by at least 2, with  */
+/* a Kaiser-Bessel kernel of KERNEL_WIDTH grid points. An inverse 2D */
+/* FFT and the division by the Fourier transform of the kernel       */
+/* (deapodization) give the image.                                   */
+/*                                                                   */
+/* The images are real, so two sinograms are reconstructed together  */
+/* as the real and imaginary part of one complex image, at the cost  */
+/* of one. The projections are transformed by angle and the 2D FFT   */
+/* by rows and columns in parallel. The gridding is parallel over    */
+/* bands of grid rows, every thread owns one band.                   */
+/*                                                                   */
+/* Usage:                                                            */
+/*   img = griddingReconstructc(P, theta, N, filter, d)              */
+/*   P:      [len x numAngles x C] projections of C sinograms        */
+/*   theta:  projection angles in radians                            */
+/*   N:      size of the output image                                */
+/*   filter: 'ram-lak', 'shepp-logan', 'cosine', 'hamming' or        */
+/*           'hann', case is ignored                                 */
+/*   d:      frequency scaling, 0 < d <= 1                           */
+/*   img:    [N x N x C] reconstructed images, scaled as iradon      */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "mex.h"
+#include "mexInputAccess.h"
+#include "fftRadix2.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+#define PI 3.14159265358979323846
+
+/* Width of the Kaiser-Bessel kernel in grid points */
+#define KERNEL_WIDTH 4
+
+/* Samples of the kernel table per grid point */
+#define TABLE_DENSITY 512
+
+/* Length of the kernel table, the grid points next to the kernel are 0 */
+#define TABLE_LENGTH ((KERNEL_WIDTH/2 + 1)*TABLE_DENSITY + 2)
+
+/* Windows of the ramp filter */
+enum { RAM_LAK, SHEPP_LOGAN, COSINE, HAMMING, HANN };
+
+/* Input Arguments */
+#define P      (prhs[0])
+#define THETA  (prhs[1])
+#define N_SIZE (prhs[2])
+#define FILTER (prhs[3])
+#define D      (prhs[4])
+
+/* Output Arguments */
+#define IMG    (plhs[0])
+
+static int getFilter(const mxArray *filter);
+static double besselI0(double x);
+static void createKernel(double *kernel, double *deapodization, int gridSize, int N,
+                         double xleft);
+static void angleWeights(double *weights, const double *theta, int numAngles);
+static void transformProjections(double *specRe, double *specIm, const double *pPtr,
+                                 const double *second, const double *radial,
+                                 const double *angular, const fftPlan *plan, int len,
+                                 int numAngles);
+static void grid(double *gridRe, double *gridIm, const double *specRe,
+                 const double *specIm, const double *cosine, const double *sine,
+                 const double *kernel, int numAngles, int specLength, int gridSize);
+static void inverseFFT2(double *gridRe, double *gridIm, const fftPlan *plan);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  const double *pPtr;         /* projections */
+  const double *thetaPtr;     /* projection angles */
+  double *imgPtr;             /* reconstructed images */
+  double *cosine, *sine;      /* trigonometric values of the angles */
+  double *angular;            /* angular spacing of every angle */
+  double *radial;             /* ramp, window and spacing of every frequency */
+  double *specRe, *specIm;    /* weighted spectra of the projections */
+  double *gridRe, *gridIm;    /* Cartesian frequency grid, then the images */
+  double *kernel;             /* Kaiser-Bessel kernel table */
+  double *deapodization;      /* Fourier transform of the kernel at the pixels */
+  fftPlan *specPlan, *gridPlan;
+  mwSize dims[3];
+  int window;                 /* window of the ramp filter */
+  double d;                   /* frequency scaling */
+  double omega, w, scale, value;
+  int len, numAngles, numChannels, N;
+  int specLength;             /* length of the transformed projections */
+  int gridSize;               /* size of the frequency grid */
+  int c, j, k, x, y, px, py;
+
+  /* Check validity of arguments */
+  if (nrhs != 5)
+  {
+    mexErrMsgTxt("Usage: img = griddingReconstructc(P, theta, N, filter, d)");
+  }
+  if (nlhs > 1)
+  {
+    mexErrMsgTxt("Too many output arguments to GRIDDINGRECONSTRUCTC");
+  }
+  if (mxIsSparse(P) || mxIsComplex(P) || !mxIsNumeric(P) || !mxIsNumeric(THETA))
+  {
+    mexErrMsgTxt("Projections and angles must be real and numeric.");
+  }
+  window = getFilter(FILTER);
+  d = mxGetScalar(D);
+  if (!(d > 0 && d <= 1))
+  {
+    mexErrMsgTxt("Frequency scaling must be in (0, 1]");
+  }
+
+  len = mxGetM(P);
+  numAngles = mxGetNumberOfElements(THETA);
+  N = (int) mxGetScalar(N_SIZE);
+  numChannels = (mxGetNumberOfDimensions(P) > 2) ? (int) mxGetDimensions(P)[2] : 1;
+  if (mxGetNumberOfDimensions(P) > 3 || mxGetN(P) != (size_t) numAngles*numChannels)
+  {
+    mexErrMsgTxt("P must have one column per angle.");
+  }
+  if (N < 0)
+  {
+    mexErrMsgTxt("N must be positive.");
+  }
+
+  dims[0] = N;
+  dims[1] = N;
+  dims[2] = numChannels;
+  IMG = mxCreateNumericArray(numChannels > 1 ? 3 : 2, dims, mxDOUBLE_CLASS, mxREAL);
+  if (N == 0 || numAngles == 0 || len == 0)
+    return;
+  imgPtr = mxGetPr(IMG);
+
+  /* The grid is oversampled by at least 2, the radial spacing of the
+   * spectra is at most one grid point */
+  gridSize = fftNextPow2(2*N);
+  specLength = MAX(gridSize, fftNextPow2(len));
+  specPlan = fftCreatePlan(specLength);
+  gridPlan = fftCreatePlan(gridSize);
+
+  thetaPtr = mexInputDoubles(THETA);
+  cosine = (double *) mxMalloc(numAngles * sizeof(double));
+  sine = (double *) mxMalloc(numAngles * sizeof(double));
+  angular = (double *) mxMalloc(numAngles * sizeof(double));
+  for (k = 0; k < numAngles; k++)
+  {
+    cosine[k] = cos(thetaPtr[k]);
+    sine[k] = sin(thetaPtr[k]);
+  }
+  angleWeights(angular, thetaPtr, numAngles);
+  mexInputRelease(thetaPtr, THETA);
+
+  /* |omega| d(omega), windowed and cropped as the filters of iradon. The
+   * sample at omega = 0 stands for the disk of radius d(omega)/2, shared
+   * by all angles. */
+  radial = (double *) mxMalloc(specLength * sizeof(double));
+  w = 2*PI/specLength;
+  for (j = 0; j < specLength; j++)
+  {
+    omega = w*(j <= specLength/2 ? j : j - specLength);
+    radial[j] = (j == 0) ? w*w/4 : fabs(omega)*w;
+    switch (window)
+    {
+      case SHEPP_LOGAN:
+        if (j > 0)
+          radial[j] *= sin(omega/(2*d)) / (omega/(2*d));
+        break;
+      case COSINE:
+        radial[j] *= cos(omega/(2*d));
+        break;
+      case HAMMING:
+        radial[j] *= .54 + .46*cos(omega/d);
+        break;
+      case HANN:
+        radial[j] *= (1 + cos(omega/d)) / 2;
+        break;
+    }
+    if (fabs(omega) > PI*d)
+      radial[j] = 0;
+  }
+
+  kernel = (double *) mxMalloc(TABLE_LENGTH * sizeof(double));
+  deapodization = (double *) mxMalloc(N * sizeof(double));
+  createKernel(kernel, deapodization, gridSize, N, -floor((N - 1)/2.0));
+
+  specRe = (double *) mxMalloc((size_t) specLength * numAngles * sizeof(double));
+  specIm = (double *) mxMalloc((size_t) specLength * numAngles * sizeof(double));
+  gridRe = (double *) mxMalloc((size_t) gridSize * gridSize * sizeof(double));
+  gridIm = (double *) mxMalloc((size_t) gridSize * gridSize * sizeof(double));
+
+  /* The inverse FFT scales by 1/gridSize^2, the image by 1/(4*pi^2) */
+  scale = (double) gridSize * gridSize / (4*PI*PI);
+
+  pPtr = mexInputDoubles(P);
+  for (c = 0; c < numChannels; c += 2)
+  {
+    transformProjections(specRe, specIm, pPtr + (size_t) c*numAngles*len,
+                         (c + 1 < numChannels) ? pPtr + (size_t) (c + 1)*numAngles*len : NULL,
+                         radial, angular, specPlan, len, numAngles);
+    grid(gridRe, gridIm, specRe, specIm, cosine, sine, kernel, numAngles, specLength,
+         gridSize);
+    inverseFFT2(gridRe, gridIm, gridPlan);
+
+    /* Pixel (x, y) of the image is at grid point (x mod gridSize, y mod gridSize) */
+    for (x = 0; x < N; x++)
+    {
+      px = (int) (-floor((N - 1)/2.0)) + x;
+      px = (px + gridSize) % gridSize;
+      for (y = 0; y < N; y++)
+      {
+        py = (int) floor((N - 1)/2.0) - y;
+        py = (py + gridSize) % gridSize;
+        value = scale / (deapodization[x]*deapodization[y]);
+        imgPtr[((size_t) c*N + x)*N + y] = gridRe[(size_t) py*gridSize + px]*value;
+        if (c + 1 < numChannels)
+          imgPtr[((size_t) (c + 1)*N + x)*N + y] = gridIm[(size_t) py*gridSize + px]*value;
+      }
+    }
+  }
+  mexInputRelease(pPtr, P);
+
+  mxFree(cosine);
+  mxFree(sine);
+  mxFree(angular);
+  mxFree(radial);
+  mxFree(kernel);
+  mxFree(deapodization);
+  mxFree(specRe);
+  mxFree(specIm);
+  mxFree(gridRe);
+  mxFree(gridIm);
+  fftDestroyPlan(specPlan);
+  fftDestroyPlan(gridPlan);
+}
+
+/* Window named by the filter argument */
+static int
+getFilter(const mxArray *filter)
+{
+  static const char *names[] = { "ram-lak", "shepp-logan", "cosine", "hamming", "hann" };
+  char name[16];
+  int k;
+
+  if (!mxIsChar(filter) || mxGetString(filter, name, sizeof(name)) != 0)
+  {
+    mexErrMsgTxt("Filter must be 'ram-lak', 'shepp-logan', 'cosine', 'hamming' or 'hann'");
+  }
+  for (k = 0; name[k] != '\0'; k++)
+    name[k] = (char) tolower((unsigned char) name[k]);
+  for (k = 0; k <= HANN; k++)
+  {
+    if (strcmp(name, names[k]) == 0)
+      return k;
+  }
+  mexErrMsgTxt("Filter must be 'ram-lak', 'shepp-logan', 'cosine', 'hamming' or 'hann'");
+  return HANN;
+}
+
+/* Modified Bessel function of the first kind of order 0, power series */
+static double
+besselI0(double x)
+{
+  double sum = 1, term = 1;
+  int k;
+
+  for (k = 1; k < 50 && term > 1e-17*sum; k++)
+  {
+    term *= (x/(2*k))*(x/(2*k));
+    sum += term;
+  }
+  return sum;
+}
+
+/* Table of the Kaiser-Bessel kernel at the distances i/TABLE_DENSITY from
+ * its center, and its Fourier transform at the x-coordinates of the
+ * pixels, xleft + x. The transform is even, so it is also the transform
+ * at the y-coordinates -(xleft + y) of the rows. The shape parameter is
+ * that of Beatty et al., IEEE Trans Med Imaging 24(6), 2005, for the
+ * oversampling 2. */
+static void
+createKernel(double *kernel, double *deapodization, int gridSize, int N, double xleft)
+{
+  const double halfWidth = KERNEL_WIDTH/2.0;
+  const double beta = PI*sqrt(KERNEL_WIDTH*KERNEL_WIDTH/4.0*1.5*1.5 - 0.8);
+  double u, sum;
+  int i, x;
+
+  for (i = 0; i < TABLE_LENGTH; i++)
+  {
+    u = (double) i/TABLE_DENSITY;
+    kernel[i] = (u < halfWidth) ? besselI0(beta*sqrt(1 - (u/halfWidth)*(u/halfWidth))) : 0;
+  }
+
+  /* Trapezoidal rule of the integral of
+   * kernel(u)*cos(2*pi*u*x/gridSize) */
+  for (x = 0; x < N; x++)
+  {
+    sum = kernel[0]/2;
+    for (i = 1; i < TABLE_LENGTH; i++)
+      sum += kernel[i]*cos(2*PI*i/TABLE_DENSITY*(xleft + x)/gridSize);
+    deapodization[x] = 2*sum/TABLE_DENSITY;
+  }
+}
+
+/* Angular spacing of every angle: half the distance between its
+ * neighbours, the angles are periodic in pi */
+static void
+angleWeights(double *weights, const double *theta, int numAngles)
+{
+  double *sorted;
+  int *order;
+  double prev, next, t;
+  int k, i, m;
+
+  if (numAngles == 1)
+  {
+    weights[0] = PI;
+    return;
+  }
+
+  /* Sort the angles reduced to [0, pi) by insertion */
+  sorted = (double *) mxMalloc(numAngles * sizeof(double));
+  order = (int *) mxMalloc(numAngles * sizeof(int));
+  for (k = 0; k < numAngles; k++)
+  {
+    t = fmod(theta[k], PI);
+    if (t < 0)
+      t += PI;
+    for (i = k; i > 0 && sorted[i - 1] > t; i--)
+    {
+      sorted[i] = sorted[i - 1];
+      order[i] = order[i - 1];
+    }
+    sorted[i] = t;
+    order[i] = k;
+  }
+  for (m = 0; m < numAngles; m++)
+  {
+    prev = (m > 0) ? sorted[m - 1] : sorted[numAngles - 1] - PI;
+    next = (m < numAngles - 1) ? sorted[m + 1] : sorted[0] + PI;
+    weights[order[m]] = (next - prev)/2;
+  }
+  mxFree(sorted);
+  mxFree(order);
+}
+
+/* Weighted spectra of the projections, of the second sinogram times i if
+ * it is given. Sample r of a projection is at t = r - ceil(len/2) + 1 and
+ * is stored at t modulo specLength, so the phase is relative to t = 0. */
+static void
+transformProjections(double *specRe, double *specIm, const double *pPtr,
+                     const double *second, const double *radial, const double *angular,
+                     const fftPlan *plan, int len, int numAngles)
+{
+  const int specLength = plan->n;
+  const int center = (len + 1)/2 - 1;
+  double *re, *im;
+  int k, r, i;
+
+  #pragma omp parallel for private(re, im, r, i)
+  for (k = 0; k < numAngles; k++)
+  {
+    re = specRe + (size_t) k*specLength;
+    im = specIm + (size_t) k*specLength;
+    memset(re, 0, specLength * sizeof(double));
+    memset(im, 0, specLength * sizeof(double));
+    for (r = 0; r < len; r++)
+    {
+      i = (r - center + specLength) % specLength;
+      re[i] = pPtr[(size_t) k*len + r];
+      if (second != NULL)
+        im[i] = second[(size_t) k*len + r];
+    }
+    fftExecute(plan, re, im, 0);
+    for (i = 0; i < specLength; i++)
+    {
+      re[i] *= radial[i]*angular[k];
+      im[i] *= radial[i]*angular[k];
+    }
+  }
+}
+
+/* Convolves the spectra onto the grid. Grid point (a, b) at row b and
+ * column a is the frequency 2*pi*(a, b)/gridSize, modulo gridSize. The
+ * threads own bands of rows and skip the samples outside their band. */
+static void
+grid(double *gridRe, double *gridIm, const double *specRe, const double *specIm,
+     const double *cosine, const double *sine, const double *kernel, int numAngles,
+     int specLength, int gridSize)
+{
+  const double halfWidth = KERNEL_WIDTH/2.0;
+  const double toGrid = (double) gridSize/specLength;  /* grid points per sample */
+
+  memset(gridRe, 0, (size_t) gridSize * gridSize * sizeof(double));
+  memset(gridIm, 0, (size_t) gridSize * gridSize * sizeof(double));
+
+  #pragma omp parallel
+  {
+    int numThreads = 1, thread = 0;
+    int rowFirst, rowLast;    /* band of rows of this thread */
+    int k, j, a, b, aw, bw, a0, b0;
+    double u, v, re, im, wv, wuv;
+    double weightU[KERNEL_WIDTH + 1];
+    double *rowRe, *rowIm;
+
+#ifdef _OPENMP
+    numThreads = omp_get_num_threads();
+    thread = omp_get_thread_num();
+#endif
+    rowFirst = (int) ((long long) gridSize*thread/numThreads);
+    rowLast = (int) ((long long) gridSize*(thread + 1)/numThreads);
+
+    for (k = 0; k < numAngles; k++)
+    {
+      for (j = 0; j < specLength; j++)
+      {
+        re = specRe[(size_t) k*specLength + j];
+        im = specIm[(size_t) k*specLength + j];
+        if (re == 0 && im == 0)
+          continue;
+        u = (j <= specLength/2 ? j : j - specLength)*toGrid;
+        v = u*sine[k];
+        u *= cosine[k];
+        a0 = (int) ceil(u - halfWidth);
+        b0 = (int) ceil(v - halfWidth);
+
+        for (a = 0; a <= KERNEL_WIDTH; a++)
+          weightU[a] = kernel[(int) (fabs(a0 + a - u)*TABLE_DENSITY + 0.5)];
+
+        for (b = b0; b <= b0 + KERNEL_WIDTH; b++)
+        {
+          bw = (b + gridSize) % gridSize;
+          if (bw < rowFirst || bw >= rowLast)
+            continue;
+          wv = kernel[(int) (fabs(b - v)*TABLE_DENSITY + 0.5)];
+          rowRe = gridRe + (size_t) bw*gridSize;
+          rowIm = gridIm + (size_t) bw*gridSize;
+          for (a = 0; a <= KERNEL_WIDTH; a++)
+          {
+            aw = (a0 + a + gridSize) % gridSize;
+            wuv = weightU[a]*wv;
+            rowRe[aw] += wuv*re;
+            rowIm[aw] += wuv*im;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* In-place inverse 2D FFT of a square grid, rows and then columns */
+static void
+inverseFFT2(double *gridRe, double *gridIm, const fftPlan *plan)
+{
+  const int n = plan->n;
+  int i, j;
+
+  #pragma omp parallel for
+  for (i = 0; i < n; i++)
+    fftExecute(plan, gridRe + (size_t) i*n, gridIm + (size_t) i*n, 1);
+
+  #pragma omp parallel private(j)
+  {
+    double *re = (double *) malloc(n * sizeof(double));
+    double *im = (double *) malloc(n * sizeof(double));
+
+    #pragma omp for
+    for (i = 0; i < n; i++)
+    {
+      for (j = 0; j < n; j++)
+      {
+        re[j] = gridRe[(size_t) j*n + i];
+        im[j] = gridIm[(size_t) j*n + i];
+      }
+      fftExecute(plan, re, im, 1);
+      for (j = 0; j < n; j++)
+      {
+        gridRe[(size_t) j*n + i] = re[j];
+        gridIm[(size_t) j*n + i] = im[j];
+      }
+    }
+
+    free(re);
+    free(im);
+  }
+}
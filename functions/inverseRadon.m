@@ -0,0 +1,70 @@
+function [img, H] = inverseRadon(p, degVec, interpolation, filter, frequencyScaling, N,...
+    accuracy)
+  % INVERSERADON Filtered backprojection of parallel projections.
+  %
+  % [img, H] = inverseRadon(p, degVec, interpolation, filter,
+  % frequencyScaling, N) returns the same image as
+  % iradon(p, degVec, interpolation, filter, frequencyScaling, N).
+  % The C and OpenMP codes filter the projections with filterProjectionsc
+  % and backproject them with backprojectc, otherwise iradon is called.
+  %
+  % A stack of sinograms of the same geometry, e.g. of the low and the
+  % high energy, is reconstructed to a stack of images. backprojectc
+  % backprojects two sinograms in one sweep.
+  %
+  % [img, H] = inverseRadon(..., accuracy) uses the hierarchical
+  % backprojection of backprojectHierc, an O(N^2 log N) approximation
+  % for large images. accuracy is the largest displacement of a ray per
+  % summation of angles in detector elements, e.g. 0.25. See
+  % compareBackprojection for its error.
+  %
+  % Input:
+  % p:                [len x numel(degVec) x k] parallel projections of
+  %                   k sinograms
+  % degVec:           projection angles in degrees
+  % interpolation:    'nearest' or 'linear', other interpolations of
+  %                   iradon are computed by iradon
+  % filter:           'Ram-Lak', 'Shepp-Logan', 'Cosine', 'Hamming',
+  %                   'Hann' or 'None'
+  % frequencyScaling: scaling of the frequency axis, 0 < d <= 1
+  % N:                size of the N x N reconstructed image
+  % accuracy:         optional, accuracy of the hierarchical backprojection
+  %
+  % Output:
+  % img:              [N x N x k] reconstructed images
+  % H:                frequency response of the filter
+  %
+  % See also: iradon, filterProjectionsc, backprojectc, backprojectHierc
+
+  % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+  % The OpenCL code uses the OpenMP backprojection.
+  global useCode
+  if isempty(useCode) || useCode == 0 ...
+      || ~any(strcmpi(interpolation, {'nearest', 'linear'}))
+    img = zeros(N, N, size(p, 3));
+    for k = 1:size(p, 3)
+      [img(:, :, k), H] = iradon(p(:, :, k), degVec, interpolation, filter,...
+        frequencyScaling, N);
+    end
+    return;
+  end
+
+  [p, H] = filterProjectionsc(double(p), filter, frequencyScaling);
+  theta = pi*double(degVec)/180;
+  interp = double(strcmpi(interpolation, 'linear'));
+  if nargin > 6 && ~isempty(accuracy)
+    img = zeros(N, N, size(p, 3));
+    for k = 1:size(p, 3)
+      img(:, :, k) = backprojectHierc(p(:, :, k), theta, N, interp, accuracy);
+    end
+  elseif size(p, 3) <= 2
+    img = backprojectc(p, theta, N, interp);
+  else
+    img = zeros(N, N, size(p, 3));
+    for k = 1:2:size(p, 3)  % two sinograms per sweep
+      pair = k:min(k + 1, size(p, 3));
+      img(:, :, pair) = backprojectc(p(:, :, pair), theta, N, interp);
+    end
+  end
+  img = img*pi/(2*length(degVec));
+end
@@ -0,0 +1,20 @@
+function [index, pixels] = maskIndices(masks)
+  % MASKINDICES Sorted linear pixel indices of tissue masks.
+  %
+  % The tissue masks usually cover a small part of the image. The index
+  % lists let decomposeTissues and sinogramJExec visit only the pixels of
+  % the tissues instead of scanning the full masks.
+  %
+  % Input:
+  % masks:  cell of logical images
+  %
+  % Output:
+  % index:  cell of column vectors, index{k} = find(masks{k})
+  % pixels: sorted union of the index lists
+
+  index = cell(size(masks));
+  for k = 1:numel(masks)
+    index{k} = find(masks{k});
+  end
+  pixels = unique(vertcat(index{:}, zeros(0, 1)));
+end
@@ -0,0 +1,120 @@
+/*-------------------------------------------------------------------*/
+/* Read-only access to the inputs of MEX functions.                  */
+/*                                                                   */
+/* The data of an input of the requested type is used in place, as a */
+/* const view of MATLAB's buffer. Inputs of other numeric or logical */
+/* types are converted into a temporary buffer, which mexInputRelease */
+/* frees. Views of inputs of the requested type are never copied, so */
+/* kernels must not write through them.                              */
+/*                                                                   */
+/*   const double *x = mexInputDoubles(X);                           */
+/*   const mxLogical *mask = mexInputLogicals(MASK);                 */
+/*   ...                                                             */
+/*   mexInputRelease(x, X);                                          */
+/*   mexInputRelease(mask, MASK);                                    */
+/*   mexInputReport("MD2c");                                         */
+/*                                                                   */
+/* If the MEX file is compiled with -DMEX_INPUT_DEBUG, the bytes     */
+/* copied or converted are counted and mexInputReport prints and     */
+/* resets the count. Otherwise mexInputReport does nothing.          */
+/*-------------------------------------------------------------------*/
+#ifndef MEX_INPUT_ACCESS_H
+#define MEX_INPUT_ACCESS_H
+
+#include "mex.h"
+
+#if defined(__GNUC__)
+#define MEX_INPUT_FUNCTION static __attribute__((unused))
+#else
+#define MEX_INPUT_FUNCTION static
+#endif
+
+#ifdef MEX_INPUT_DEBUG
+static size_t mexInputBytesCopied = 0;  /* bytes copied since the last report */
+#define MEX_INPUT_COUNT(bytes) (mexInputBytesCopied += (bytes))
+#else
+#define MEX_INPUT_COUNT(bytes) ((void) 0)
+#endif
+
+/* Element k of a numeric or logical input converted to double */
+MEX_INPUT_FUNCTION double
+mexInputElement(const mxArray *a, size_t k)
+{
+  const void *data = mxGetData(a);
+
+  switch (mxGetClassID(a))
+  {
+    case mxDOUBLE_CLASS:  return ((const double *) data)[k];
+    case mxSINGLE_CLASS:  return ((const float *) data)[k];
+    case mxLOGICAL_CLASS: return ((const mxLogical *) data)[k];
+    case mxINT8_CLASS:    return ((const signed char *) data)[k];
+    case mxUINT8_CLASS:   return ((const unsigned char *) data)[k];
+    case mxINT16_CLASS:   return ((const short *) data)[k];
+    case mxUINT16_CLASS:  return ((const unsigned short *) data)[k];
+    case mxINT32_CLASS:   return ((const int *) data)[k];
+    case mxUINT32_CLASS:  return ((const unsigned int *) data)[k];
+    case mxINT64_CLASS:   return (double) ((const long long *) data)[k];
+    case mxUINT64_CLASS:  return (double) ((const unsigned long long *) data)[k];
+    default:
+      mexErrMsgTxt("Input must be numeric or logical.");
+  }
+  return 0;
+}
+
+/* Data of an input as doubles, converted only if it is not double */
+MEX_INPUT_FUNCTION const double *
+mexInputDoubles(const mxArray *a)
+{
+  size_t n, k;
+  double *copy;
+
+  if (mxIsDouble(a))
+    return mxGetPr(a);
+
+  n = mxGetNumberOfElements(a);
+  copy = (double *) mxMalloc((n > 0 ? n : 1) * sizeof(double));
+  for (k = 0; k < n; k++)
+    copy[k] = mexInputElement(a, k);
+  MEX_INPUT_COUNT(n * sizeof(double));
+  return copy;
+}
+
+/* Data of an input as logicals, converted (nonzero) only if it is not logical */
+MEX_INPUT_FUNCTION const mxLogical *
+mexInputLogicals(const mxArray *a)
+{
+  size_t n, k;
+  mxLogical *copy;
+
+  if (mxIsLogical(a))
+    return mxGetLogicals(a);
+
+  n = mxGetNumberOfElements(a);
+  copy = (mxLogical *) mxMalloc((n > 0 ? n : 1) * sizeof(mxLogical));
+  for (k = 0; k < n; k++)
+    copy[k] = (mexInputElement(a, k) != 0);
+  MEX_INPUT_COUNT(n * sizeof(mxLogical));
+  return copy;
+}
+
+/* Frees a view returned for the input a if it had to be converted */
+MEX_INPUT_FUNCTION void
+mexInputRelease(const void *view, const mxArray *a)
+{
+  if (view != NULL && view != mxGetData(a))
+    mxFree((void *) view);
+}
+
+/* Prints and resets the number of bytes copied (MEX_INPUT_DEBUG only) */
+MEX_INPUT_FUNCTION void
+mexInputReport(const char *name)
+{
+#ifdef MEX_INPUT_DEBUG
+  mexPrintf("%s: %lu bytes of input copied\n", name, (unsigned long) mexInputBytesCopied);
+  mexInputBytesCopied = 0;
+#else
+  (void) name;
+#endif
+}
+
+#endif /* MEX_INPUT_ACCESS_H */
@@ -0,0 +1,268 @@
+/*-------------------------------------------------------------------*/
+/* Frequency domain filtering of the columns of a sinogram, the C    */
+/* code of ramp.m, rampwindow.m and rampwindowMtf.m.                 */
+/*                                                                   */
+/* The frequency response of a filter depends only on the length of  */
+/* the columns, the filter type and its parameters. The filters and  */
+/* the FFT plans are therefore cached in the MEX file, see           */
+/* filterCache.h, and reused by later calls, e.g. for the next       */
+/* slice, until the MEX file is cleared. The filters are real and    */
+/* even, so two columns are filtered by one complex FFT. The pairs   */
+/* of columns are distributed over the threads.                      */
+/*                                                                   */
+/* The columns are zero padded to the power of 2 FFT length          */
+/* 2*2^nextpow2(len) for 'ramp', as in ramp.m, and 2^nextpow2(2*len) */
+/* otherwise. rampwindow.m and rampwindowMtf.m sample the windows at */
+/* the 2*len frequencies of their FFT length 2*len. The windows are  */
+/* designed at these frequencies and resampled to the FFT length     */
+/* through their impulse response, which is exact for columns of     */
+/* length len, so all filters match the MATLAB code to rounding.     */
+/*                                                                   */
+/* Usage:                                                            */
+/*   q = projectionFilterc(p, 'ramp')          as ramp(p)            */
+/*   q = projectionFilterc(p, 'ramp', dalfa)   as ramp(p, dalfa)     */
+/*   q = projectionFilterc(p, 'cosine', n)     cos^n window, as      */
+/*                                             rampwindow(p, rVec,   */
+/*                                             'Cosine', n)          */
+/*   q = projectionFilterc(p, 'mtf', n, MTF, delta)                  */
+/*                                             MTF window divided by */
+/*                                             cos^n, as             */
+/*                                             rampwindowMtf         */
+/*   p:     [len x numColumns] projections                           */
+/*   MTF:   [K x 2] table of the MTF, frequencies in ascending order */
+/*          in the first column, see mtfWindow.m                     */
+/*   delta: distance between the detector elements                   */
+/*   q:     [len x numColumns] filtered projections                  */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "mex.h"
+#include "mexInputAccess.h"
+#include "filterCache.h"
+
+#define PI 3.14159265358979323846
+
+/* Filter types */
+enum { RAMP, COSINE, MTF };
+
+/* Input Arguments */
+#define P      (prhs[0])
+#define TYPE   (prhs[1])
+#define PARAM  (prhs[2])
+#define MTF_IN (prhs[3])
+#define DELTA  (prhs[4])
+
+/* Output Arguments */
+#define Q      (plhs[0])
+
+static int getType(const mxArray *type);
+static void designFilter(cachedFilter *f, const fftPlan *plan);
+static double mtfValue(double x, const double *mtf, int mtfLength);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  const double *pPtr;         /* projections */
+  const double *mtf = NULL;   /* MTF table */
+  const cachedFilter *filter; /* frequency response */
+  const fftPlan *plan;        /* FFT of the filter length */
+  int type;                   /* filter type */
+  double param = 0;           /* dalfa or n */
+  double delta = 0;           /* detector spacing */
+  int mtfLength = 0;          /* number of elements of the MTF table */
+  int len;                    /* length of the columns */
+  int numColumns;             /* number of columns */
+  int order;                  /* FFT length */
+
+  /* Check validity of arguments */
+  if (nrhs < 2)
+  {
+      mexErrMsgTxt("Usage: q = projectionFilterc(p, type, ...)");
+  }
+  if (nlhs > 1)
+  {
+      mexErrMsgTxt("Too many output arguments to PROJECTIONFILTERC");
+  }
+  if (mxIsSparse(P) || mxIsComplex(P) || !mxIsNumeric(P))
+  {
+      mexErrMsgTxt("Projections must be real and numeric");
+  }
+  if (mxGetNumberOfDimensions(P) > 2)
+  {
+      mexErrMsgTxt("Projections must be a matrix");
+  }
+  type = getType(TYPE);
+  if ((type == RAMP && nrhs > 3) || (type == COSINE && nrhs != 3)
+      || (type == MTF && nrhs != 5))
+  {
+      mexErrMsgTxt("Usage: q = projectionFilterc(p, 'ramp', dalfa), "
+                   "projectionFilterc(p, 'cosine', n) or projectionFilterc(p, 'mtf', n, MTF, delta)");
+  }
+  if (nrhs > 2)
+    param = mxGetScalar(PARAM);
+  if (type == MTF)
+  {
+    if (!mxIsDouble(MTF_IN) || mxIsComplex(MTF_IN) || mxGetN(MTF_IN) != 2
+        || mxGetM(MTF_IN) < 1)
+    {
+        mexErrMsgTxt("MTF must be a real [K x 2] table");
+    }
+    mtf = mxGetPr(MTF_IN);
+    mtfLength = mxGetNumberOfElements(MTF_IN);
+    delta = mxGetScalar(DELTA);
+    if (!(delta > 0))
+    {
+        mexErrMsgTxt("delta must be positive");
+    }
+  }
+
+  len = mxGetM(P);
+  numColumns = mxGetN(P);
+  order = (type == RAMP) ? 2*fftNextPow2(len) : fftNextPow2(2*len);
+
+  plan = getCachedPlan(order);
+  filter = getCachedFilter(type, len, order, param, delta, mtf, mtfLength, designFilter);
+
+  Q = mxCreateDoubleMatrix(len, numColumns, mxREAL);
+  pPtr = mexInputDoubles(P);
+  filterColumns(mxGetPr(Q), pPtr, filter->filt, plan, len, numColumns);
+  mexInputRelease(pPtr, P);
+}
+
+/* Filter type named by the type argument */
+static int
+getType(const mxArray *type)
+{
+  static const char *names[] = { "ramp", "cosine", "mtf" };
+  char name[16];
+  int k;
+
+  if (!mxIsChar(type) || mxGetString(type, name, sizeof(name)) != 0)
+  {
+      mexErrMsgTxt("Filter type must be 'ramp', 'cosine' or 'mtf'");
+  }
+  for (k = 0; name[k] != '\0'; k++)
+    name[k] = (char) tolower((unsigned char) name[k]);
+  for (k = 0; k <= MTF; k++)
+  {
+    if (strcmp(name, names[k]) == 0)
+      return k;
+  }
+  mexErrMsgTxt("Filter type must be 'ramp', 'cosine' or 'mtf'");
+  return RAMP;
+}
+
+/* Frequency response of the filter at the frequencies k/order (cycles
+ * per element), symmetric around order/2 */
+static void
+designFilter(cachedFilter *f, const fftPlan *plan)
+{
+  const int order = f->order;
+  const int half = order/2;
+  const int len = f->length;
+  const double param = f->param[0];
+  const double delta = f->param[1];
+  double *filt = f->filt;
+  double *im, *window, *cosine;
+  double nu, w;
+  int k, m;
+
+  if (f->type == RAMP)
+  {
+    /* Impulse response of ramp.m, 0 for even distances, and the
+     * low pass weighting cos^2 */
+    im = (double *) calloc(order, sizeof(double));
+    for (k = 0; k < order; k++)
+      filt[k] = 0;
+    filt[0] = (param == 0) ? 0.25 : 1/(8*param*param);
+    for (k = 1; k < half; k += 2)
+    {
+      if (param == 0)
+        filt[k] = -1/(PI*PI*k*k);
+      else
+        filt[k] = -1/(2*PI*PI*sin(k*param)*sin(k*param));
+      filt[order - k] = filt[k];
+    }
+    fftExecute(plan, filt, im, 0);
+    free(im);
+
+    for (k = 0; k <= half; k++)
+    {
+      w = cos(PI*k/order);
+      filt[k] *= w*w;
+    }
+  }
+  else
+  {
+    /* rampwindow.m and rampwindowMtf.m multiply by the window at the
+     * 2*len frequencies k/(2*len), a circular convolution with the even
+     * kernel w = ifft(window) of length 2*len. A column of length len
+     * only meets w at |m| < len, so the same kernel padded to the length
+     * order >= 2*len filters as the MATLAB code. */
+    window = (double *) malloc((len + 1) * sizeof(double));
+    cosine = (double *) malloc(2*len * sizeof(double));
+    for (k = 0; k <= len; k++)
+    {
+      nu = (double) k/(2*len);
+      if (f->type == COSINE)
+        window[k] = pow(cos(PI*nu), param);
+      else
+        window[k] = mtfValue(nu/delta, f->table, f->tableLength/2)
+                    / pow(cos(PI*nu/2), param);
+    }
+    for (k = 0; k < 2*len; k++)
+      cosine[k] = cos(PI*k/len);
+
+    im = (double *) calloc(order, sizeof(double));
+    for (k = 0; k < order; k++)
+      filt[k] = 0;
+    for (m = 0; m < len; m++)
+    {
+      /* w[m], the window is even and window[len] is the Nyquist term */
+      w = window[0] + ((m % 2) ? -window[len] : window[len]);
+      for (k = 1; k < len; k++)
+        w += 2*window[k]*cosine[(int) (((long long) k*m) % (2*len))];
+      filt[m] = w/(2*len);
+      if (m > 0)
+        filt[order - m] = filt[m];
+    }
+    fftExecute(plan, filt, im, 0);
+    free(im);
+    free(cosine);
+    free(window);
+  }
+  for (k = 1; k < half; k++)
+    filt[order - k] = filt[k];
+}
+
+/* MTF at the frequency x, linearly interpolated in the table as in
+ * mtfWindow.m: the first value below the table, 0 above it */
+static double
+mtfValue(double x, const double *mtf, int mtfLength)
+{
+  const double *xaxis = mtf;
+  const double *yaxis = mtf + mtfLength;
+  int lo, hi, mid;
+
+  if (x <= xaxis[0])
+    return yaxis[0];
+  if (x > xaxis[mtfLength - 1])
+    return 0;
+
+  /* xaxis[lo] < x <= xaxis[hi] */
+  lo = 0;
+  hi = mtfLength - 1;
+  while (hi - lo > 1)
+  {
+    mid = (lo + hi)/2;
+    if (x > xaxis[mid])
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return ((xaxis[hi] - x)*yaxis[lo] + (x - xaxis[lo])*yaxis[hi]) / (xaxis[hi] - xaxis[lo]);
+}
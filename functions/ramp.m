@@ -6,6 +6,20 @@ function q = ramp(g, dalfa)
   %  dalfa:   angle between the rays
   %
   %  w = cos(pi*(-M2:M2)'/(2*M2)).^2; % low pass weighting
+  %
+  %  The C and OpenMP codes filter with projectionFilterc, which caches
+  %  the filter and the FFT plan.
+
+  % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+  global useCode
+  if ~isempty(useCode) && useCode > 0
+    if nargin == 1
+      q = projectionFilterc(double(g), 'ramp');
+    else
+      q = projectionFilterc(double(g), 'ramp', dalfa);
+    end
+    return;
+  end
 
   [M,N] = size(g);
 
@@ -3,6 +3,19 @@ function q = rampwindow(p, rVec, weight, n)
 % Window function to be used together with ramp-filter
 % Maria Magnusson, 2014-07-03
 %=====================================================
+% The C and OpenMP codes filter with projectionFilterc, which caches
+% the window and the FFT plan.
+
+% 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+global useCode
+if ~isempty(useCode) && useCode > 0
+  if strcmp(weight, 'Cosine')
+    q = projectionFilterc(double(p), 'cosine', n);
+  else
+    q = p;  % the window is 1
+  end
+  return;
+end
 
 % variables
 %----------
@@ -7,18 +7,45 @@ function q = rampwindowMtf(p, rVec, n)
   % Maria Magnusson, 2014-07-08
   % Alexander Örtenberg 2014-11-12
   %================================================================
+  %
+  % MTF.dat is read once and again only when it changes. The C and
+  % OpenMP codes filter with projectionFilterc, which caches the window
+  % and the FFT plan. It designs the window at the frequencies below and
+  % resamples it to its power of 2 FFT length through the impulse
+  % response, so it matches this code to rounding for any length.
+
+  persistent MTF mtfDate
 
   % variables
   %----------
   Nr = length(rVec);
   delta = rVec(2)-rVec(1);
+
+  mtfFile = which('MTF.dat');
+  if isempty(mtfFile)
+    mtfFile = 'MTF.dat';
+  end
+  mtfInfo = dir(mtfFile);
+  if isempty(MTF) || isempty(mtfInfo) || ~isequal(mtfInfo(1).datenum, mtfDate)
+    MTF = load('MTF.dat', '-ascii');
+    if ~isempty(mtfInfo)
+      mtfDate = mtfInfo(1).datenum;
+    end
+  end
+
+  % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+  global useCode
+  if ~isempty(useCode) && useCode > 0
+    q = projectionFilterc(double(p), 'mtf', n, double(MTF(:, 1:2)), delta);
+    return;
+  end
+
   Raxis = (-Nr:Nr-1)'/(2*Nr*delta);
   Nphi = size(p,2);
   odd = rem(Nr,2);
   
   % design a MTF weighting window
   %----------------- -------------
-  MTF = load('MTF.dat', '-ascii');
   W = 0*Raxis;
   for k = 1:2*Nr
     W(k) = mtfWindow(abs(Raxis(k)), MTF);
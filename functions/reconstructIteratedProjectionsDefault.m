@@ -1,5 +1,9 @@
 function rec = reconstructIteratedProjectionsDefault(proj, r2Vec, degVec, N1, dt1)
-  % reconstructMeasuredProjectionsDefault
+  % reconstructIteratedProjectionsDefault
+  %
+  % proj is a sinogram or a stack of sinograms [len x numAngles x k],
+  % DIRA passes the low and high energy sinograms as one stack. rec is
+  % the stack of the k reconstructed images.
 
-  rec = iradon(proj, degVec, 'linear', 'Hann', 1, N1)/dt1; 
+  rec = inverseRadon(proj, degVec, 'linear', 'Hann', 1, N1)/dt1; 
 end
@@ -0,0 +1,18 @@
+function rec = reconstructIteratedProjectionsGridding(proj, r2Vec, degVec, N1, dt1)
+  % reconstructIteratedProjectionsGridding
+  %
+  % Direct Fourier reconstruction by gridding, an alternative to
+  % reconstructIteratedProjectionsDefault with the same signature. The C
+  % function griddingReconstructc must be compiled, see compileOpenMP.
+  %
+  % proj is a sinogram or a stack of sinograms [len x numAngles x k],
+  % DIRA passes the low and high energy sinograms as one stack. rec is
+  % the stack of the k reconstructed images.
+
+  rec = zeros(N1, N1, size(proj, 3));
+  for k = 1:2:size(proj, 3)
+    pair = k:min(k + 1, size(proj, 3));
+    rec(:, :, pair) = griddingReconstructc(double(proj(:, :, pair)),...
+      pi*degVec/180, N1, 'Hann', 1)/dt1;
+  end
+end
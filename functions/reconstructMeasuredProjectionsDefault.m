@@ -1,5 +1,9 @@
 function rec = reconstructMeasuredProjectionsDefault(projBH, r2Vec, degVec, N1, dt1)
   % reconstructMeasuredProjectionsDefault
+  %
+  % projBH is a sinogram or a stack of sinograms [len x numAngles x k],
+  % DIRA passes the low and high energy sinograms as one stack. rec is
+  % the stack of the k reconstructed images.
 
-  rec = iradon(projBH, degVec, 'linear', 'Hann', 1, N1)/dt1;
+  rec = inverseRadon(projBH, degVec, 'linear', 'Hann', 1, N1)/dt1;
 end
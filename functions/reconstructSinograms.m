@@ -0,0 +1,28 @@
+function rec = reconstructSinograms(reconstruct, projLow, projHigh, r2Vec, degVec,...
+  N1, dt1, stacked)
+  % RECONSTRUCTSINOGRAMS Reconstruct the low and high energy sinograms.
+  %
+  % rec = reconstructSinograms(reconstruct, projLow, projHigh, r2Vec,
+  % degVec, N1, dt1, stacked) returns the stack [N1 x N1 x 2] of the
+  % images reconstructed by the function handle reconstruct, e.g.
+  % reconstructIteratedProjections of DIRA.
+  %
+  % The reconstruction functions shipped with DIRA accept a stack of
+  % sinograms [len x numAngles x k] and are called once for both
+  % sinograms. Other functions, e.g. @myReconstructIteratedProjections,
+  % are called once per sinogram unless stacked is true, see
+  % pmd.stackedReconstruction.
+
+  stackFunctions = {'reconstructMeasuredProjectionsDefault',...
+    'reconstructIteratedProjectionsDefault',...
+    'reconstructMeasuredProjectionsGridding',...
+    'reconstructIteratedProjectionsGridding'};
+
+  if stacked || (isa(reconstruct, 'function_handle') &&...
+      any(strcmp(func2str(reconstruct), stackFunctions)))
+    rec = reconstruct(cat(3, projLow, projHigh), r2Vec, degVec, N1, dt1);
+  else
+    rec = cat(3, reconstruct(projLow, r2Vec, degVec, N1, dt1),...
+      reconstruct(projHigh, r2Vec, degVec, N1, dt1));
+  end
+end
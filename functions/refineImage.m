@@ -0,0 +1,15 @@
+function B = refineImage(A, n, f)
+  % REFINEIMAGE Interpolate coarse images to the fine grid of coarsenGrid.
+  %
+  % B = refineImage(A, n, f) bilinearly interpolates the stack of images A
+  % [m x m x k], computed on the grid of coarsenGrid(., f, [1 2]), to
+  % images B [n x n x k]. Pixels outside the coarse grid are 0.
+
+  m = size(A, 1);
+  u = ceil(m/2) + ((1:n) - ceil(n/2))/f;  % coarse coordinates of fine pixels
+  [U, V] = meshgrid(u, u);
+  B = zeros(n, n, size(A, 3));
+  for k = 1:size(A, 3)
+    B(:, :, k) = interp2(A(:, :, k), U, V, 'linear', 0);
+  end
+end
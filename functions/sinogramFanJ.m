@@ -0,0 +1,26 @@
+function P = sinogramFanJ(I, betavec, gammavec, L)
+  % SINOGRAMFANJ Computes a fan-beam sinogram by Joseph projection.
+  %
+  % The source moves on a circle of radius L around the image center and
+  % the detector is equiangular. The ray with source angle beta and fan
+  % angle gamma is the parallel ray of sinogramJ with the angle
+  % theta = beta + gamma and the projection coordinate r = L*sin(gamma);
+  % it is computed with linear interpolation (filter 6 of sinogramJ).
+  %
+  % Input:
+  % I:        [M x N] image or [M x N x K] stack of images
+  % betavec:  source angles in degrees
+  % gammavec: fan angles of the detector elements in radians
+  % L:        distance source - rotation center in pixels
+  %
+  % Output:
+  % P:        [numel(gammavec) x numel(betavec) x K] sinogram in pixels
+  %
+  % Example:
+  %   [betaVec, gammaVec, Lp] = smd.FanGeometry(pixsiz);
+  %   P = pixsiz * sinogramFanJ(Vol, betaVec, gammaVec, Lp);
+  %
+  % See also: fanFBP, sinogramJ
+
+  P = sinogramFanJc(double(I), betavec, gammavec, L);
+end
@@ -0,0 +1,155 @@
+/*-------------------------------------------------------------------*/
+/* This routine computes a fan-beam Joseph sinogram from a pixelized */
+/* phantom. The source moves on a circle of radius L around the      */
+/* image center and the detector is equiangular, i.e. the rays of a  */
+/* projection are given by their fan angles gamma.                   */
+/*                                                                   */
+/* The ray with source angle beta and fan angle gamma is the         */
+/* parallel ray with angle theta = beta + gamma and projection       */
+/* coordinate r = L*sin(gamma), see sinogramJc.c. Every ray is       */
+/* computed by projectRay of sinogramJRay.h, the ray-driven linear   */
+/* interpolation kernel of sinogramJc.c (filter 6), so a fan-beam    */
+/* sinogram agrees with a parallel sinogram sampled at the same      */
+/* (theta, r).                                                       */
+/*                                                                   */
+/* Usage:                                                            */
+/*   P = sinogramFanJc(I, beta, gamma, L)                            */
+/*   I:     M x N or M x N x K stack of images                       */
+/*   beta:  source angles in degrees                                 */
+/*   gamma: fan angles of the detector elements in radians           */
+/*   L:     distance source - rotation center in pixels              */
+/*   P:     [numel(gamma) x numel(beta) x K] sinogram                */
+/*                                                                   */
+/* The file compiles with and without OpenMP.                        */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include "mex.h"
+#include "sinogramJRay.h"
+
+static void sinogramFanJ(double *pPtr, double *iPtr, double *betaPtr, double *gammaPtr,
+			 double L, int M, int N, int xOrigin, int yOrigin, int numAngles,
+			 int numRays, int numChannels);
+
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+#define PI 3.14159265358979
+
+/* Input Arguments */
+#define I      (prhs[0])
+#define BETA   (prhs[1])
+#define GAMMA  (prhs[2])
+#define L_IN   (prhs[3])
+
+/* Output Arguments */
+#define	P      (plhs[0])
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  int numAngles;		/* number of source angles */
+  int numRays;			/* number of rays per projection */
+  double *betaPtr;		/* pointer to source angles in radians */
+  double deg2rad;		/* conversion factor */
+  double L;				/* distance source - rotation center */
+  int k;                /* loop counter */
+  int M, N;             /* input image size */
+  int xOrigin, yOrigin;	/* center of image */
+  int numChannels;		/* number of images in the input stack */
+  const mwSize *dimPtr;	/* dimensions of the input stack */
+  mwSize dims[3];		/* dimensions of the output stack */
+
+  /* Check validity of arguments */
+  if (nrhs != 4)
+  {
+      mexErrMsgTxt("Usage: P = sinogramFanJc(I, beta, gamma, L)");
+  }
+  if (nlhs > 1)
+  {
+      mexErrMsgTxt("Too many output arguments to SINOGRAMFANJ");
+  }
+  if (mxIsSparse(I) || mxIsSparse(BETA) || mxIsSparse(GAMMA) || mxIsComplex(I))
+  {
+      mexErrMsgTxt("Sparse or complex inputs not supported");
+  }
+  if (!mxIsDouble(I) || !mxIsDouble(BETA) || !mxIsDouble(GAMMA) || !mxIsDouble(L_IN))
+  {
+      mexErrMsgTxt("Inputs must be double");
+  }
+
+  /* Get BETA degree values and convert to radians */
+  deg2rad = PI / 180.0;
+  numAngles = mxGetNumberOfElements(BETA);
+  betaPtr = (double *) mxCalloc(numAngles, sizeof(double));
+  for (k = 0; k < numAngles; k++)
+    betaPtr[k] = mxGetPr(BETA)[k] * deg2rad;
+
+  numRays = mxGetNumberOfElements(GAMMA);
+  L = mxGetScalar(L_IN);
+
+  /* Get input image size, an M x N x numChannels stack is projected at once */
+  dimPtr = mxGetDimensions(I);
+  M = dimPtr[0];
+  N = dimPtr[1];
+  numChannels = (M*N > 0) ? mxGetNumberOfElements(I) / (M*N) : 1;
+
+  /* Where is the coordinate system's origin? */
+  xOrigin = MAX(0, (N-1)/2);
+  yOrigin = MAX(0, (M-1)/2);
+
+  dims[0] = numRays;
+  dims[1] = numAngles;
+  dims[2] = numChannels;
+  P = mxCreateNumericArray((numChannels > 1) ? 3 : 2, dims, mxDOUBLE_CLASS, mxREAL);
+  sinogramFanJ(mxGetPr(P), mxGetPr(I), betaPtr, mxGetPr(GAMMA), L, M, N, xOrigin, yOrigin,
+	       numAngles, numRays, numChannels);
+
+  mxFree(betaPtr);
+}
+
+static void
+sinogramFanJ(double *pPtr, double *iPtr, double *betaPtr, double *gammaPtr, double L,
+	     int M, int N, int xOrigin, int yOrigin, int numAngles, int numRays,
+	     int numChannels)
+{
+  int k,j,c;                                     /* Loop variables */
+  int radius;                                    /* Radius of circle from which to use values */
+  double *columns, *rows;                        /* Padded copies of the images along x and along y */
+  int columnsSize, rowsSize;                     /* Strides between the lines of the channels */
+  int imageSize, sinogramSize;                   /* Strides between channels */
+
+  /* Only values in a circle will be used, the edges do not add anything */
+  radius = MAX(M, N) / 2;
+
+  imageSize    = M * N;
+  sinogramSize = numRays * numAngles;
+  columnsSize  = M * (N + 2*PAD);
+  rowsSize     = N * (M + 2*PAD);
+  columns = (double *) calloc(numChannels * columnsSize, sizeof(double));
+  rows    = (double *) calloc(numChannels * rowsSize, sizeof(double));
+
+  /* Copy the pixels inside the circle, the rest of the lines stay zero */
+  for(c=0;c<numChannels;++c)
+    copyRayLines(columns + c*columnsSize, rows + c*rowsSize, iPtr + c*imageSize, M, N,
+                 xOrigin, yOrigin, radius);
+
+  /* Calculate for every source angle the parallel rays with
+   * theta = beta + gamma and r = L*sin(gamma) */
+  #pragma omp parallel for private(j, c)
+  for(k=0;k<numAngles;++k)
+  {
+    for(j=0;j<numRays;++j)
+    {
+      for(c=0;c<numChannels;++c)
+      {
+        pPtr[c*sinogramSize + k*numRays + j] =
+          projectRay(columns + c*columnsSize, rows + c*rowsSize, M, N, xOrigin, yOrigin,
+                     radius, betaPtr[k] + gammaPtr[j], L*sin(gammaPtr[j]));
+      }
+    }
+  }
+
+  free(columns);
+  free(rows);
+}
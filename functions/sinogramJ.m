@@ -1,4 +1,4 @@
-function [P,r] = sinogramJ(I,thetavec,rvec,filter)
+function [P,r] = sinogramJ(I,thetavec,rvec,filter,opts)
 %SINOGRAMD Computes a Sinogram i.e. the Radon transform.
 %   The SINOGRAMD function computes the Radon transform, which is the
 %   projection of the image intensity along a radial line
@@ -11,6 +11,15 @@ function [P,r] = sinogramJ(I,thetavec,rvec,filter)
 %   a matrix in which each column is the Radon transform for one
 %   of the angles in THETA. 
 %
+%   If I is an M-by-N-by-K stack of images, e.g. the volume fractions of all
+%   base materials, then all K images are projected in one pass and R is
+%   an array in which R(:,:,k) is the Radon transform of I(:,:,k). The
+%   interpolation weights are computed once per pixel and angle and
+%   applied to all K images. I can also be an Nr-by-Nr-by-Nz volume, whose
+%   slices are projected in one call; the OpenMP code splits the slices
+%   into blocks and distributes blocks of slices and angles over the
+%   threads.
+%
 %   R = SINOGRAMD(I,THETA,FILTER) returns a Radon transform with the
 %   detector distance equal to the pixel distance.
 %   FILTER is the interpolation filter (for details, see the code):
@@ -19,6 +28,8 @@ function [P,r] = sinogramJ(I,thetavec,rvec,filter)
 %   3 = cubic interpolation
 %   4 = sincot, h=0.77
 %   5 = sincot, h=0.6
+%   6 = linear interpolation, computed ray by ray instead of pixel by
+%       pixel (C and OpenMP code only, the OpenCL code uses filter 2)
 %
 %   The number of points the projection is computed as:
 %   MNmax = max(size(I));
@@ -30,6 +41,17 @@ function [P,r] = sinogramJ(I,thetavec,rvec,filter)
 %   [R,Xp] = SINOGRAMD(...) returns a vector Xp containing the radial
 %   coordinates corresponding to each row of R.
 %
+%   R = SINOGRAMD(I,THETA,RVEC,FILTER,OPTS) restricts and rearranges the
+%   output. OPTS is a struct with the optional fields
+%     window: [first last], only the rows first:last of R are computed
+%     layout: 'bins' (default), 'angles' or 'interleaved'. 'angles'
+%             returns R.', 'interleaved' returns permute(R, [3 1 2]), a
+%             K-by-bins-by-angles array in which the K values of a ray are
+%             adjacent, see computePolyProj.m
+%     scale:  factor applied to R, e.g. the pixel size
+%   The C and OpenMP code only accumulate the rows inside the window and
+%   write the final array directly.
+%
 %   Remarks
 %   -------
 %   The radial coordinates returned in Xp are the values along
@@ -62,14 +84,37 @@ function [P,r] = sinogramJ(I,thetavec,rvec,filter)
 
   % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
   % Matlab version is too slow, we don't use it. C is the default.
+  if nargin < 5
+    opts = struct();
+  end
+
   global useCode
   switch (useCode)
     case 2
-      [P,r] = sinogramJc_openmp(double(I),thetavec,rvec,filter);
+      [P,r] = sinogramJc_openmp(double(I),thetavec,rvec,filter,opts);
       return;
     case 3
-      [P,r] = sinogramJc_opencl(double(I),thetavec,rvec,filter);
+      % The OpenCL kernel projects a single image per call
+      if (filter == 6)
+        filter = 2;
+      end
+      for k = 1:size(I,3)
+        [P(:,:,k),r] = sinogramJc_opencl(double(I(:,:,k)),thetavec,rvec,filter);
+      end
+      % Apply the output options to the full sinogram
+      if isfield(opts, 'window') && ~isempty(opts.window)
+        P = P(opts.window(1):opts.window(2), :, :);
+        r = r(opts.window(1):opts.window(2));
+      end
+      if isfield(opts, 'scale') && ~isempty(opts.scale)
+        P = opts.scale * P;
+      end
+      if isfield(opts, 'layout') && strcmp(opts.layout, 'angles')
+        P = permute(P, [2 1 3]);
+      elseif isfield(opts, 'layout') && strcmp(opts.layout, 'interleaved')
+        P = permute(P, [3 1 2]);
+      end
       return;	 
   end
 
-[P,r] = sinogramJc(double(I),thetavec,rvec,filter);
+[P,r] = sinogramJc(double(I),thetavec,rvec,filter,opts);
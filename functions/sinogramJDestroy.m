@@ -0,0 +1,7 @@
+function sinogramJDestroy(plan)
+  % SINOGRAMJDESTROY Release a projection plan created by sinogramJPlan.
+
+  if plan.id ~= 0
+    sinogramJPlanc('destroy', plan.id);
+  end
+end
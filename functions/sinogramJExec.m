@@ -0,0 +1,24 @@
+function [P,r] = sinogramJExec(plan, I, pixels)
+  % SINOGRAMJEXEC Compute a Joseph sinogram using a projection plan.
+  %
+  % [P,r] = sinogramJExec(plan, I) is equivalent to
+  % [P,r] = sinogramJ(I, plan.thetavec, plan.rvec, plan.filter, plan.opts) but the
+  % geometry precomputed by sinogramJPlan is reused. I may be a stack of
+  % images, see sinogramJ.m.
+  %
+  % [P,r] = sinogramJExec(plan, I, pixels) projects only the pixels with
+  % the sorted linear indices pixels, e.g. the union of the tissue masks
+  % from maskIndices. The other pixels of I must be zero. The C codes then
+  % do not scan I for non-zero pixels.
+
+  if plan.id == 0
+    [P,r] = sinogramJ(I, plan.thetavec, plan.rvec, plan.filter, plan.opts);
+    return;
+  end
+
+  if nargin < 3
+    [P,r] = sinogramJPlanc('exec', plan.id, double(I));
+  else
+    [P,r] = sinogramJPlanc('exec', plan.id, double(I), double(pixels));
+  end
+end
@@ -0,0 +1,128 @@
+/*-------------------------------------------------------------------*/
+/* Output layout of the sinogramJ MEX functions.                     */
+/*                                                                   */
+/* sinogramJc, sinogramJc_openmp and sinogramJPlanc share the        */
+/* optional output options (window, layout and scale) and write the  */
+/* projections through the strides of an outputOptions struct:       */
+/*                                                                   */
+/*   outputOptions out;                                              */
+/*   getOutputOptions(opts, rSize, numAngles, numChannels, &out);    */
+/*   pPtr[c*out.channelStride + k*out.angleStride                    */
+/*        + (i - out.first)*out.binStride] += out.scale*value;       */
+/*-------------------------------------------------------------------*/
+#ifndef SINOGRAMJ_OUTPUT_H
+#define SINOGRAMJ_OUTPUT_H
+
+#include <string.h>
+#include "mex.h"
+
+/* The sinogramJ headers are shared by MEX files that use only some of
+ * their functions */
+#if defined(__GNUC__)
+#define SINOGRAMJ_FUNCTION static __attribute__((unused))
+#else
+#define SINOGRAMJ_FUNCTION static
+#endif
+
+/* Layout of the output, see getOutputOptions */
+typedef struct
+{
+  int first;            /* first detector element of the output */
+  int numBins;          /* number of detector elements in the output */
+  int binStride;        /* distance between detector elements in the output */
+  int angleStride;      /* distance between angles in the output */
+  int channelStride;    /* distance between images in the output */
+  int transposed;       /* angles x detector elements layout? */
+  int interleaved;      /* images x detector elements x angles layout? */
+  double scale;         /* factor applied to the output */
+} outputOptions;
+
+/* Sets the strides of the output for a stack of numChannels images */
+SINOGRAMJ_FUNCTION void
+setOutputStrides(outputOptions *out, int numAngles, int numChannels)
+{
+  if (out->interleaved)
+  {
+    out->channelStride = 1;
+    out->binStride     = numChannels;
+    out->angleStride   = out->numBins * numChannels;
+  }
+  else
+  {
+    out->binStride     = out->transposed ? numAngles : 1;
+    out->angleStride   = out->transposed ? 1 : out->numBins;
+    out->channelStride = out->numBins * numAngles;
+  }
+}
+
+/** Reads the optional output options, a struct with the fields
+ *    window: [first last], the detector elements (indices into rvec) that
+ *            are computed, default all
+ *    layout: 'bins' for a [bins x angles] output (default), 'angles'
+ *            for an [angles x bins] output or 'interleaved' for an
+ *            [images x bins x angles] output, in which the values of all
+ *            images of a ray are adjacent
+ *    scale:  factor applied to the output, e.g. the pixel size, default 1
+ *  Only the elements inside the window are accumulated.
+ */
+SINOGRAMJ_FUNCTION void
+getOutputOptions(const mxArray *opts, int rSize, int numAngles, int numChannels,
+    outputOptions *out)
+{
+  mxArray *field;
+  double *window;
+  char layout[16];
+
+  out->first      = 0;
+  out->numBins    = rSize;
+  out->transposed = 0;
+  out->interleaved = 0;
+  out->scale      = 1;
+
+  if (opts != NULL && !mxIsEmpty(opts))
+  {
+    if (!mxIsStruct(opts))
+    {
+        mexErrMsgTxt("Options must be a struct");
+    }
+
+    field = mxGetField(opts, 0, "window");
+    if (field != NULL && !mxIsEmpty(field))
+    {
+      if (!mxIsDouble(field) || mxGetNumberOfElements(field) != 2)
+      {
+          mexErrMsgTxt("Option window must be [first last]");
+      }
+      window = mxGetPr(field);
+      if (window[0] < 1 || window[1] > rSize || window[0] > window[1])
+      {
+          mexErrMsgTxt("Option window must be within 1 and numel(rvec)");
+      }
+      out->first   = (int) window[0] - 1;
+      out->numBins = (int) window[1] - (int) window[0] + 1;
+    }
+
+    field = mxGetField(opts, 0, "layout");
+    if (field != NULL && !mxIsEmpty(field))
+    {
+      if (!mxIsChar(field) || mxGetString(field, layout, sizeof(layout)) != 0)
+      {
+          mexErrMsgTxt("Option layout must be 'bins', 'angles' or 'interleaved'");
+      }
+      if (strcmp(layout, "angles") == 0)
+        out->transposed = 1;
+      else if (strcmp(layout, "interleaved") == 0)
+        out->interleaved = 1;
+      else if (strcmp(layout, "bins") != 0)
+        mexErrMsgTxt("Option layout must be 'bins', 'angles' or 'interleaved'");
+    }
+
+    field = mxGetField(opts, 0, "scale");
+    if (field != NULL && !mxIsEmpty(field))
+      out->scale = mxGetScalar(field);
+  }
+
+  setOutputStrides(out, numAngles, numChannels);
+}
+
+#endif /* SINOGRAMJ_OUTPUT_H */
@@ -0,0 +1,438 @@
+/*-------------------------------------------------------------------*/
+/* Pixel-driven Joseph projection with linear interpolation, filter  */
+/* 2 of sinogramJ, shared by sinogramJc, sinogramJc_openmp and       */
+/* sinogramJPlanc.                                                   */
+/*                                                                   */
+/* The angles are grouped by the symmetries of the pixel grid, the   */
+/* contributing pixels of every block of at most CHANNEL_BLOCK       */
+/* images are gathered into a list, and the lists are projected in   */
+/* tiles of angle groups x pixels:                                   */
+/*                                                                   */
+/*   initAngleGroups(&groups, thetaPtr, numAngles);                  */
+/*   allocPixelBlocks(&blocks, M*N, numChannels);                    */
+/*   gatherPixelBlocks(&blocks, iPtr, M, N, xOrigin, yOrigin,        */
+/*                     radius, numChannels, out->scale);             */
+/*   projectPixelBlocks(pPtr, &blocks, &groups, rFirst, numChannels, */
+/*                      out);                                        */
+/*   freePixelBlocks(&blocks);                                       */
+/*   freeAngleGroups(&groups);                                       */
+/*                                                                   */
+/* The loops over blocks and tiles run in parallel when the MEX file */
+/* is compiled with OpenMP.                                          */
+/*-------------------------------------------------------------------*/
+#ifndef SINOGRAMJ_PIXEL_H
+#define SINOGRAMJ_PIXEL_H
+
+#include <math.h>
+#include <stdlib.h>
+#include "sinogramJOutput.h"
+
+#ifndef PI
+#define PI 3.14159265358979
+#endif
+
+/* Angles related by the symmetries of the pixel grid are projected
+ * together, see groupAngles. Two angles are equal within ANGLE_TOLERANCE
+ * radians. */
+#define NUM_SYMMETRIES 4
+#define ANGLE_TOLERANCE 1e-9
+
+/* Tiling of the kernel: each task projects ANGLE_BLOCK groups of
+ * symmetric angles, one block of pixels at a time. A pixel block holds
+ * about PIXEL_BLOCK_BYTES of geometry and values, so that it stays in the
+ * L2 cache while it is used for all angles of the task. */
+#define ANGLE_BLOCK 2
+#define PIXEL_BLOCK_BYTES (128*1024)
+
+/* Stacks with many images, e.g. the slices of a volume, are split into
+ * blocks of at most CHANNEL_BLOCK images with their own pixel lists. The
+ * tasks are all combinations of image blocks and angle blocks. */
+#define CHANNEL_BLOCK 8
+
+typedef struct
+{
+  double angle;         /* angle in [0, 2*PI) */
+  int index;            /* index into theta */
+} sortedAngle;
+
+typedef struct
+{
+  int numGroups;        /* number of groups */
+  int *groupAngle;      /* angles of the groups, NUM_SYMMETRIES per group */
+  int *groupType;       /* their symmetry types, see groupAngles */
+  int *groupSize;       /* number of angles of every group */
+  double *cosine;       /* precalculated values for the first angle of every group */
+  double *sine;
+  double *slope;
+} angleGroups;
+
+typedef struct
+{
+  int numBlocks;        /* number of image blocks */
+  int blockSize;        /* maximum number of pixels of a block */
+  int *xdistance;       /* distance in carthesian coordinates to image center, */
+  int *ydistance;       /* blockSize entries per block */
+  double *values;       /* pixel values, images innermost, block b at b*CHANNEL_BLOCK*blockSize */
+  int *numPixels;       /* number of contributing pixels of every block */
+} pixelBlocks;
+
+/* Sorts angles by their value */
+static int
+compareAngles(const void *a, const void *b)
+{
+  double d = ((const sortedAngle *) a)->angle - ((const sortedAngle *) b)->angle;
+  return (d > 0) - (d < 0);
+}
+
+/* Maps an angle in radians to [0, 2*PI) */
+static double
+normalizeAngle(double angle)
+{
+  angle = fmod(angle, 2*PI);
+  if(angle < 0)
+    angle += 2*PI;
+  if(2*PI - angle < ANGLE_TOLERANCE)
+    angle = 0;
+  return angle;
+}
+
+/* Returns the index of an unused angle equal to angle, or -1 */
+static int
+findAngle(sortedAngle *sorted, int numAngles, double angle, char *isUsed)
+{
+  int low = 0, high = numAngles, mid;
+
+  while(low < high)
+  {
+    mid = (low + high) / 2;
+    if(sorted[mid].angle < angle - ANGLE_TOLERANCE)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  for(;low<numAngles && sorted[low].angle <= angle + ANGLE_TOLERANCE;++low)
+    if(!isUsed[sorted[low].index])
+      return sorted[low].index;
+  return -1;
+}
+
+/** Groups the angles (in radians) into sets that are related to the first
+ *  angle of the set, theta, by a symmetry of the pixel grid:
+ *    type 0: theta           r =  x*cos + y*sin
+ *    type 1: theta + 90      r =  x*sin - y*cos
+ *    type 2: 90 - theta      r = -x*sin - y*cos
+ *    type 3: 180 - theta     r = -x*cos + y*sin
+ *  where cos and sin are those of -theta. The slope is the same for all
+ *  angles of a group. Angles without partners form groups of their own,
+ *  so irregular angle sets are handled as before. Returns the number of
+ *  groups; groupAngle and groupType hold NUM_SYMMETRIES entries per group.
+ */
+static int
+groupAngles(const double *thetaPtr, int numAngles, int *groupAngle, int *groupType,
+	    int *groupSize)
+{
+  sortedAngle *sorted;
+  char *isUsed;
+  double target;
+  int numGroups, k, m, j;
+
+  sorted = (sortedAngle *) malloc(numAngles * sizeof(sortedAngle));
+  isUsed = (char *) calloc(numAngles, sizeof(char));
+  for(k=0;k<numAngles;++k)
+  {
+    sorted[k].angle = normalizeAngle(thetaPtr[k]);
+    sorted[k].index = k;
+  }
+  qsort(sorted, numAngles, sizeof(sortedAngle), compareAngles);
+
+  numGroups = 0;
+  for(k=0;k<numAngles;++k)
+  {
+    if(isUsed[k])
+      continue;
+    isUsed[k] = 1;
+    groupAngle[numGroups*NUM_SYMMETRIES] = k;
+    groupType[numGroups*NUM_SYMMETRIES]  = 0;
+    groupSize[numGroups] = 1;
+    for(m=1;m<NUM_SYMMETRIES;++m)
+    {
+      if(m == 1)
+        target = thetaPtr[k] + PI/2;
+      else if(m == 2)
+        target = PI/2 - thetaPtr[k];
+      else
+        target = PI - thetaPtr[k];
+      j = findAngle(sorted, numAngles, normalizeAngle(target), isUsed);
+      if(j >= 0)
+      {
+        isUsed[j] = 1;
+        groupAngle[numGroups*NUM_SYMMETRIES + groupSize[numGroups]] = j;
+        groupType[numGroups*NUM_SYMMETRIES + groupSize[numGroups]]  = m;
+        ++groupSize[numGroups];
+      }
+    }
+    ++numGroups;
+  }
+
+  free(sorted);
+  free(isUsed);
+  return numGroups;
+}
+
+/* Groups the angles (in radians) and precalculates the values of the groups */
+SINOGRAMJ_FUNCTION void
+initAngleGroups(angleGroups *groups, const double *thetaPtr, int numAngles)
+{
+  double angle;
+  int g;
+  int size = (numAngles > 0) ? numAngles : 1;    /* Number of entries of the tables */
+
+  groups->groupAngle = (int *) malloc(size * NUM_SYMMETRIES * sizeof(int));
+  groups->groupType  = (int *) malloc(size * NUM_SYMMETRIES * sizeof(int));
+  groups->groupSize  = (int *) malloc(size * sizeof(int));
+  groups->numGroups  = groupAngles(thetaPtr, numAngles, groups->groupAngle,
+                                   groups->groupType, groups->groupSize);
+
+  groups->cosine = (double *) malloc(groups->numGroups * sizeof(double));
+  groups->sine   = (double *) malloc(groups->numGroups * sizeof(double));
+  groups->slope  = (double *) malloc(groups->numGroups * sizeof(double));
+  for(g=0;g<groups->numGroups;++g)
+  {
+    angle = -thetaPtr[groups->groupAngle[g*NUM_SYMMETRIES]];
+    groups->cosine[g] = cos(angle);
+    groups->sine[g]   = sin(angle);
+    /* Calculate the slope depending on which angle value is larger */
+    groups->slope[g]  = 1/((fabs(groups->cosine[g]) > fabs(groups->sine[g])) ?
+                           fabs(groups->cosine[g]) : fabs(groups->sine[g]));
+  }
+}
+
+SINOGRAMJ_FUNCTION void
+freeAngleGroups(angleGroups *groups)
+{
+  free(groups->groupAngle);
+  free(groups->groupType);
+  free(groups->groupSize);
+  free(groups->cosine);
+  free(groups->sine);
+  free(groups->slope);
+}
+
+/* Allocates the pixel lists of a stack of numChannels images, every list
+ * holds at most blockSize pixels */
+SINOGRAMJ_FUNCTION void
+allocPixelBlocks(pixelBlocks *blocks, int blockSize, int numChannels)
+{
+  blocks->numBlocks = (numChannels + CHANNEL_BLOCK - 1) / CHANNEL_BLOCK;
+  blocks->blockSize = blockSize;
+  blocks->xdistance = (int *) malloc(sizeof(int) * blockSize * blocks->numBlocks);
+  blocks->ydistance = (int *) malloc(sizeof(int) * blockSize * blocks->numBlocks);
+  blocks->values    = (double *) malloc(sizeof(double) * blockSize * numChannels);
+  blocks->numPixels = (int *) calloc(blocks->numBlocks, sizeof(int));
+}
+
+SINOGRAMJ_FUNCTION void
+freePixelBlocks(pixelBlocks *blocks)
+{
+  free(blocks->xdistance);
+  free(blocks->ydistance);
+  free(blocks->values);
+  free(blocks->numPixels);
+}
+
+/** Checks for every pixel if it is within the radius of the unit circle
+ *  and if it is a non-zero value in at least one image of the block.
+ *  Only store its values if it passes both checks, or it does not
+ *  contribute. The values of all images of a block are stored next to
+ *  each other so that the geometry is computed once per pixel and angle
+ *  for the whole block. The blocks must hold M*N pixels.
+ */
+SINOGRAMJ_FUNCTION void
+gatherPixelBlocks(pixelBlocks *blocks, const double *iPtr, int M, int N, int xOrigin,
+                  int yOrigin, int radius, int numChannels, double scale)
+{
+  int x, y, c, cb;
+  int cFirst, nc;                                /* First image of a block and number of images */
+  int xdist, ydist;                              /* Distance in carthesian coordinates to image center */
+  int isNonZero;                                 /* Does any image of the pixel contribute? */
+  int pixelindex;                                /* Current index to store pixel data on */
+  int imageSize = M * N;
+  int blockSize = blocks->blockSize;
+
+#ifdef _OPENMP
+  #pragma omp parallel for private(x, y, c, cFirst, nc, xdist, ydist, isNonZero, pixelindex)
+#endif
+  for(cb=0;cb<blocks->numBlocks;++cb)
+  {
+    cFirst = cb*CHANNEL_BLOCK;
+    nc = (numChannels - cFirst < CHANNEL_BLOCK) ? numChannels - cFirst : CHANNEL_BLOCK;
+    pixelindex = 0;
+    for(y=0;y<M;++y)
+    {
+      for(x=0;x<N;++x)
+      {
+        ydist = x - xOrigin;
+        xdist = y - yOrigin;
+        if(sqrt(xdist * xdist + ydist * ydist) > radius)
+          continue;
+
+        isNonZero = 0;
+        for(c=0;c<nc;++c)
+          isNonZero |= (iPtr[(cFirst + c)*imageSize + y*N + x] != 0);
+
+        if(isNonZero)
+        {
+          blocks->ydistance[cb*blockSize + pixelindex] = ydist;
+          blocks->xdistance[cb*blockSize + pixelindex] = xdist;
+          for(c=0;c<nc;++c)
+            blocks->values[cFirst*blockSize + pixelindex*nc + c] = scale * iPtr[(cFirst + c)*imageSize + y*N + x];
+          ++pixelindex;
+        }
+      }
+    }
+    blocks->numPixels[cb] = pixelindex;
+  }
+}
+
+/** The groups of angles are split into blocks, and every task projects
+ *  one block of images for one block of angles. The tasks are handed out
+ *  dynamically, so the threads are busy also when there are few angles
+ *  or when some image blocks have more contributing pixels than others.
+ *  Every task writes only to the columns of its own images and angles,
+ *  and walks through the pixel list one cache sized block at a time,
+ *  projecting the block for all angles of the task before it moves on.
+ *  The pixel data is thus read from memory once per angle block instead
+ *  of once per angle. The output must be zero initialized.
+ */
+SINOGRAMJ_FUNCTION void
+projectPixelBlocks(double *pPtr, const pixelBlocks *blocks, const angleGroups *groups,
+                   int rFirst, int numChannels, const outputOptions *out)
+{
+  int g, m, i, c;                                /* Loop variables */
+  double r;                                      /* Polar coordinate */
+  int r_index;                                   /* Polar coordinate as integer to index matrix */
+  int bin;                                       /* Offset of the left detector element in the output */
+  double fraction;                               /* Fraction of the r coordinate */
+  double leftpixel, rightpixel;                  /* Distribution for left and right pixel */
+  double distance, leftdistance, rightdistance;  /* Distance to left and right pixel */
+  const double *values;                          /* Channel values of the current pixel */
+  double *column;                                /* Output column of the current angle and image */
+  int sinogramSize = out->channelStride;         /* Stride between images */
+  int kb, ib;                                    /* First group and pixel of the current tile */
+  int kEnd, iEnd;                                /* End of the current tile */
+  int pixelBlock;                                /* Number of pixels in a pixel block */
+  int numAngleBlocks;                            /* Number of angle blocks */
+  int cb, t;                                     /* Image block and task */
+  int cFirst, nc;                                /* First image of a block and number of images */
+  const int *xd, *yd;                            /* Pixel list of the current image block */
+  const double *blockvalues;                     /* Pixel values of the current image block */
+  double xc, xs, yc, ys;                         /* Products shared by the angles of a group */
+  double rs[NUM_SYMMETRIES];                     /* Radial coordinates for the symmetry types */
+
+  numAngleBlocks = (groups->numGroups + ANGLE_BLOCK - 1) / ANGLE_BLOCK;
+
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(dynamic) private(cb, kb, g, m, i, c, ib, kEnd, iEnd,\
+                                   cFirst, nc, pixelBlock, xd, yd, blockvalues,\
+                                   xc, xs, yc, ys, rs,\
+                                   r, r_index, bin, fraction, distance,\
+                                   leftdistance, rightdistance, leftpixel,\
+                                   rightpixel, values, column)
+#endif
+  for(t=0;t<blocks->numBlocks*numAngleBlocks;++t)
+  {
+    cb = t / numAngleBlocks;
+    kb = (t % numAngleBlocks) * ANGLE_BLOCK;
+    kEnd = (kb + ANGLE_BLOCK < groups->numGroups) ? kb + ANGLE_BLOCK : groups->numGroups;
+    cFirst = cb*CHANNEL_BLOCK;
+    nc = (numChannels - cFirst < CHANNEL_BLOCK) ? numChannels - cFirst : CHANNEL_BLOCK;
+    xd = blocks->xdistance + cb*blocks->blockSize;
+    yd = blocks->ydistance + cb*blocks->blockSize;
+    blockvalues = blocks->values + cFirst*blocks->blockSize;
+    pixelBlock = PIXEL_BLOCK_BYTES / ((2*sizeof(int) + nc*sizeof(double)));
+    if(pixelBlock < 1)
+      pixelBlock = 1;
+
+    for(ib=0;ib<blocks->numPixels[cb];ib+=pixelBlock)
+    {
+      iEnd = (ib + pixelBlock < blocks->numPixels[cb]) ? ib + pixelBlock : blocks->numPixels[cb];
+
+      /* Calculate for every group of angles of the tile */
+      for(g=kb;g<kEnd;++g)
+      {
+        /* Calculate for all pixels of the tile */
+        for(i=ib;i<iEnd;++i)
+        {
+          /* The products are shared by all angles of the group */
+          xc = xd[i]*groups->cosine[g];
+          xs = xd[i]*groups->sine[g];
+          yc = yd[i]*groups->cosine[g];
+          ys = yd[i]*groups->sine[g];
+          rs[0] = xc + ys;
+          rs[1] = xs - yc;
+          rs[2] = -xs - yc;
+          rs[3] = ys - xc;
+          values = blockvalues + i*nc;
+
+          for(m=0;m<groups->groupSize[g];++m)
+          {
+            column = pPtr + cFirst*sinogramSize + groups->groupAngle[g*NUM_SYMMETRIES + m]*out->angleStride;
+
+            /* Find the index for the radial coordinates */
+            r = rs[groups->groupType[g*NUM_SYMMETRIES + m]];
+            r -= rFirst;    /* detector coordinate, rFirst is the first element, r > -2 */
+            r_index = ((int) (r + 2)) - 2;  /* floor(r), avoiding negative values */
+            fraction = r - r_index;
+
+            /* Get the pixel value and distribute between two pixels
+             * Calculates the distance once as it is used multiple times
+             * The slope is dependent on the angle, decreasing the
+             * triangle size */
+            distance = fraction*groups->slope[g];
+            /* No contribution if the distance is less than 0 */
+            /* Equal to
+             * (1 - fraction*slope[g]) and
+             * (1 - (1 - fraction) * slope[g])*/
+            leftdistance  = (1 - distance > 0) ? 1 - distance : 0;
+            rightdistance = (1 + distance - groups->slope[g] > 0) ? 1 + distance - groups->slope[g] : 0;
+
+            leftpixel  = leftdistance  * groups->slope[g];
+            rightpixel = rightdistance * groups->slope[g];
+
+            /* The same weights are applied to every image of the block,
+             * elements outside of the output window are skipped */
+            bin = (r_index - out->first)*out->binStride;
+            if((unsigned) (r_index - out->first) < (unsigned) out->numBins)
+              for(c=0;c<nc;++c)
+                column[c*sinogramSize + bin] += leftpixel * values[c];
+            if((unsigned) (r_index + 1 - out->first) < (unsigned) out->numBins)
+              for(c=0;c<nc;++c)
+                column[c*sinogramSize + bin + out->binStride] += rightpixel * values[c];
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Projects an M x N x numChannels stack with the pixel-driven kernel */
+SINOGRAMJ_FUNCTION void
+sinogramJ(double *pPtr, const double *iPtr, const double *thetaPtr, int M, int N,
+          int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize,
+          int numChannels, const outputOptions *out)
+{
+  angleGroups groups;
+  pixelBlocks blocks;
+
+  initAngleGroups(&groups, thetaPtr, numAngles);
+  allocPixelBlocks(&blocks, M * N, numChannels);
+
+  /* Only values in a circle will be used, the edges do not add anything */
+  gatherPixelBlocks(&blocks, iPtr, M, N, xOrigin, yOrigin, rSize/2, numChannels, out->scale);
+  projectPixelBlocks(pPtr, &blocks, &groups, rFirst, numChannels, out);
+
+  freePixelBlocks(&blocks);
+  freeAngleGroups(&groups);
+}
+
+#endif /* SINOGRAMJ_PIXEL_H */
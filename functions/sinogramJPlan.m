@@ -0,0 +1,49 @@
+function plan = sinogramJPlan(imgSize, thetavec, rvec, filter, opts)
+  % SINOGRAMJPLAN Create a projection plan for repeated sinogramJ calls.
+  %
+  % The plan holds the geometry of the Joseph projection (image size,
+  % angles and projection coordinates). The groups of symmetric angles
+  % and the list of pixels inside the reconstruction circle are computed
+  % once and reused by every call to sinogramJExec until the plan is
+  % destroyed with sinogramJDestroy.
+  %
+  % Input:
+  % imgSize:  [M N] size of the projected images
+  % thetavec: projection angles in degrees
+  % rvec:     projection coordinates
+  % filter:   interpolation filter, see sinogramJ.m (default 2). The C
+  %           and OpenMP plans support 2 and 6 only.
+  % opts:     output window, layout and scale, see sinogramJ.m
+  %
+  % Output:
+  % plan:     plan structure
+  %
+  % Example:
+  %   plan = sinogramJPlan([Nr Nr], degVec, r2Vec);
+  %   for iter = 1:numbIter
+  %     P = sinogramJExec(plan, Vol);
+  %   end
+  %   sinogramJDestroy(plan);
+
+  if nargin < 4
+    filter = 2;
+  end
+  if nargin < 5
+    opts = struct();
+  end
+
+  plan.imgSize = imgSize;
+  plan.thetavec = thetavec;
+  plan.rvec = rvec;
+  plan.filter = filter;
+  plan.opts = opts;
+
+  % 0 = Matlab, 1 = C, 2 = OpenMP, 3 = OpenCL
+  % The OpenCL code has no plans, sinogramJExec calls sinogramJ instead.
+  global useCode
+  if useCode == 3
+    plan.id = 0;
+  else
+    plan.id = sinogramJPlanc('create', double(imgSize), thetavec, rvec, double(filter), opts);
+  end
+end
@@ -0,0 +1,469 @@
+/*-------------------------------------------------------------------*/
+/* Projection plans for the Joseph sinogram, see sinogramJc.c.       */
+/* A plan holds the geometry of a sinogramJ call (image size, angles */
+/* and projection coordinates) so that the groups of symmetric       */
+/* angles and the list of pixels inside the reconstruction circle    */
+/* are computed once and reused by every execution of the plan. The  */
+/* projection uses the kernels of sinogramJc, see sinogramJPixel.h   */
+/* and sinogramJRay.h.                                               */
+/*                                                                   */
+/* Usage:                                                            */
+/*   id    = sinogramJPlanc('create', [M N], theta, rvec, filter)    */
+/*   id    = sinogramJPlanc('create', [M N], theta, rvec, filter,    */
+/*                          opts)                                    */
+/*   [P,r] = sinogramJPlanc('exec', id, I)                           */
+/*   [P,r] = sinogramJPlanc('exec', id, I, pixels)                   */
+/*           sinogramJPlanc('destroy', id)                           */
+/*                                                                   */
+/* filter is 2 (linear, pixel-driven) or 6 (linear, ray-driven), the */
+/* other filters of sinogramJ are not supported. opts selects the    */
+/* output window, layout and scale, see sinogramJc.c.                */
+/* pixels is an optional sorted list of the linear indices of the    */
+/* pixels that may be non-zero, e.g. the union of the tissue masks,  */
+/* see maskIndices.m. The other pixels are taken as zero and I is    */
+/* not scanned for non-zero pixels. The ray-driven filter reads the  */
+/* whole image and ignores the list.                                 */
+/* The plans stay valid until they are destroyed or the MEX file is  */
+/* cleared. The file compiles with and without OpenMP.               */
+/*-------------------------------------------------------------------*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mex.h"
+#include "sinogramJOutput.h"
+#include "sinogramJPixel.h"
+#include "sinogramJRay.h"
+
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+#define PI 3.14159265358979
+
+/* Interpolation types of sinogramJ that the plans support */
+#define LINEAR 2
+#define RAY_DRIVEN 6
+
+/* Command string */
+#define CMD    (prhs[0])
+
+/* Input Arguments of 'create' */
+#define SIZE   (prhs[1])
+#define THETA  (prhs[2])
+#define R_IN   (prhs[3])
+#define INTERP (prhs[4])
+#define OPTS   (prhs[5])
+
+/* Input Arguments of 'exec' and 'destroy' */
+#define ID     (prhs[1])
+#define I      (prhs[2])
+#define PIXELS (prhs[3])
+
+/* Output Arguments */
+#define  P      (plhs[0])
+#define  R      (plhs[1])
+
+typedef struct
+{
+  int M, N;             /* image size */
+  int xOrigin, yOrigin; /* center of image */
+  int numAngles;        /* number of theta values */
+  int rSize;            /* number of rows in output */
+  int rFirst;           /* r-value of the first row of output */
+  int interpolation;    /* LINEAR or RAY_DRIVEN */
+  double *theta;        /* theta values in radians */
+  angleGroups groups;   /* groups of symmetric angles with their cosine, sine and slope */
+  int numPixels;        /* number of pixels inside the circle */
+  int *xdistance;       /* distance in carthesian coordinates to image center */
+  int *ydistance;
+  int *pixelindices;    /* indices of the pixels inside the circle */
+  int *pixelnumbers;    /* number of every image pixel inside the circle, or -1 */
+  int numChannels;      /* number of channels the work arrays are allocated for */
+  pixelBlocks blocks;   /* work arrays, pixels that contribute to the current stack */
+  outputOptions out;    /* output window, layout and scale */
+} sinogramJPlan;
+
+static sinogramJPlan **plans = NULL;  /* table of plans, the id is the index + 1 */
+static int numPlans = 0;              /* size of the table */
+static int numActivePlans = 0;        /* number of plans not yet destroyed */
+
+static void createPlan(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+static void execPlan(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+static void destroyPlan(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+static sinogramJPlan *getPlan(const mxArray *id);
+static void freePlan(sinogramJPlan *plan);
+static void freeAllPlans(void);
+static void gatherPlanPixels(sinogramJPlan *plan, const double *iPtr, int numChannels,
+          const double *pixelPtr, int numListed);
+static void execKernel(double *pPtr, const double *iPtr, sinogramJPlan *plan, int numChannels,
+          const double *pixelPtr, int numListed);
+
+void
+mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
+{
+  char cmd[16];         /* command string */
+
+  if (nrhs < 1 || !mxIsChar(CMD) || mxGetString(CMD, cmd, sizeof(cmd)) != 0)
+  {
+      mexErrMsgTxt("The first argument must be 'create', 'exec' or 'destroy'");
+  }
+
+  if (strcmp(cmd, "create") == 0)
+    createPlan(nlhs, plhs, nrhs, prhs);
+  else if (strcmp(cmd, "exec") == 0)
+    execPlan(nlhs, plhs, nrhs, prhs);
+  else if (strcmp(cmd, "destroy") == 0)
+    destroyPlan(nlhs, plhs, nrhs, prhs);
+  else
+    mexErrMsgTxt("The first argument must be 'create', 'exec' or 'destroy'");
+}
+
+static void
+createPlan(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  sinogramJPlan *plan;  /* new plan */
+  double *sizePtr;      /* pointer to image size */
+  double *thetaPtr;     /* pointer to theta values in degrees */
+  double deg2rad;       /* conversion factor */
+  int interpolation;    /* interpolation type */
+  int radius;           /* radius of circle from which to use values */
+  int x, y, k;          /* loop counters */
+  int xdist, ydist;     /* temporary variables */
+  int id;               /* plan id */
+  outputOptions out;    /* output window, layout and scale */
+
+  /* Check validity of arguments */
+  if (nrhs != 5 && nrhs != 6)
+  {
+      mexErrMsgTxt("Usage: id = sinogramJPlanc('create', [M N], theta, rvec, filter, opts)");
+  }
+  if (nlhs > 1)
+  {
+      mexErrMsgTxt("Too many output arguments to SINOGRAMJPLANC");
+  }
+  if (!mxIsDouble(SIZE) || !mxIsDouble(THETA) || !mxIsDouble(R_IN) || !mxIsDouble(INTERP))
+  {
+      mexErrMsgTxt("Inputs must be double");
+  }
+  if (mxGetNumberOfElements(SIZE) != 2)
+  {
+      mexErrMsgTxt("Image size must be [M N]");
+  }
+  if (mxGetNumberOfElements(INTERP) != 1)
+  {
+      mexErrMsgTxt("Filter must be a scalar");
+  }
+  if (mxGetScalar(INTERP) != LINEAR && mxGetScalar(INTERP) != RAY_DRIVEN)
+  {
+      mexErrMsgTxt("Plans support filter 2 (linear) and 6 (linear, ray-driven) only");
+  }
+  interpolation = (int) mxGetScalar(INTERP);
+
+  getOutputOptions((nrhs == 6) ? OPTS : NULL, mxGetNumberOfElements(R_IN),
+                   mxGetNumberOfElements(THETA), 1, &out);
+
+  plan = (sinogramJPlan *) calloc(1, sizeof(sinogramJPlan));
+  plan->out = out;
+  plan->interpolation = interpolation;
+
+  sizePtr = mxGetPr(SIZE);
+  plan->M = (int) sizePtr[0];
+  plan->N = (int) sizePtr[1];
+  plan->numAngles = mxGetNumberOfElements(THETA);
+  plan->rSize = mxGetNumberOfElements(R_IN);
+  plan->rFirst = (1-plan->rSize)/2;
+
+  /* Where is the coordinate system's origin? */
+  plan->xOrigin = MAX(0, (plan->N-1)/2);
+  plan->yOrigin = MAX(0, (plan->M-1)/2);
+
+  /* Precalculate the groups of symmetric angles */
+  deg2rad = PI / 180.0;
+  thetaPtr = mxGetPr(THETA);
+  plan->theta = (double *) malloc(plan->numAngles * sizeof(double));
+  for(k=0;k<plan->numAngles;++k)
+    plan->theta[k] = thetaPtr[k] * deg2rad;
+  initAngleGroups(&plan->groups, plan->theta, plan->numAngles);
+
+  /* Only values in a circle will be used, the edges do not add anything */
+  radius = ceil(plan->rSize/2);
+
+  plan->xdistance    = (int *) malloc(sizeof(int) * plan->M * plan->N);
+  plan->ydistance    = (int *) malloc(sizeof(int) * plan->M * plan->N);
+  plan->pixelindices = (int *) malloc(sizeof(int) * plan->M * plan->N);
+  plan->pixelnumbers = (int *) malloc(sizeof(int) * plan->M * plan->N);
+  plan->numPixels = 0;
+  for(y=0;y<plan->M;++y)
+  {
+    for(x=0;x<plan->N;++x)
+    {
+      ydist = x - plan->xOrigin;
+      xdist = y - plan->yOrigin;
+      plan->pixelnumbers[y*plan->N + x] = -1;
+      if(sqrt(xdist * xdist + ydist * ydist) <= radius)
+      {
+        plan->pixelnumbers[y*plan->N + x] = plan->numPixels;
+        plan->ydistance[plan->numPixels] = ydist;
+        plan->xdistance[plan->numPixels] = xdist;
+        plan->pixelindices[plan->numPixels] = y*plan->N + x;
+        ++plan->numPixels;
+      }
+    }
+  }
+
+  /* Store the plan in the first free slot of the table */
+  for(id=0;id<numPlans && plans[id] != NULL;++id)
+    ;
+  if(id == numPlans)
+  {
+    numPlans = (numPlans == 0) ? 16 : 2*numPlans;
+    plans = (sinogramJPlan **) realloc(plans, numPlans * sizeof(sinogramJPlan *));
+    memset(plans + id, 0, (numPlans - id) * sizeof(sinogramJPlan *));
+  }
+  plans[id] = plan;
+
+  /* Keep the MEX file, and with it the plans, in memory */
+  if(numActivePlans++ == 0)
+  {
+    mexLock();
+    mexAtExit(freeAllPlans);
+  }
+
+  plhs[0] = mxCreateDoubleScalar(id + 1);
+}
+
+static void
+execPlan(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  sinogramJPlan *plan;  /* plan to execute */
+  const mwSize *dimPtr; /* dimensions of the input stack */
+  mwSize dims[3];       /* dimensions of the output stack */
+  int numChannels;      /* number of images in the input stack */
+  const double *pixelPtr; /* listed pixels, or NULL */
+  int numListed;        /* number of listed pixels */
+  double *pr1;          /* help pointer */
+  int k;                /* loop counter */
+
+  /* Check validity of arguments */
+  if (nrhs != 3 && nrhs != 4)
+  {
+      mexErrMsgTxt("Usage: [P,r] = sinogramJPlanc('exec', id, I, pixels)");
+  }
+  if (nlhs > 2)
+  {
+      mexErrMsgTxt("Too many output arguments to SINOGRAMJPLANC");
+  }
+  if (mxIsSparse(I) || !mxIsDouble(I))
+  {
+      mexErrMsgTxt("Image must be a full double array");
+  }
+
+  plan = getPlan(ID);
+
+  dimPtr = mxGetDimensions(I);
+  if (dimPtr[0] != plan->M || dimPtr[1] != plan->N)
+  {
+      mexErrMsgTxt("Image size does not match the plan");
+  }
+  numChannels = (plan->M*plan->N > 0) ? mxGetNumberOfElements(I) / (plan->M*plan->N) : 1;
+
+  /* The list must be sorted to add the pixels in the order of a scan */
+  pixelPtr = NULL;
+  numListed = 0;
+  if (nrhs == 4)
+  {
+    if (mxIsSparse(PIXELS) || !mxIsDouble(PIXELS))
+    {
+        mexErrMsgTxt("Pixel list must be a double vector");
+    }
+    pixelPtr = mxGetPr(PIXELS);
+    numListed = mxGetNumberOfElements(PIXELS);
+    for (k = 0; k < numListed; k++)
+    {
+      if (pixelPtr[k] < 1 || pixelPtr[k] > plan->M*plan->N ||
+          (k > 0 && pixelPtr[k] <= pixelPtr[k-1]))
+      {
+          mexErrMsgTxt("Pixel list must hold sorted linear indices of the image");
+      }
+    }
+  }
+
+  /* Work arrays are only reallocated when the stack grows */
+  if (plan->interpolation == LINEAR && numChannels > plan->numChannels)
+  {
+    if (plan->numChannels > 0)
+      freePixelBlocks(&plan->blocks);
+    allocPixelBlocks(&plan->blocks, plan->numPixels, numChannels);
+    plan->numChannels = numChannels;
+  }
+
+  /* Second out parameter? */
+  if (nlhs == 2)
+  {
+    R = mxCreateDoubleMatrix(plan->out.numBins, 1, mxREAL);
+    pr1 = mxGetPr(R);
+    for (k = 0; k < plan->out.numBins; k++)
+      *(pr1++) = (double) (plan->rFirst + plan->out.first + k);
+  }
+
+  setOutputStrides(&plan->out, plan->numAngles, numChannels);
+  if (plan->out.interleaved)
+  {
+    dims[0] = numChannels;
+    dims[1] = plan->out.numBins;
+    dims[2] = plan->numAngles;
+  }
+  else
+  {
+    dims[0] = plan->out.transposed ? plan->numAngles : plan->out.numBins;
+    dims[1] = plan->out.transposed ? plan->out.numBins : plan->numAngles;
+    dims[2] = numChannels;
+  }
+  if (mxIsComplex(I))
+  {
+    P = mxCreateNumericArray((numChannels > 1 || plan->out.interleaved) ? 3 : 2, dims, mxDOUBLE_CLASS, mxCOMPLEX);
+    execKernel(mxGetPr(P), mxGetPr(I), plan, numChannels, pixelPtr, numListed);
+    execKernel(mxGetPi(P), mxGetPi(I), plan, numChannels, pixelPtr, numListed);
+  }
+  else
+  {
+    P = mxCreateNumericArray((numChannels > 1 || plan->out.interleaved) ? 3 : 2, dims, mxDOUBLE_CLASS, mxREAL);
+    execKernel(mxGetPr(P), mxGetPr(I), plan, numChannels, pixelPtr, numListed);
+  }
+}
+
+static void
+destroyPlan(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  sinogramJPlan *plan;  /* plan to destroy */
+
+  if (nrhs != 2)
+  {
+      mexErrMsgTxt("Usage: sinogramJPlanc('destroy', id)");
+  }
+
+  plan = getPlan(ID);
+  plans[(int) mxGetScalar(ID) - 1] = NULL;
+  freePlan(plan);
+
+  if(--numActivePlans == 0)
+    mexUnlock();
+}
+
+static sinogramJPlan *
+getPlan(const mxArray *id)
+{
+  int k;                /* index into the table of plans */
+
+  if (!mxIsDouble(id) || mxGetNumberOfElements(id) != 1)
+  {
+      mexErrMsgTxt("Plan id must be a scalar");
+  }
+  k = (int) mxGetScalar(id) - 1;
+  if (k < 0 || k >= numPlans || plans[k] == NULL)
+  {
+      mexErrMsgTxt("Invalid or destroyed plan");
+  }
+  return plans[k];
+}
+
+static void
+freePlan(sinogramJPlan *plan)
+{
+  freeAngleGroups(&plan->groups);
+  free(plan->theta);
+  free(plan->xdistance);
+  free(plan->ydistance);
+  free(plan->pixelindices);
+  free(plan->pixelnumbers);
+  if (plan->numChannels > 0)
+    freePixelBlocks(&plan->blocks);
+  free(plan);
+}
+
+static void
+freeAllPlans(void)
+{
+  int k;
+
+  for(k=0;k<numPlans;++k)
+    if(plans[k] != NULL)
+      freePlan(plans[k]);
+  free(plans);
+  plans = NULL;
+  numPlans = 0;
+  numActivePlans = 0;
+}
+
+/** Gathers the contributing pixels of every block of images into the
+ *  pixel lists of the plan, see gatherPixelBlocks. With a list of pixels,
+ *  the listed pixels inside the circle contribute, otherwise the pixels
+ *  of the circle that are non-zero in at least one image of the block.
+ */
+static void
+gatherPlanPixels(sinogramJPlan *plan, const double *iPtr, int numChannels,
+                 const double *pixelPtr, int numListed)
+{
+  pixelBlocks *blocks = &plan->blocks;
+  int imageSize = plan->M * plan->N;
+  int k, i, c, cb;                               /* Loop variables */
+  int cFirst, nc;                                /* First image of a block and number of images */
+  int pixel;                                     /* Plan pixel of a listed pixel */
+  int isNonZero;                                 /* Does any image of the pixel contribute? */
+  int numActive;                                 /* Number of contributing pixels */
+  double scale = plan->out.scale;
+
+  blocks->numBlocks = (numChannels + CHANNEL_BLOCK - 1) / CHANNEL_BLOCK;
+
+#ifdef _OPENMP
+  #pragma omp parallel for private(k, i, c, cFirst, nc, pixel, isNonZero, numActive)
+#endif
+  for(cb=0;cb<blocks->numBlocks;++cb)
+  {
+    cFirst = cb*CHANNEL_BLOCK;
+    nc = MIN(CHANNEL_BLOCK, numChannels - cFirst);
+    numActive = 0;
+    for(k=0;k<((pixelPtr != NULL) ? numListed : plan->numPixels);++k)
+    {
+      if(pixelPtr != NULL)
+      {
+        pixel = plan->pixelnumbers[(int) pixelPtr[k] - 1];
+        if(pixel < 0)
+          continue;
+      }
+      else
+      {
+        pixel = k;
+        isNonZero = 0;
+        for(c=0;c<nc;++c)
+          isNonZero |= (iPtr[(cFirst + c)*imageSize + plan->pixelindices[pixel]] != 0);
+        if(!isNonZero)
+          continue;
+      }
+
+      i = plan->pixelindices[pixel];
+      blocks->xdistance[cb*blocks->blockSize + numActive] = plan->xdistance[pixel];
+      blocks->ydistance[cb*blocks->blockSize + numActive] = plan->ydistance[pixel];
+      for(c=0;c<nc;++c)
+        blocks->values[cFirst*blocks->blockSize + numActive*nc + c] = scale * iPtr[(cFirst + c)*imageSize + i];
+      ++numActive;
+    }
+    blocks->numPixels[cb] = numActive;
+  }
+}
+
+/* Projects a stack with the kernel of the plan, the output must be zero */
+static void
+execKernel(double *pPtr, const double *iPtr, sinogramJPlan *plan, int numChannels,
+           const double *pixelPtr, int numListed)
+{
+  if(plan->interpolation == RAY_DRIVEN)
+  {
+    sinogramJRay(pPtr, iPtr, plan->theta, plan->M, plan->N, plan->xOrigin, plan->yOrigin,
+                 plan->numAngles, plan->rSize, numChannels, &plan->out);
+  }
+  else
+  {
+    gatherPlanPixels(plan, iPtr, numChannels, pixelPtr, numListed);
+    projectPixelBlocks(pPtr, &plan->blocks, &plan->groups, plan->rFirst, numChannels, &plan->out);
+  }
+}
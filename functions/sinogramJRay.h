@@ -0,0 +1,273 @@
+/*-------------------------------------------------------------------*/
+/* Ray-driven Joseph projection with linear interpolation, filter 6  */
+/* of sinogramJ, shared by sinogramJc, sinogramJc_openmp,            */
+/* computeFusedPolyProjc and sinogramFanJc.                          */
+/*                                                                   */
+/* The pixels inside the circle are copied into zero padded lines    */
+/* along x and along y, then every angle steps through the lines     */
+/* that are the most perpendicular to its rays:                      */
+/*                                                                   */
+/*   columns = calloc(M*(N + 2*PAD), sizeof(double));                */
+/*   rows    = calloc(N*(M + 2*PAD), sizeof(double));                */
+/*   copyRayLines(columns, rows, image, M, N, xOrigin, yOrigin,      */
+/*                radius);                                           */
+/*   projectRays(column, binStride, first, numBins, columns, rows,   */
+/*               M, N, xOrigin, yOrigin, radius, rFirst, theta, 1);  */
+/*                                                                   */
+/* projectRays computes the detector elements r = b + rFirst of one  */
+/* angle, projectRay a single ray at any angle theta and projection  */
+/* coordinate r, e.g. the fan-beam ray with theta = beta + gamma and */
+/* r = L*sin(gamma). Both use the same bounds and interpolation. The */
+/* functions are reentrant, projectRays and projectRay may be called */
+/* for different rays from different threads. sinogramJRay projects  */
+/* a whole stack, with the angles in parallel under OpenMP.          */
+/*-------------------------------------------------------------------*/
+#ifndef SINOGRAMJ_RAY_H
+#define SINOGRAMJ_RAY_H
+
+#include <math.h>
+#include <stdlib.h>
+#include "sinogramJOutput.h"
+
+/* Zero padding at both ends of the image lines, the positions along a
+ * line stay in [-1, length], where PAD elements are sufficient */
+#define PAD 2
+
+/* Copies the pixels of an M x N image inside the circle of the given
+ * radius into the padded lines, the lines must be zero initialized */
+SINOGRAMJ_FUNCTION void
+copyRayLines(double *columns, double *rows, const double *image, int M, int N,
+             int xOrigin, int yOrigin, int radius)
+{
+  int x, y;
+  int xdist, ydist;
+  int columnLength = N + 2*PAD;
+  int rowLength    = M + 2*PAD;
+
+  for(y=0;y<M;++y)
+  {
+    for(x=0;x<N;++x)
+    {
+      ydist = x - xOrigin;
+      xdist = y - yOrigin;
+      if(xdist * xdist + ydist * ydist <= radius * radius)
+      {
+        columns[y*columnLength + PAD + x] = image[y*N + x];
+        rows[x*rowLength + PAD + y]       = image[y*N + x];
+      }
+    }
+  }
+}
+
+/* Range [uLow, uHigh] of the positions along a line of the given length
+ * at which a ray meets the pixels inside the circle, the line is nonzero
+ * at most halfwidth from origin. The range stays in [-1, length], where
+ * line[u_index] and line[u_index + 1] are in the padding. */
+SINOGRAMJ_FUNCTION void
+lineRange(int origin, double halfwidth, int length, double *uLow, double *uHigh)
+{
+  *uLow  = (origin - halfwidth - 1 > -1) ? origin - halfwidth - 1 : -1;
+  *uHigh = (origin + halfwidth + 1 < length) ? origin + halfwidth + 1 : length;
+}
+
+/* Linear interpolation in a padded line at the position u in [-1, length] */
+SINOGRAMJ_FUNCTION double
+interpolateLine(const double *line, double u)
+{
+  int u_index = ((int) (u + PAD)) - PAD;         /* Shifts u to positive values, to avoid using floor */
+  double fraction = u - u_index;
+
+  return line[u_index] + fraction*(line[u_index + 1] - line[u_index]);
+}
+
+/* Adds scale times the projection at angle theta (radians) of the lines
+ * to column[(b - first)*binStride], for the detector elements b = first
+ * .. first + numBins - 1. Element b lies at r = b + rFirst. */
+SINOGRAMJ_FUNCTION void
+projectRays(double *column, int binStride, int first, int numBins,
+            const double *columns, const double *rows, int M, int N,
+            int xOrigin, int yOrigin, int radius, int rFirst, double theta, double scale)
+{
+  int x, y, b;                                   /* Loop variables */
+  int xdist, ydist;                              /* Distance in carthesian coordinates to image center */
+  double angle, cosine, sine, slope;             /* Values for the angle */
+  const double *line;                            /* Current padded line */
+  double halfwidth;                              /* Half length of the line inside the circle */
+  double u0, du;                                 /* Position along the line and its step per element */
+  double uLow, uHigh;                            /* Range of positions that hit the line */
+  double bLow, bHigh;                            /* Range of detector elements that hit the line */
+  int bFirst, bLast;
+  int last = first + numBins - 1;
+
+  angle  = -theta;
+  cosine = cos(angle);
+  sine   = sin(angle);
+  slope  = scale/((fabs(cosine) > fabs(sine)) ? fabs(cosine) : fabs(sine));
+
+  if(fabs(sine) >= fabs(cosine))
+  {
+    /* Step through the columns, the ray of element b crosses column
+     * xdist at u = (b + rFirst - xdist*cosine)/sine + xOrigin */
+    du = 1/sine;
+    for(y=0;y<M;++y)
+    {
+      xdist = y - yOrigin;
+      if(abs(xdist) > radius)
+        continue;
+      halfwidth = sqrt((double) (radius * radius - xdist * xdist));
+      u0 = (rFirst - xdist*cosine)*du + xOrigin;
+      /* The circle may be wider than the image, u stays in [-1, N] */
+      lineRange(xOrigin, halfwidth, N, &uLow, &uHigh);
+      bLow  = (uLow - u0)*sine;
+      bHigh = (uHigh - u0)*sine;
+      bFirst = (int) ceil((bLow < bHigh) ? bLow : bHigh);
+      bLast  = (int) floor((bLow > bHigh) ? bLow : bHigh);
+      if(bFirst < first)
+        bFirst = first;
+      if(bLast > last)
+        bLast = last;
+      line = columns + y*(N + 2*PAD) + PAD;
+
+#ifdef _OPENMP
+      #pragma omp simd
+#endif
+      for(b=bFirst;b<=bLast;++b)
+        column[(b - first)*binStride] += slope*interpolateLine(line, u0 + b*du);
+    }
+  }
+  else
+  {
+    /* Step through the rows, the ray of element b crosses row
+     * ydist at u = (b + rFirst - ydist*sine)/cosine + yOrigin */
+    du = 1/cosine;
+    for(x=0;x<N;++x)
+    {
+      ydist = x - xOrigin;
+      if(abs(ydist) > radius)
+        continue;
+      halfwidth = sqrt((double) (radius * radius - ydist * ydist));
+      u0 = (rFirst - ydist*sine)*du + yOrigin;
+      lineRange(yOrigin, halfwidth, M, &uLow, &uHigh);
+      bLow  = (uLow - u0)*cosine;
+      bHigh = (uHigh - u0)*cosine;
+      bFirst = (int) ceil((bLow < bHigh) ? bLow : bHigh);
+      bLast  = (int) floor((bLow > bHigh) ? bLow : bHigh);
+      if(bFirst < first)
+        bFirst = first;
+      if(bLast > last)
+        bLast = last;
+      line = rows + x*(M + 2*PAD) + PAD;
+
+#ifdef _OPENMP
+      #pragma omp simd
+#endif
+      for(b=bFirst;b<=bLast;++b)
+        column[(b - first)*binStride] += slope*interpolateLine(line, u0 + b*du);
+    }
+  }
+}
+
+/* Line integral of the single ray at the angle theta (radians) and the
+ * projection coordinate r through the lines, with the bounds and the
+ * interpolation of projectRays. For rays that are not on a detector grid,
+ * e.g. the rays of a fan. */
+SINOGRAMJ_FUNCTION double
+projectRay(const double *columns, const double *rows, int M, int N,
+           int xOrigin, int yOrigin, int radius, double theta, double r)
+{
+  int x, y;                                      /* Loop variables */
+  int xdist, ydist;                              /* Distance in carthesian coordinates to image center */
+  double angle, cosine, sine;                    /* Values for the angle */
+  double halfwidth;                              /* Half length of the line inside the circle */
+  double u;                                      /* Position along the line */
+  double uLow, uHigh;                            /* Range of positions that hit the line */
+  double slope;
+  double sum = 0;
+
+  angle  = -theta;
+  cosine = cos(angle);
+  sine   = sin(angle);
+  slope  = 1/((fabs(cosine) > fabs(sine)) ? fabs(cosine) : fabs(sine));
+
+  if(fabs(sine) >= fabs(cosine))
+  {
+    /* The ray crosses column xdist at u = (r - xdist*cosine)/sine + xOrigin */
+    for(y=0;y<M;++y)
+    {
+      xdist = y - yOrigin;
+      if(abs(xdist) > radius)
+        continue;
+      halfwidth = sqrt((double) (radius * radius - xdist * xdist));
+      lineRange(xOrigin, halfwidth, N, &uLow, &uHigh);
+      u = (r - xdist*cosine)/sine + xOrigin;
+      if(u >= uLow && u <= uHigh)
+        sum += interpolateLine(columns + y*(N + 2*PAD) + PAD, u);
+    }
+  }
+  else
+  {
+    /* The ray crosses row ydist at u = (r - ydist*sine)/cosine + yOrigin */
+    for(x=0;x<N;++x)
+    {
+      ydist = x - xOrigin;
+      if(abs(ydist) > radius)
+        continue;
+      halfwidth = sqrt((double) (radius * radius - ydist * ydist));
+      lineRange(yOrigin, halfwidth, M, &uLow, &uHigh);
+      u = (r - ydist*sine)/cosine + yOrigin;
+      if(u >= uLow && u <= uHigh)
+        sum += interpolateLine(rows + x*(M + 2*PAD) + PAD, u);
+    }
+  }
+  return slope*sum;
+}
+
+/* Ray-driven (gather) version of sinogramJ. Each detector element is
+ * computed by stepping along its ray through the image columns or rows,
+ * depending on the slope, and interpolating linearly between the two
+ * nearest pixels. The weights are the same as in sinogramJ, but every
+ * output element is written once and the image is read sequentially, so
+ * the inner loop has no scatter and can be vectorized.
+ */
+SINOGRAMJ_FUNCTION void
+sinogramJRay(double *pPtr, const double *iPtr, const double *thetaPtr, int M, int N,
+    int xOrigin, int yOrigin, int numAngles, int rSize, int numChannels, const outputOptions *out)
+{
+  int k,c;                                       /* Loop variables */
+  int radius;                                    /* Radius of circle from which to use values */
+  int rFirst;                                    /* r-value of the first detector element */
+  double *columns, *rows;                        /* Padded copies of the image along x and along y */
+  int imageSize, sinogramSize;                   /* Strides between channels */
+
+  /* Only values in a circle will be used, the edges do not add anything */
+  radius = rSize/2;
+  rFirst = (1-rSize)/2;                          /* r-value of the first element, as in mexFunction */
+
+  imageSize    = M * N;
+  sinogramSize = out->channelStride;
+
+  columns = (double *)calloc (M * (N + 2*PAD), sizeof(double));
+  rows    = (double *)calloc (N * (M + 2*PAD), sizeof(double));
+
+  for(c=0;c<numChannels;++c)
+  {
+    /* Copy the pixels inside the circle, the rest of the lines stay zero */
+    copyRayLines(columns, rows, iPtr + c*imageSize, M, N, xOrigin, yOrigin, radius);
+
+    /* Calculate for every angle given as input*/
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for(k=0;k<numAngles;++k)
+    {
+      projectRays(pPtr + c*sinogramSize + k*out->angleStride, out->binStride, out->first,
+                  out->numBins, columns, rows, M, N, xOrigin, yOrigin, radius, rFirst,
+                  thetaPtr[k], out->scale);
+    }
+  }
+
+  free(columns);
+  free(rows);
+}
+
+#endif /* SINOGRAMJ_RAY_H */
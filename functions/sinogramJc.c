@@ -5,13 +5,17 @@
 /*                                                                   */
 /* Written by Maria Magnusson Seger 2003-04                          */
 /* Updated by Alexander Örtenberg   2015-04                          */
+/*                                                                   */
+/* The OpenMP MEX file sinogramJc_openmp is built from this source,  */
+/* see sinogramJc_openmp.c.                                          */
 /*-------------------------------------------------------------------*/
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include "mex.h"
-
-static void sinogramJ(double *pPtr, double *iPtr, double *thetaPtr, double *rinPtr,
-          int M, int N, int xOrigin, int yOrigin, int numAngles, int rFirst, 
-          int rSize, int interpolation);
+#include "sinogramJOutput.h"
+#include "sinogramJPixel.h"
+#include "sinogramJRay.h"
 
 static char rcs_id[] = "$Revision: 1.10 $";
 
@@ -20,11 +24,15 @@ static char rcs_id[] = "$Revision: 1.10 $";
 
 #define PI 3.14159265358979
 
+/* Interpolation type that selects the ray-driven (gather) kernel */
+#define RAY_DRIVEN 6
+
 /* Input Arguments */
 #define I      (prhs[0])
 #define THETA  (prhs[1])
 #define R_IN   (prhs[2])
 #define INTERP (prhs[3])
+#define OPTS   (prhs[4])
 
 /* Output Arguments */
 #define  P      (plhs[0])
@@ -36,22 +44,25 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   int numAngles;        /* number of theta values */
   int numProjval;       /* number of projection values */
   double *thetaPtr;     /* pointer to theta values in radians */
-  double *rinPtr;       /* pointer to projection coordinate array */
   double *pr1, *pr2;    /* help pointers used in loop */
   double deg2rad;       /* conversion factor */
   int k;                /* loop counter */
   int M, N;             /* input image size */
   int xOrigin, yOrigin; /* center of image */
-  int rFirst, rLast;    /* r-values for first and last row of output */
+  int rFirst;           /* r-value for the first row of output */
   int rSize;            /* number of rows in output */
   int interpolation;    /* interpolation type */
+  int numChannels;      /* number of images in the input stack */
+  const mwSize *dimPtr; /* dimensions of the input stack */
+  outputOptions out;    /* layout of the output */
+  mwSize dims[3];       /* dimensions of the output stack */
 
   /* Check validity of arguments */
   if (nrhs < 4)
   {
       mexErrMsgTxt("Too few input arguments");
   }
-  if (nrhs > 4)
+  if (nrhs > 5)
   {
       mexErrMsgTxt("Too many input arguments");
   }
@@ -79,163 +90,76 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
 
   /* Get R_IN values */
   numProjval = mxGetM(R_IN) * mxGetN(R_IN);
-  rinPtr = (double *) mxCalloc(numProjval, sizeof(double));
-  pr1 = mxGetPr(R_IN);
-  pr2 = rinPtr;
-  for (k = 0; k < numProjval; k++)
-    *(pr2++) = *(pr1++);
   
   rSize  = numProjval;
   
   rFirst = (1-rSize)/2;
-  rLast  = -rFirst;
 
   /* Get INTERP values */
   pr1 = mxGetPr(INTERP);
   interpolation = *pr1;
 
-  /* Get input image size */
-  M = mxGetM(I);
-  N = mxGetN(I);
+  /* Get input image size, an M x N x numChannels stack is projected at once */
+  dimPtr = mxGetDimensions(I);
+  M = dimPtr[0];
+  N = dimPtr[1];
+  numChannels = (M*N > 0) ? mxGetNumberOfElements(I) / (M*N) : 1;
 
   /* Where is the coordinate system's origin? */
   xOrigin = MAX(0, (N-1)/2);
   yOrigin = MAX(0, (M-1)/2);
 
+  /* Output window, layout and scale */
+  getOutputOptions((nrhs == 5) ? OPTS : NULL, rSize, numAngles, numChannels, &out);
+
   /* Second out parameter? */
   if (nlhs == 2)
   {
-    R = mxCreateDoubleMatrix(rSize, 1, mxREAL);
+    R = mxCreateDoubleMatrix(out.numBins, 1, mxREAL);
     pr1 = mxGetPr(R);
-    for (k = rFirst; k <= rLast; k++)
+    for (k = rFirst + out.first; k < rFirst + out.first + out.numBins; k++)
       *(pr1++) = (double) k;
   }
   
   /* Invoke main computation routines */
-  if (mxIsComplex(I))
+  if (out.interleaved)
   {
-    P = mxCreateDoubleMatrix(rSize, numAngles, mxCOMPLEX);
-    sinogramJ(mxGetPr(P), mxGetPr(I), thetaPtr, rinPtr, M, N, xOrigin, yOrigin, 
-       numAngles, rFirst, rSize, interpolation); 
-    sinogramJ(mxGetPi(P), mxGetPi(I), thetaPtr, rinPtr, M, N, xOrigin, yOrigin, 
-       numAngles, rFirst, rSize, interpolation);
+    dims[0] = numChannels;
+    dims[1] = out.numBins;
+    dims[2] = numAngles;
   }
   else
   {
-    P = mxCreateDoubleMatrix(rSize, numAngles, mxREAL);
-    sinogramJ(mxGetPr(P), mxGetPr(I), thetaPtr, rinPtr, M, N, xOrigin, yOrigin, 
-       numAngles, rFirst, rSize, interpolation);
+    dims[0] = out.transposed ? numAngles : out.numBins;
+    dims[1] = out.transposed ? out.numBins : numAngles;
+    dims[2] = numChannels;
   }
-}
-
-static void 
-sinogramJ(double *pPtr, double *iPtr, double *thetaPtr, double *rinPtr, int M, int N, 
-    int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize, int interpolation)
-{
-    
-  int x,y,k,i;                                   /* Loop variables */
-  int radius;                                    /* Radius of circle from which to use values */
-  double r;                                      /* Polar coordinate */
-  int r_index;                                   /* Polar coordinate as integer to index matrix */
-  double fraction;                               /* Fraction of the r coordinate */
-  
-  double pixelvalue, slopedpixelvalue;           /* Pixelvalue from input image and scaled version */
-  double leftpixel, rightpixel;                  /* Distribution for left and right pixel */
-  double distance, leftdistance, rightdistance;  /* Distance to left and right pixel */
-  
-  int *xdistance, *ydistance;                    /*Distance in carthesian coordinates to image center */
-  int *pixelindices;                             /* Store indices of pixels to calculate */
-  int xdist, ydist;                              /* temporary variables */
-  int pixelindex;                                /* Current index to store pixel data on */
-  double pixelradius;                            /* Radius of the pixel from center of the image */
-
-  /* Precalculate the values for all angles */
-  double angle;
-  double *cosine, *sine, *slope;
-  
-  cosine  = (double *) malloc(numAngles * sizeof(double));
-  sine    = (double *) malloc(numAngles * sizeof(double));
-  slope   = (double *) malloc(numAngles * sizeof(double));
-  
-  for(k=0;k< numAngles;++k)
+  if (mxIsComplex(I))
   {
-    angle    = -thetaPtr[k];
-    cosine[k] = cos(angle);
-    sine[k]   = sin(angle);
-    /* Calculate the slope depending on which angle value is larger */
-    slope[k]   = 1/MAX(fabs(cosine[k]), fabs(sine[k]));
-  }
-  
-  /* Only values in a circle will be used, the edges do not add anything */
-  radius = ceil(rSize/2);  
-  
-  xdistance    = (int *)malloc (sizeof(int) * M * N);
-  ydistance    = (int *)malloc (sizeof(int) * M * N);
-  pixelindices = (int *)malloc (sizeof(int) * M * N);
-  pixelindex   = 0;
-  
-  /** Checks for every pixel if it is within the radius of the unit circle
-   *  and if it is a non-zero value. Only store its index and values if it
-   *  passes both checks, or it does not contribute
-   */
-  for(y=0;y<M;++y)
-  {    
-    for(x=0;x<N;++x)
-    {
-      ydist = x - xOrigin;
-      xdist = y - yOrigin;
-      pixelradius = sqrt(xdist * xdist + ydist * ydist);
-      
-      if((iPtr[y*M + x] != 0) && (pixelradius <= radius))
-      {
-        ydistance[pixelindex] = ydist;
-        xdistance[pixelindex] = xdist;
-        pixelindices[pixelindex] = y*N+x;
-        ++pixelindex;
-      }
-    }
+    P = mxCreateNumericArray((numChannels > 1 || out.interleaved) ? 3 : 2, dims, mxDOUBLE_CLASS, mxCOMPLEX);
+    if (interpolation == RAY_DRIVEN)
+      sinogramJRay(mxGetPr(P), mxGetPr(I), thetaPtr, M, N, xOrigin, yOrigin,
+         numAngles, rSize, numChannels, &out);
+    else
+      sinogramJ(mxGetPr(P), mxGetPr(I), thetaPtr, M, N, xOrigin, yOrigin,
+         numAngles, rFirst, rSize, numChannels, &out); 
+    if (interpolation == RAY_DRIVEN)
+      sinogramJRay(mxGetPi(P), mxGetPi(I), thetaPtr, M, N, xOrigin, yOrigin,
+         numAngles, rSize, numChannels, &out);
+    else
+      sinogramJ(mxGetPi(P), mxGetPi(I), thetaPtr, M, N, xOrigin, yOrigin,
+         numAngles, rFirst, rSize, numChannels, &out);
   }
-
-  /* Calculate for every angle given as input*/
-  for(k=0;k<numAngles;++k)
+  else
   {
-    /* Calculate for all pixels that will contribute */
-    for(i=0;i<pixelindex;++i)
-    {
-      /* Inside the circle, get the pixel value */
-      pixelvalue = iPtr[pixelindices[i]];
-          
-      /* Find the index for the radial coordinates */
-      r = xdistance[i]*cosine[k] + ydistance[i]*sine[k];          
-      r += xOrigin;   /* add xOrigin to shift center of image, avoiding negative values */
-      r_index = (int) r;  
-      fraction = r - r_index;
-
-      /* Get the pixel value and distribute between two pixels
-       * Calculates the distance once as it is used multiple times
-       * The slope is dependent on the angle, decreasing the
-       * triangle size */
-      distance = fraction*slope[k];
-      /* No contribution if the distance is less than 0 */
-      /* Equal to 
-       * (1 - fraction*slope[k]) and
-       * (1 - (1 - fraction) * slope[k])*/
-      leftdistance  = MAX(0, (1 - distance));
-      rightdistance = MAX(0, (1 + distance - slope[k]));
-  
-      slopedpixelvalue = pixelvalue * slope[k];
-      leftpixel  = leftdistance  * slopedpixelvalue;
-      rightpixel = rightdistance * slopedpixelvalue;
-
-      pPtr[k*M + r_index] += leftpixel;
-      pPtr[k*M + r_index + 1] += rightpixel;
-    }
+    P = mxCreateNumericArray((numChannels > 1 || out.interleaved) ? 3 : 2, dims, mxDOUBLE_CLASS, mxREAL);
+    if (interpolation == RAY_DRIVEN)
+      sinogramJRay(mxGetPr(P), mxGetPr(I), thetaPtr, M, N, xOrigin, yOrigin,
+         numAngles, rSize, numChannels, &out);
+    else
+      sinogramJ(mxGetPr(P), mxGetPr(I), thetaPtr, M, N, xOrigin, yOrigin,
+         numAngles, rFirst, rSize, numChannels, &out);
   }
 
-  free(xdistance);
-  free(ydistance);
-  free(pixelindices);
-  free(cosine);
-  free(sine);
-  free(slope);
+  mxFree(thetaPtr);
 }
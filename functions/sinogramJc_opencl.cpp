@@ -14,7 +14,7 @@
 #include <CL/cl.h>
 #include "mex.h"
 
-static void sinogramJ(double *pPtr, double *iPtr, double *thetaPtr, double *rinPtr,
+static void sinogramJ(double *pPtr, const double *iPtr, const double *thetaPtr, const double *rinPtr,
           int M, int N, int xOrigin, int yOrigin, int numAngles, int rFirst, 
           int rSize, int interpolation);
 
@@ -39,7 +39,7 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
   int numAngles;        /* number of theta values */
   int numProjval;       /* number of projection values */
   double *thetaPtr;     /* pointer to theta values in radians */
-  double *rinPtr;       /* pointer to projection coordinate array */
+  const double *rinPtr; /* view of the projection coordinates */
   double *pr1, *pr2;    /* help pointers used in loop */
   double deg2rad;       /* conversion factor */
   int k;                /* loop counter */
@@ -82,11 +82,7 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
 
   /* Get R_IN values */
   numProjval = mxGetM(R_IN) * mxGetN(R_IN);
-  rinPtr = (double *) mxCalloc(numProjval, sizeof(double));
-  pr1 = mxGetPr(R_IN);
-  pr2 = rinPtr;
-  for (k = 0; k < numProjval; k++)
-    *(pr2++) = *(pr1++);
+  rinPtr = mxGetPr(R_IN);
   
   rSize  = numProjval;
   
@@ -129,10 +125,12 @@ mexFunction(int nlhs, mxArray  *plhs[], int nrhs, const mxArray  *prhs[])
     sinogramJ(mxGetPr(P), mxGetPr(I), thetaPtr, rinPtr, M, N, xOrigin, yOrigin, 
        numAngles, rFirst, rSize, interpolation);
   }
+
+  mxFree(thetaPtr);
 }
 
 static void 
-sinogramJ(double *pPtr, double *iPtr, double *thetaPtr, double *rinPtr, int M, int N, 
+sinogramJ(double *pPtr, const double *iPtr, const double *thetaPtr, const double *rinPtr, int M, int N, 
     int xOrigin, int yOrigin, int numAngles, int rFirst, int rSize, int interpolation)
 {
   int x,y,k;                                     /* Loop variables */
@@ -289,7 +287,7 @@ sinogramJ(double *pPtr, double *iPtr, double *thetaPtr, double *rinPtr, int M, i
   kernel_sinogramJ = clCreateKernel(program_sinogramJ, "sinogramJ", &error);
   
   /* Create buffers for data */
-  IMG_input   = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * M * N, iPtr, NULL);
+  IMG_input   = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(double) * M * N, (void *) iPtr, NULL);
   IDX_input   = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(int) * M * N, pixelindices, NULL);
   XDIS_input  = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(int) * M * N, xdistance, NULL);
   YDIS_input  = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,  sizeof(int) * M * N, ydistance, NULL);
@@ -0,0 +1,151 @@
+% Test the polychromatic projections: compressSpectrum, the C functions
+% computePolyProjc, computePolyProjc_openmp and computePolyProjc_simd and
+% the table lookup of computePolyProjLUTc. The C functions must be
+% compiled. A failed test reports 'failed', otherwise 'OK' is reported.
+%
+% Usage:
+% >> t_computePolyProj
+% 001: OK
+% ...
+% 006: OK
+
+geps = 1e-10; % Global epsilon, relative to the largest projection
+
+global useCode
+oldUseCode = useCode;
+
+% LACs (1/cm) of 8 base materials made of a photoelectric and a Compton
+% part, row E is the LAC at E keV
+Ev = (1:80)';
+a = [0.02 0.15 0.9 0.05 0.4 0.1 0.6 0.3];
+b = [0.18 0.20 0.25 0.19 0.22 0.17 0.21 0.23];
+mu = (30./Ev).^3 * a + (Ev/30).^-0.25 * b;
+ELow = (20:60)';
+NLow = ELow .* (61 - ELow);
+uLow = sum(ELow .* NLow);
+EHigh = (30:80)';
+NHigh = EHigh .* (81 - EHigh);
+uHigh = sum(EHigh .* NHigh);
+
+% Line integrals (m) of 3 materials, the total line integral of a ray is
+% at most lmax
+lmax = 0.2;
+Nd = 37;
+Np = 23;
+rand('state', 1);
+p = lmax * rand(Nd, Np, 3) / 3;
+pi3 = permute(p, [3 1 2]);          % interleaved layout
+
+% 001 Test that the compressed spectrum keeps uE and gives Ap within tol
+useCode = 0;
+ok = true;
+for tol = [1e-3 1e-4]
+  [Ec, Nc, muc, err] = compressSpectrum(ELow, NLow, mu(:, 1:3), tol, lmax);
+  t_Ap = computePolyProj(ELow, uLow, NLow, p, mu(:, 1:3));
+  Ap = computePolyProj(Ec, uLow, Nc, p, muc);
+  ok = ok && length(Ec) < length(ELow) && err <= tol &&...
+    abs(sum(Ec .* Nc) - uLow) < geps*uLow && max(abs(Ap(:) - t_Ap(:))) < tol;
+end
+if (ok)
+  disp('001: OK');
+else
+  disp('001: failed');
+end
+
+% 002 Test computePolyProjc and computePolyProjc_openmp against the
+% Matlab code
+useCode = 0;
+t_Ap = computePolyProj(ELow, uLow, NLow, p, mu(:, 1:3));
+Ap1 = computePolyProjc(ELow, uLow, NLow, p, mu(:, 1:3));
+Ap2 = computePolyProjc_openmp(ELow, uLow, NLow, p, mu(:, 1:3));
+if (max(abs(Ap1(:) - t_Ap(:))) < geps*max(abs(t_Ap(:))) &&...
+    max(abs(Ap2(:) - t_Ap(:))) < geps*max(abs(t_Ap(:))))
+  disp('002: OK');
+else
+  disp('002: failed');
+end
+
+% 003 Test computePolyProjc_simd against computePolyProjc for the
+% specialized and the general numbers of materials, in both layouts
+ok = true;
+for Ntbm = 2:8
+  pm = lmax * rand(Nd, Np, Ntbm) / Ntbm;
+  t_Ap = computePolyProjc(ELow, uLow, NLow, pm, mu(:, 1:Ntbm));
+  Ap = computePolyProjc_simd(ELow, uLow, NLow, pm, mu(:, 1:Ntbm));
+  ok = ok && max(abs(Ap(:) - t_Ap(:))) < geps*max(abs(t_Ap(:)));
+  Ap = computePolyProjc_simd(ELow, uLow, NLow, permute(pm, [3 1 2]),...
+    mu(:, 1:Ntbm), 'interleaved');
+  ok = ok && max(abs(Ap(:) - t_Ap(:))) < geps*max(abs(t_Ap(:)));
+end
+if (ok)
+  disp('003: OK');
+else
+  disp('003: failed');
+end
+
+% 004 Test that the 'interleaved' layout gives the projections of the
+% 'bins' layout, for one and two spectra
+ok = true;
+for f = {@computePolyProjc, @computePolyProjc_openmp, @computePolyProjc_simd}
+  t_Ap = f{1}(ELow, uLow, NLow, p, mu(:, 1:3));
+  Ap = f{1}(ELow, uLow, NLow, pi3, mu(:, 1:3), 'interleaved');
+  ok = ok && isequal(size(Ap), [Nd Np]) &&...
+    max(abs(Ap(:) - t_Ap(:))) < geps*max(abs(t_Ap(:)));
+  [t_ApLow, t_ApHigh] = f{1}(ELow, EHigh, uLow, uHigh, NLow, NHigh, p,...
+    mu(:, 1:3), mu(:, 1:3));
+  [ApLow, ApHigh] = f{1}(ELow, EHigh, uLow, uHigh, NLow, NHigh, pi3,...
+    mu(:, 1:3), mu(:, 1:3), 'interleaved');
+  ok = ok && max(abs(ApLow(:) - t_ApLow(:))) < geps*max(abs(t_ApLow(:))) &&...
+    max(abs(ApHigh(:) - t_ApHigh(:))) < geps*max(abs(t_ApHigh(:)));
+end
+if (ok)
+  disp('004: OK');
+else
+  disp('004: failed');
+end
+
+% 005 Test that both spectra in one pass of computePolyProjc_simd give
+% the projections of computePolyProjc
+t_ApLow = computePolyProjc(ELow, uLow, NLow, p, mu(:, 1:3));
+t_ApHigh = computePolyProjc(EHigh, uHigh, NHigh, p, mu(:, 1:3));
+[ApLow, ApHigh] = computePolyProjc_simd(ELow, EHigh, uLow, uHigh, NLow,...
+  NHigh, p, mu(:, 1:3), mu(:, 1:3));
+if (max(abs(ApLow(:) - t_ApLow(:))) < geps*max(abs(t_ApLow(:))) &&...
+    max(abs(ApHigh(:) - t_ApHigh(:))) < geps*max(abs(t_ApHigh(:))))
+  disp('005: OK');
+else
+  disp('005: failed');
+end
+
+% 006 Test the table lookup of computePolyProjLUTc against
+% computePolyProjc. The interpolation error inside the tables is below
+% 1e-3, rays outside the tables are computed exactly. The C code must
+% interpolate as the Matlab code.
+lut = createPolyProjLUT(ELow, EHigh, uLow, uHigh, NLow, NHigh, mu(:, 1:3),...
+  mu(:, 1:3), lmax);
+pOut = p;
+pOut(1:5, :, :) = 2*lmax;           % outside the tables
+t_ApLow = computePolyProjc(ELow, uLow, NLow, pOut, mu(:, 1:3));
+t_ApHigh = computePolyProjc(EHigh, uHigh, NHigh, pOut, mu(:, 1:3));
+useCode = 0;
+[mApLow, mApHigh] = computePolyProjLUT(lut, pOut);
+useCode = 1;
+[ApLow, ApHigh] = computePolyProjLUT(lut, pOut);
+[iApLow, iApHigh] = computePolyProjLUT(lut, permute(pOut, [3 1 2]),...
+  'interleaved');
+inside = 6:Nd;
+outside = 1:5;
+ok = max(max(abs(ApLow(inside, :) - t_ApLow(inside, :)))) < 1e-3 &&...
+  max(max(abs(ApHigh(inside, :) - t_ApHigh(inside, :)))) < 1e-3 &&...
+  max(max(abs(ApLow(outside, :) - t_ApLow(outside, :)))) < geps*max(abs(t_ApLow(:))) &&...
+  max(max(abs(ApHigh(outside, :) - t_ApHigh(outside, :)))) < geps*max(abs(t_ApHigh(:))) &&...
+  max(abs(ApLow(:) - mApLow(:))) < geps*max(abs(mApLow(:))) &&...
+  max(abs(ApHigh(:) - mApHigh(:))) < geps*max(abs(mApHigh(:))) &&...
+  isequal(iApLow, ApLow) && isequal(iApHigh, ApHigh);
+if (ok)
+  disp('006: OK');
+else
+  disp('006: failed');
+end
+
+useCode = oldUseCode;
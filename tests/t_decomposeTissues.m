@@ -0,0 +1,156 @@
+% Test decomposeTissues against the decomposition of every tissue with MD2
+% and MD3. The C functions MD2c, MD3c and decomposeTissuesc must be
+% compiled. A failed test reports 'failed', otherwise 'OK' is reported.
+%
+% Usage:
+% >> t_decomposeTissues
+% 001: OK
+% ...
+% 005: OK
+
+geps = 1e-10; % Global epsilon, relative to the largest value
+
+global useCode
+oldUseCode = useCode;
+
+% Measured LACs (1/cm) around the tabulated LACs of soft tissues, on a
+% square image as MD2c and MD3c require
+M = 40;
+N = 40;
+rand('state', 1);
+AttE1mat = 0.19 + 0.1*rand(M, N);
+AttE2mat = 0.16 + 0.07*rand(M, N);
+AttE1mat(1:4, 1:4) = 0;             % vacuum, see isSpecial of MD3
+AttE2mat(1:4, 1:4) = 0;
+
+% Two doublets and two triplets with overlapping masks
+Att2 = {[0.2280 0.2814; 0.1810 0.2271], [0.2270 0.3500; 0.1772 0.2600]};
+Dens2 = {[1.06 1.35], [1.00 1.92]};
+Att3 = {[0.1909 0.2814 0.2270; 0.1602 0.2271 0.1772],...
+        [0.2270 0.2814 0.3500; 0.1772 0.2271 0.2600]};
+Dens3 = {[0.92 1.35 1.00], [1.00 1.35 1.92]};
+[x, y] = meshgrid(1:N, 1:M);
+tissue2 = {x < 20 & y > 4, (x + y) > 45};   % MD2 is singular in vacuum
+tissue3 = {(x - 17).^2 + (y - 20).^2 < 15^2, y < 12};
+[index2, pixels2] = maskIndices(tissue2);
+[index3, pixels3] = maskIndices(tissue3);
+
+% Reference decomposition, every tissue on its own
+for isSpecial = 0:1
+  for code = 0:2
+    useCode = code;
+    for id = 1:2
+      [t_Wei2{isSpecial+1, code+1, id}, t_dens{isSpecial+1, code+1, id}] =...
+        MD2(AttE1mat, AttE2mat, Att2{id}, Dens2{id}, tissue2{id});
+    end
+    for it = 1:2
+      t_Wei3{isSpecial+1, code+1, it} = MD3(AttE1mat, AttE2mat, Att3{it},...
+        Dens3{it}, tissue3{it}, isSpecial);
+    end
+  end
+end
+
+% 001 Test that the masks give the mass fractions and densities of MD2 and
+% MD3, for the Matlab, C and OpenMP code
+ok = true;
+for isSpecial = 0:1
+  for code = 0:2
+    useCode = code;
+    [Wei2, dens, Wei3] = decomposeTissues(AttE1mat, AttE2mat, Att2, Dens2,...
+      tissue2, Att3, Dens3, tissue3, isSpecial);
+    for id = 1:2
+      t_W = t_Wei2{isSpecial+1, code+1, id}(:, :, 1:2);
+      W = Wei2{id}(:, :, 1:2);
+      ok = ok && max(abs(W(:) - t_W(:))) < geps*max(abs(t_W(:)));
+      t_d = t_dens{isSpecial+1, code+1, id};
+      ok = ok && max(abs(dens{id}(:) - t_d(:))) < geps*max(abs(t_d(:)));
+    end
+    for it = 1:2
+      t_W = t_Wei3{isSpecial+1, code+1, it};
+      ok = ok && max(abs(Wei3{it}(:) - t_W(:))) < geps*max(abs(t_W(:)));
+    end
+  end
+end
+if (ok)
+  disp('001: OK');
+else
+  disp('001: failed');
+end
+
+% 002 Test that the index lists of maskIndices give the result of the
+% masks
+ok = isequal(pixels2, find(tissue2{1} | tissue2{2})) &&...
+  isequal(pixels3, find(tissue3{1} | tissue3{2}));
+for code = 0:2
+  useCode = code;
+  [Wei2, dens, Wei3, dens3, Vol] = decomposeTissues(AttE1mat, AttE2mat,...
+    Att2, Dens2, tissue2, Att3, Dens3, tissue3, 1);
+  [iWei2, idens, iWei3, idens3, iVol] = decomposeTissues(AttE1mat, AttE2mat,...
+    Att2, Dens2, index2, Att3, Dens3, index3, 1);
+  ok = ok && isequal(iWei2, Wei2) && isequal(idens, dens) &&...
+    isequal(iWei3, Wei3) && isequal(idens3, dens3) && isequal(iVol, Vol);
+end
+if (ok)
+  disp('002: OK');
+else
+  disp('002: failed');
+end
+
+% 003 Test the triplet densities dens3 against computeDensityMd3
+ok = true;
+for code = 0:2
+  useCode = code;
+  [Wei2, dens, Wei3, dens3] = decomposeTissues(AttE1mat, AttE2mat, Att2,...
+    Dens2, index2, Att3, Dens3, index3, 1);
+  for it = 1:2
+    t_d = computeDensityMd3(t_Wei3{2, code+1, it}, Dens3{it});
+    ok = ok && max(abs(dens3{it}(:) - t_d(:))) < geps*max(abs(t_d(:)));
+  end
+end
+if (ok)
+  disp('003: OK');
+else
+  disp('003: failed');
+end
+
+% 004 Test the volume fractions Vol, v_i = w_i*rho/rho_i with the doublets
+% first
+ok = true;
+for code = 0:2
+  useCode = code;
+  [Wei2, dens, Wei3, dens3, Vol] = decomposeTissues(AttE1mat, AttE2mat,...
+    Att2, Dens2, index2, Att3, Dens3, index3, 1);
+  ok = ok && isequal(size(Vol), [M N 10]);
+  for id = 1:2
+    for i = 1:2
+      t_V = t_Wei2{2, code+1, id}(:, :, i) .* t_dens{2, code+1, id} / Dens2{id}(i);
+      V = Vol(:, :, 2*(id-1) + i);
+      ok = ok && max(abs(V(:) - t_V(:))) < geps*max(abs(t_V(:)));
+    end
+  end
+  for it = 1:2
+    t_d = computeDensityMd3(t_Wei3{2, code+1, it}, Dens3{it});
+    for i = 1:3
+      t_V = t_Wei3{2, code+1, it}(:, :, i) .* t_d / Dens3{it}(i);
+      V = Vol(:, :, 4 + 3*(it-1) + i);
+      ok = ok && max(abs(V(:) - t_V(:))) < geps*max(abs(t_V(:)));
+    end
+  end
+end
+if (ok)
+  disp('004: OK');
+else
+  disp('004: failed');
+end
+
+% 005 Test that the C code rejects unsorted index lists
+useCode = 1;
+try
+  decomposeTissues(AttE1mat, AttE2mat, Att2(1), Dens2(1),...
+    {flipud(index2{1})}, {}, {}, {}, 0);
+  disp('005: failed');
+catch
+  disp('005: OK');
+end
+
+useCode = oldUseCode;
@@ -0,0 +1,114 @@
+% Test inverseRadon.m against iradon. The C functions filterProjectionsc,
+% backprojectc, backprojectHierc and griddingReconstructc must be
+% compiled. A failed test reports 'failed', otherwise 'OK' is reported.
+%
+% Usage:
+% >> t_inverseRadon
+% 001: OK
+% ...
+% 009: OK
+
+geps = 1e-10; % Global epsilon, relative to the largest pixel value
+
+global useCode
+oldUseCode = useCode;
+useCode = 2;
+
+P = phantom(128);
+degVec = 0:179;
+p = radon(P, degVec);   % odd length of the projections
+
+% 001 Test linear interpolation with the Hann filter, as in DIRA
+t_img = iradon(p, degVec, 'linear', 'Hann', 1, 128);
+img = inverseRadon(p, degVec, 'linear', 'Hann', 1, 128);
+if (max(abs(img(:) - t_img(:))) < geps*max(abs(t_img(:))))
+  disp('001: OK');
+else
+  disp('001: failed');
+end
+
+% 002 Test the Ram-Lak filter and an image larger than the projections
+t_img = iradon(p, degVec, 'linear', 'Ram-Lak', 1, 200);
+img = inverseRadon(p, degVec, 'linear', 'Ram-Lak', 1, 200);
+if (max(abs(img(:) - t_img(:))) < geps*max(abs(t_img(:))))
+  disp('002: OK');
+else
+  disp('002: failed');
+end
+
+% 003 Test nearest interpolation, the Shepp-Logan filter and frequency
+% scaling
+t_img = iradon(p, degVec, 'nearest', 'Shepp-Logan', 0.7, 127);
+img = inverseRadon(p, degVec, 'nearest', 'Shepp-Logan', 0.7, 127);
+if (max(abs(img(:) - t_img(:))) < geps*max(abs(t_img(:))))
+  disp('003: OK');
+else
+  disp('003: failed');
+end
+
+% 004 Test an even length of the projections and an odd number of angles
+pEven = p(2:end, 1:3:end);
+degEven = degVec(1:3:end);
+t_img = iradon(pEven, degEven, 'linear', 'Hamming', 0.9, 128);
+img = inverseRadon(pEven, degEven, 'linear', 'Hamming', 0.9, 128);
+if (max(abs(img(:) - t_img(:))) < geps*max(abs(t_img(:))))
+  disp('004: OK');
+else
+  disp('004: failed');
+end
+
+% 005 Test the frequency response of the filter
+[~, t_H] = iradon(p, degVec, 'linear', 'Cosine', 0.8, 128);
+[~, H] = inverseRadon(p, degVec, 'linear', 'Cosine', 0.8, 128);
+if (numel(H) == numel(t_H) && max(abs(H(:) - t_H(:))) < geps)
+  disp('005: OK');
+else
+  disp('005: failed');
+end
+
+% 006 Test a stack of two sinograms, backprojected in one sweep
+p2 = radon(0.5*P', degVec);
+t_img = cat(3, inverseRadon(p, degVec, 'linear', 'Hann', 1, 128),...
+  inverseRadon(p2, degVec, 'linear', 'Hann', 1, 128));
+img = inverseRadon(cat(3, p, p2), degVec, 'linear', 'Hann', 1, 128);
+if (isequal(size(img), [128 128 2]) && isequal(img, t_img))
+  disp('006: OK');
+else
+  disp('006: failed');
+end
+
+% 007 Test the hierarchical backprojection against the direct one
+t_img = inverseRadon(p, degVec, 'linear', 'Hann', 1, 128);
+img = inverseRadon(p, degVec, 'linear', 'Hann', 1, 128, 0.25);
+if (sqrt(mean((img(:) - t_img(:)).^2)) < 0.05*sqrt(mean(t_img(:).^2)))
+  disp('007: OK');
+else
+  disp('007: failed');
+end
+
+% 008 Test the gridding reconstruction of a stack against the filtered
+% backprojection
+t_img = inverseRadon(cat(3, p, p2), degVec, 'linear', 'Hann', 1, 128);
+img = griddingReconstructc(cat(3, p, p2), pi*degVec/180, 128, 'Hann', 1);
+if (isequal(size(img), size(t_img)) &&...
+    sqrt(mean((img(:) - t_img(:)).^2)) < 0.05*sqrt(mean(t_img(:).^2)))
+  disp('008: OK');
+else
+  disp('008: failed');
+end
+
+% 009 Test that the hierarchical backprojection with the accuracy 0 is
+% the direct one, for nearest and linear interpolation
+ok = true;
+for interp = {'nearest', 'linear'}
+  t_img = inverseRadon(p, degVec, interp{1}, 'Hann', 1, 128);
+  img = inverseRadon(p, degVec, interp{1}, 'Hann', 1, 128, 0);
+  ok = ok && max(abs(img(:) - t_img(:))) < geps*max(abs(t_img(:)));
+end
+if (ok)
+  disp('009: OK');
+else
+  disp('009: failed');
+end
+
+useCode = oldUseCode;
@@ -0,0 +1,80 @@
+% Test the C filtering of projectionFilterc against ramp.m, rampwindow.m
+% and rampwindowMtf.m. projectionFilterc must be compiled. A failed test
+% reports 'failed', otherwise 'OK' is reported.
+%
+% Usage:
+% >> t_projectionFilter
+% 001: OK
+% ...
+% 005: OK
+
+geps = 1e-10; % Global epsilon, relative to the largest filtered value
+
+global useCode
+oldUseCode = useCode;
+
+p = radon(phantom(256), 0:179);
+rVec = (1:size(p, 1)) - ceil(size(p, 1)/2);
+
+% 001 Test the ramp filter of ramp.m, with and without dalfa
+useCode = 0;
+t_q1 = ramp(p);
+t_q2 = ramp(p, 0.001);
+useCode = 2;
+q1 = ramp(p);
+q2 = ramp(p, 0.001);
+if (max(abs(q1(:) - t_q1(:))) < geps*max(abs(t_q1(:))) &&...
+    max(abs(q2(:) - t_q2(:))) < geps*max(abs(t_q2(:))))
+  disp('001: OK');
+else
+  disp('001: failed');
+end
+
+% 002 Test the cos^4 window of rampwindow.m
+useCode = 0;
+t_q = rampwindow(p, rVec, 'Cosine', 4);
+useCode = 2;
+q = rampwindow(p, rVec, 'Cosine', 4);
+if (max(abs(q(:) - t_q(:))) < geps*max(abs(t_q(:))))
+  disp('002: OK');
+else
+  disp('002: failed');
+end
+
+% 003 Test that a cached filter gives the same result
+q2 = rampwindow(p, rVec, 'Cosine', 4);
+if (isequal(q, q2))
+  disp('003: OK');
+else
+  disp('003: failed');
+end
+
+% 004 Test the MTF window of rampwindowMtf.m, 2*len is not a power of 2
+oldDir = pwd;
+cd(tempdir);
+MTF = [linspace(0, 8, 40)', exp(-linspace(0, 8, 40)'/3)];
+save('MTF.dat', 'MTF', '-ascii', '-double');
+useCode = 0;
+t_q = rampwindowMtf(p, rVec/16, 2);
+useCode = 2;
+q = rampwindowMtf(p, rVec/16, 2);
+delete('MTF.dat');
+cd(oldDir);
+if (max(abs(q(:) - t_q(:))) < geps*max(abs(t_q(:))))
+  disp('004: OK');
+else
+  disp('004: failed');
+end
+
+% 005 Test an odd cos^n window of rampwindow.m for an odd length
+useCode = 0;
+t_q = rampwindow(p(1:end-2, :), rVec(1:end-2), 'Cosine', 1);
+useCode = 2;
+q = rampwindow(p(1:end-2, :), rVec(1:end-2), 'Cosine', 1);
+if (max(abs(q(:) - t_q(:))) < geps*max(abs(t_q(:))))
+  disp('005: OK');
+else
+  disp('005: failed');
+end
+
+useCode = oldUseCode;
@@ -0,0 +1,114 @@
+% Test sinogramJ and its plans with more detector elements than image
+% pixels, and the fan-beam rays of sinogramFanJc. The C and OpenMP code
+% must be compiled. A failed test reports 'failed', otherwise 'OK' is
+% reported.
+%
+% Usage:
+% >> t_sinogramJ
+% 001: OK
+% ...
+% 006: OK
+
+geps = 1e-10; % Global epsilon, relative to the largest projected value
+
+global useCode
+oldUseCode = useCode;
+
+N = 31;
+rVec = -24:24;                      % numel(rVec) > size(I)
+degVec = (0:179) + 0.3;
+[x, y] = meshgrid((1:N) - (N+1)/2);
+I = double(x.^2 + y.^2 < 12^2);     % Disc centred on the image
+I(5, 7) = 1;                        % and a pixel out of the centre
+
+% 001 Test that the ray-driven filter 6 equals the pixel-driven filter 2,
+% the rays that pass outside the image must not read outside the image
+ok = true;
+for code = 1:2
+  useCode = code;
+  P2 = sinogramJ(I, degVec, rVec, 2);
+  P6 = sinogramJ(I, degVec, rVec, 6);
+  ok = ok && max(abs(P6(:) - P2(:))) < geps*max(abs(P2(:)));
+end
+if (ok)
+  disp('001: OK');
+else
+  disp('001: failed');
+end
+
+% 002 Test that the projection is centred on rVec, the projection of the
+% centred disc is symmetric
+ok = true;
+I(5, 7) = 0;
+for code = 1:2
+  useCode = code;
+  for filter = [2 6]
+    P = sinogramJ(I, degVec, rVec, filter);
+    ok = ok && max(max(abs(P - flipud(P)))) < geps*max(abs(P(:)));
+  end
+end
+if (ok)
+  disp('002: OK');
+else
+  disp('002: failed');
+end
+
+% 003 Test the fused projection of computeFusedPolyProjc, the
+% monoenergetic projection of one material with unit attenuation and
+% 100*pixsiz = 1 is the projection of sinogramJ
+useCode = 1;
+E = [40; 60];
+mu = zeros(100, 2);
+[ApLow, ApHigh, MLow] = computeFusedPolyProjc(cat(3, I, rot90(I)), degVec,...
+  rVec, 0.01, E, E, 100, 100, [1; 1], [1; 1], mu, mu, [1 0], [1 0]);
+P = sinogramJ(I, degVec, rVec, 2);
+if (max(abs(MLow(:) - P(:))) < geps*max(abs(P(:))))
+  disp('003: OK');
+else
+  disp('003: failed');
+end
+
+% 004 Test that the plans use the filter, for the C and OpenMP code
+ok = true;
+for code = 1:2
+  useCode = code;
+  for filter = [2 6]
+    plan = sinogramJPlan(size(I), degVec, rVec, filter);
+    P = sinogramJExec(plan, I);
+    sinogramJDestroy(plan);
+    t_P = sinogramJ(I, degVec, rVec, filter);
+    ok = ok && max(abs(P(:) - t_P(:))) < geps*max(abs(t_P(:)));
+  end
+end
+if (ok)
+  disp('004: OK');
+else
+  disp('004: failed');
+end
+
+% 005 Test that the plans reject the filters they do not support
+try
+  plan = sinogramJPlan(size(I), degVec, rVec, 3);
+  sinogramJDestroy(plan);
+  disp('005: failed');
+catch
+  disp('005: OK');
+end
+
+% 006 Test that the fan-beam ray with the fan angle gamma is the parallel
+% ray with theta = beta + gamma and r = L*sin(gamma)
+L = 100;
+gamma = asin(rVec/L);
+P = sinogramFanJc(I, degVec, gamma, L);
+t_P = zeros(size(P));
+for j = 1:length(rVec)
+  Pj = sinogramJ(I, degVec + gamma(j)*180/pi, rVec, 6);
+  t_P(j, :) = Pj(j, :);
+end
+if (max(abs(P(:) - t_P(:))) < geps*max(abs(t_P(:))))
+  disp('006: OK');
+else
+  disp('006: failed');
+end
+
+useCode = oldUseCode;